@@ -1,21 +1,98 @@
 // ERRNO: [51, 60]
+#define _DEFAULT_SOURCE         // open_memstream()
+#include <pthread.h>
+#include <unistd.h>
 #include "analyze.h"
 #include "symtab.h"
 #include "utils.h"
+#include "intern.h"
 
-static void do_build_symtab(node_t *);
+// A NODE WHOSE CHILDREN ARE BEING WALKED -- next IS THE ONE TO GO
+typedef struct frame_t {
+    node_t *t;
+    tint next;
+} frame_t;
 
-static void checker_error(cchar *);
+#define MIN_FRAMES 64
+
+// A DECLARATION OF THE OUT-MOST LEVEL -- WHAT DECLARING IT LISTED IS
+// [from, to) OF global_text AND WHAT CHECKING ITS BODY LISTED IS
+// [body_from, body_to) OF THE text OF ITS worker
+typedef struct unit_t {
+    node_t *decl;
+    uint globals;           // GLOBAL SYMBOLS ITS BODY CAN SEE
+    uint worker;
+    long from, to;
+    long body_from, body_to;
+} unit_t;
+
+struct crew_t;
+
+typedef struct worker_t {
+    struct crew_t *crew;
+    pthread_t thread;
+    bool started;
+    FILE *lst;
+    char *text;
+    size_t size;
+    bool is_error;
+} worker_t;
+
+// WITH FEWER FUNCTIONS THAN THIS ALL IS DONE ON THE CALLING THREAD
+#ifndef ANALYZE_THREAD_MIN
+    #define ANALYZE_THREAD_MIN 256
+#endif
+
+#define ANALYZE_THREADS_MAX 16
+
+// WHAT THE WORKERS OF ONE analyze() SHARE -- AND TAKE OVER FROM THE
+// THREAD RUNNING IT -- ALL OF IT BUT next_unit STAYS PUT WHILE THEY RUN
+typedef struct crew_t {
+    unit_t *units;
+    uint n_units;
+    uint next_unit;         // NEXT ONE FOR A WORKER TO TAKE
+    worker_t *workers;
+    
+    node_t *node_pool;
+    uint *node_line;
+    ident_t *node_ident;
+    intern_t *names;
+    symtab_t *symtab;
+    uint lineno, linecol;
+    bool trace_analyze;
+} crew_t;
+
+static __thread unit_t *units;
+static __thread uint n_units;
+
+static __thread worker_t *workers;
+static __thread uint n_workers;
+
+static __thread FILE *global_lst;   // WHAT declare_global() LISTS
+static __thread char *global_text;
+static __thread size_t global_size;
+
+static void declare_global(unit_t *);
+
+static void type_decl(node_t *);
+
+static void check_body(node_t *, uint);
 
-static void traverse(
-    node_t *, 
-    void (*)(node_t *), 
-    void (*)(node_t *)
-);
+static void walk(node_t *, node_t *);
 
-static void do_type_check(node_t *);
+static bool open_workers(uint);
 
-static void mark_globals(node_t *);
+static void *check_bodies(void *);
+
+static void close_workers(void);
+
+static void visit_node(node_t *, node_t *);
+
+static void resolve_name(node_t *);
+
+static void check_node(node_t *);
+
+static void checker_error(cchar *);
 
 static void decl_builtins(void);
 
@@ -23,168 +100,365 @@ static bool para_check(const node_t *, const node_t *);
 
 #define ____________ "PROTOTYPES AND I12NS"
 
-void build_symtab(node_t *tree)
+void analyze(node_t *tree)
 {
+    uint n_funcs = 0;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    
     if (trace_analyze) {
         draw_ruler("SYMBOL TABLE");
         fprintf(lst, "%-8s%-12s%-6s%-12s%-18s\n", "Scope", "Name", "Line", "Parameter", "Details");
     }
     
+    init_symtab();
     decl_builtins();
-    do_build_symtab(tree);
+    
+    n_units = 0;
+    for (node_t *t = tree; t != NULL; t = SIBLING(t))
+        n_units++;
+    units = calloc(n_units + 1, sizeof(unit_t));
+    if (units == NULL) {
+        PANIC(56, "Memory exhausted in analyze()");
+        close_symtab();
+        return ;
+    }
+    n_units = 0;
+    for (node_t *t = tree; t != NULL; t = SIBLING(t)) {
+        units[n_units++].decl = t;
+        if (t->whichkind.decl == D_FUN)
+            n_funcs++;
+    }
+    
+    // THE GLOBAL SCOPE IS DECLARED FIRST AND THEN ONLY READ -- EACH BODY
+    // DECLARES IN A TABLE OF ITS OWN -- SO MANY BODIES ARE CHECKED ON A
+    // POOL OF THREADS, EACH LISTING TO A STREAM OF ITS OWN THAT ARE
+    // MERGED IN SOURCE ORDER AFTER -- THE LISTING READS THE SAME
+    if (n_funcs < ANALYZE_THREAD_MIN || ncpu < 2 ||
+        !open_workers(ncpu < ANALYZE_THREADS_MAX ? ncpu : ANALYZE_THREADS_MAX)) {
+        for (uint i = 0; i < n_units; i++) {
+            declare_global(units + i);
+            if (units[i].decl->whichkind.decl == D_FUN)
+                check_body(units[i].decl, units[i].globals);
+        }
+    }
+    else {
+        FILE *main_lst = lst;
+        lst = global_lst;
+        for (uint i = 0; i < n_units; i++) {
+            units[i].from = ftell(lst);
+            declare_global(units + i);
+            units[i].to = ftell(lst);
+        }
+        
+        // THIS THREAD IS WORKER 0
+        crew_t crew = {
+            units, n_units, 0, workers,
+            node_pool, node_line, node_ident, intern_state(), symtab_state(),
+            lineno, linecol, trace_analyze
+        };
+        for (uint w = 0; w < n_workers; w++)
+            workers[w].crew = &crew;
+        for (uint w = 1; w < n_workers; w++)
+            workers[w].started = pthread_create(&workers[w].thread,
+                NULL, check_bodies, workers + w) == 0;
+        check_bodies(workers);
+        for (uint w = 1; w < n_workers; w++)
+            if (workers[w].started)
+                pthread_join(workers[w].thread, NULL);
+        
+        lst = main_lst;
+        close_workers();
+    }
+    free(units);
     
     // AT THIS POINT -- scopeno MUST BE 0
     // WHICH MEANS THAT THE OUT-MOST SCOPE
-    // SO MARK THEM ALL TO GLOBALS
-    mark_globals(tree);
-    
     if (trace_analyze) {
         draw_ruler("GLOBALS");
         dump_current_scope();
         draw_ruler("");
     }
+    if (trace_memory)
+        dump_symtab_stats();
+    close_symtab();         // THE TREE KEEPS WHAT IT FOUND
 }
 
-void inline type_check(node_t *tree)
+// THE DECLARATION ITSELF -- AND THE TYPES OF ITS PARAMETERS SO A CALL
+// CHECKED ON ANOTHER THREAD NEEDN'T WAIT FOR ITS BODY
+static void declare_global(unit_t *u)
 {
-    traverse(tree, NULL, do_type_check);
+    node_t *t = u->decl;
+    insert_symbol(IDENT(t), t, LINE(t));
+    type_decl(t);
+    if (t->whichkind.decl == D_FUN)
+        for (node_t *p = CHILD(t, 0); p != NULL; p = SIBLING(p))
+            type_decl(p);
+    else
+        t->is_global = true;
+    u->globals = global_symbols();
 }
 
-static void do_build_symtab(node_t *t)
+static void type_decl(node_t *t)
 {
-    hash_t *lu_symbol;
-    static node_t *enclosing_func = NULL;
-    while (t != NULL) {
-        if (t->nodekind == N_DECL)
-            insert_symbol(t->name, t, t->lineno);
+    char err_msg[LENGTH];
+    switch (t->whichkind.decl) {
+        case D_SCA: t->expr_type = t->var_data_type; break;
         
-        if (t->nodekind == N_DECL && 
-            t->whichkind.decl == D_FUN) {
-            enclosing_func = t;
-            if (trace_analyze)
-                draw_ruler(t->name);
-            enter_scope();
-        }
+        case D_VEC: t->expr_type = ET_ARR; break;
         
-        if (t->nodekind == N_STMT && 
-            t->whichkind.stmt == S_COMPOUND)
-            enter_scope();
+        case D_FUN: t->expr_type = ET_FUNC; break;
         
-        if ( (t->nodekind == N_EXPR && t->whichkind.expr == E_ID) || 
-            (t->nodekind == N_STMT && t->whichkind.stmt == S_CALL) ) {
-            lu_symbol = lookup_symbol(t->name);
-            if (lu_symbol == NULL) {
-                // NEED char err_msg[LENGTH] REMAINS UNKNOWN!
-                sprintf(median, "Unknown Identifier `%s'", t->name);
-                checker_error(median);
+        default:
+            sprintf(err_msg, "Unknown declaration type in analyzer");
+            PANIC(52, err_msg);
+        break;
+    }
+}
+
+static void check_body(node_t *func, uint globals)
+{
+    open_local_symtab(globals);
+    if (trace_analyze)
+        draw_ruler(NAME(func));
+    enter_scope();
+    for (tint i = 0; i < MAX_CHILDS; i++)
+        walk(CHILD(func, i), func);
+    if (trace_analyze)
+        dump_current_scope();
+    leave_scope();
+    close_local_symtab();
+}
+
+// NAMES ARE RESOLVED ON THE WAY DOWN AND TYPES CHECKED ON THE WAY UP
+// -- ON A STACK OF OUR OWN SO NO NESTING CAN RUN OUT OF THE C ONE
+static void walk(node_t *tree, node_t *func)
+{
+    uint room = MIN_FRAMES, depth = 0;
+    frame_t *stack = malloc(room * sizeof(frame_t));
+    if (stack == NULL) {
+        PANIC(57, "Memory exhausted in walk()");
+        return ;
+    }
+    
+    if (tree != NULL) {
+        visit_node(tree, func);
+        stack[depth++] = (frame_t) {tree, 0};
+    }
+    while (depth > 0) {
+        frame_t *top = &stack[depth-1];
+        if (top->next < MAX_CHILDS) {
+            node_t *child = CHILD(top->t, top->next);
+            top->next++;
+            if (child == NULL)
+                continue;
+            if (depth == room) {
+                frame_t *more = realloc(stack, 2 * room * sizeof(frame_t));
+                if (more == NULL) {
+                    PANIC(57, "Memory exhausted in walk()");
+                    break;
+                }
+                stack = more;
+                room *= 2;
             }
-            else
-                t->declaration = lu_symbol->decl;
+            visit_node(child, func);
+            stack[depth++] = (frame_t) {child, 0};
         }
-        
-        if (t->nodekind == N_STMT && t->whichkind.stmt == S_RETURN)
-            t->declaration = enclosing_func;
-        
-        for (tint i = 0; i < MAX_CHILDS; i++)
-            do_build_symtab(t->child[i]);
-        
-        if ( (t->nodekind == N_DECL && t->whichkind.decl == D_FUN) ||
-            (t->nodekind == N_STMT && t->whichkind.stmt == S_COMPOUND) ) {
-            if (trace_analyze)
-                dump_current_scope();
-            leave_scope();
+        else {
+            // DONE WITH ITS CHILDREN -- ITS SIBLING TAKES ITS FRAME
+            node_t *t = top->t;
+            check_node(t);
+            node_t *next = SIBLING(t);
+            if (next == NULL)
+                depth--;
+            else {
+                visit_node(next, func);
+                *top = (frame_t) {next, 0};
+            }
         }
-        
-        t = t->sibling;
     }
+    free(stack);
 }
 
-static void checker_error(cchar *str)
+// global_lst AND n STREAMS TO LIST TO -- FALSE IF NOT EVEN ONE
+static bool open_workers(uint n)
 {
-    static char err_msg[LENGTH];
-    strncpy(err_msg, str, LENGTH-1);
-    err_msg[LENGTH-1] = '\0';
-    sprintf(err_msg, "Type check -> %s", str);
-    PANIC(51, err_msg);
-    is_error = true;
+    global_lst = open_memstream(&global_text, &global_size);
+    if (global_lst == NULL)
+        return false;
+    workers = calloc(n, sizeof(worker_t));
+    if (workers == NULL) {
+        fclose(global_lst);
+        free(global_text);
+        return false;
+    }
+    for (n_workers = 0; n_workers < n; n_workers++) {
+        worker_t *w = workers + n_workers;
+        w->lst = open_memstream(&w->text, &w->size);
+        if (w->lst == NULL)
+            break;
+    }
+    if (n_workers == 0) {
+        free(workers);
+        workers = NULL;
+        fclose(global_lst);
+        free(global_text);
+        return false;
+    }
+    return true;
 }
 
-static void traverse(
-    node_t *tree, 
-    void (*pre_order_func)(node_t *), 
-    void (*post_order_func)(node_t *)
-)
+// TAKES THE NEXT BODY TILL NONE IS LEFT
+static void *check_bodies(void *arg)
 {
-    tint i;
-    while (tree != NULL) {
-        // NOTE THAT HERE tree NOT NULL
-        // SO IN pre_order_func() AND post_order_func()
-        // WE NEEDN'T TO JUDGE IF tree IS NULL
-        if (pre_order_func != NULL)
-            pre_order_func(tree);
-        for (i = 0; i < MAX_CHILDS; i++)
-            traverse(tree->child[i], pre_order_func, post_order_func);
-        if (post_order_func != NULL)
-            post_order_func(tree);
-        tree = tree->sibling;
+    worker_t *w = arg;
+    crew_t *crew = w->crew;
+    FILE *own_lst = lst;
+    lst = w->lst;
+    
+    // A NEW THREAD HAS NONE OF THE COMPILATION YET
+    units = crew->units;
+    n_units = crew->n_units;
+    workers = crew->workers;
+    node_pool = crew->node_pool;
+    node_line = crew->node_line;
+    node_ident = crew->node_ident;
+    adopt_intern(crew->names);
+    adopt_symtab(crew->symtab);
+    lineno = crew->lineno;
+    linecol = crew->linecol;
+    trace_analyze = crew->trace_analyze;
+    
+    for (;;) {
+        uint i = __atomic_fetch_add(&crew->next_unit, 1, __ATOMIC_RELAXED);
+        if (i >= n_units)
+            break;
+        unit_t *u = units + i;
+        if (u->decl->whichkind.decl != D_FUN)
+            continue;
+        u->worker = w - workers;
+        u->body_from = ftell(lst);
+        check_body(u->decl, u->globals);
+        u->body_to = ftell(lst);
     }
+    w->is_error = is_error;
+    lst = own_lst;
+    return NULL;
 }
 
-static void do_type_check(node_t *t)
+// ALL WORKERS ARE DONE -- LISTS WHAT EACH UNIT LISTED IN ITS TURN
+static void close_workers(void)
+{
+    fclose(global_lst);
+    for (uint w = 0; w < n_workers; w++) {
+        fclose(workers[w].lst);
+        if (workers[w].is_error)
+            is_error = true;
+    }
+    for (uint i = 0; i < n_units; i++) {
+        unit_t *u = units + i;
+        fwrite(global_text + u->from, 1, u->to - u->from, lst);
+        if (u->decl->whichkind.decl == D_FUN) {
+            worker_t *w = workers + u->worker;
+            fwrite(w->text + u->body_from, 1, u->body_to - u->body_from, lst);
+        }
+    }
+    for (uint w = 0; w < n_workers; w++)
+        free(workers[w].text);
+    free(global_text);
+    free(workers);
+    workers = NULL;
+    n_workers = 0;
+}
+
+// ON THE WAY DOWN -- THE DECLARATIONS HERE ARE ALL LOCAL
+static void visit_node(node_t *t, node_t *func)
 {
-    // t == NULL TRIGGERS RUN-TIME ERROR
-    // FORTUNATELY ONLY traverse() CALLS ME
-    // AND traverse() PROVIDES ME A NON-NULL t
-    static char err_msg[LENGTH];
     switch (t->nodekind) {
         case N_DECL:
-            switch (t->whichkind.decl) {
-                case D_SCA: t->expr_type = t->var_data_type; break;
-                
-                case D_VEC: t->expr_type = ET_ARR; break;
-                
-                case D_FUN: t->expr_type = ET_FUNC; break;
-                
-                default:
-                    sprintf(err_msg, "Unknown declaration type in type-chcker");
-                    PANIC(52, err_msg);
-                break;
-            }
+            insert_symbol(IDENT(t), t, LINE(t));
+            if (!t->is_parameter)   // declare_global() DID THOSE
+                type_decl(t);
+        break;
+        
+        case N_STMT:
+            if (t->whichkind.stmt == S_COMPOUND)
+                enter_scope();
+            else if (t->whichkind.stmt == S_RETURN)
+                t->declaration = node_id(func);
+            else if (t->whichkind.stmt == S_CALL)
+                resolve_name(t);
+        break;
+        
+        case N_EXPR:
+            if (t->whichkind.expr == E_ID)
+                resolve_name(t);
+        break;
+        
+        default:
+        break;
+    }
+}
+
+static void resolve_name(node_t *t)
+{
+    symbol_t *lu_symbol = lookup_symbol(IDENT(t));
+    if (lu_symbol == NULL) {
+        // NEED char err_msg[LENGTH] REMAINS UNKNOWN!
+        sprintf(median, "Unknown Identifier `%s'", NAME(t));
+        checker_error(median);
+    }
+    else
+        t->declaration = node_id(lu_symbol->decl);
+}
+
+// ON THE WAY UP -- ALL CHILDREN OF t ARE TYPED BY NOW
+static void check_node(node_t *t)
+{
+    char err_msg[LENGTH];
+    switch (t->nodekind) {
+        case N_DECL:
         break;
         
         case N_STMT:
             switch(t->whichkind.stmt) {
                 case S_IF:
-                    if (t->child[0]->expr_type != ET_INT)
+                    if (CHILD(t, 0)->expr_type != ET_INT)
                         checker_error("if-expression must be integer");
                 break;
                 
                 case S_WHILE:
-                    if (t->child[0]->expr_type != ET_INT)
+                    if (CHILD(t, 0)->expr_type != ET_INT)
                         checker_error("while-expression must be integer");
                 break;
                 
                 case S_RETURN:
-                    if (t->declaration->func_ret_type == ET_INT) {
-                        if (t->child[0] == NULL || t->child[0]->expr_type != ET_INT)
+                    if (DECL_OF(t)->func_ret_type == ET_INT) {
+                        if (CHILD(t, 0) == NULL || CHILD(t, 0)->expr_type != ET_INT)
                             checker_error("return-expression is either void nor an integer");
                     }
-                    else if (t->declaration->func_ret_type == ET_VOID) {
-                        if (t->child[0] != NULL)
+                    else if (DECL_OF(t)->func_ret_type == ET_VOID) {
+                        if (CHILD(t, 0) != NULL)
                             checker_error("void-return-expression must be void");
                     }
                 break;
                 
                 case S_CALL:
-                    if (para_check(t->declaration, t) == false) {
+                    if (t->declaration == 0)    // REPORTED ALREADY
+                        break;
+                    if (para_check(DECL_OF(t), t) == false) {
                         sprintf(err_msg, "Formal and actual parameters "
-                            "of function `%s' are not matched", t->name);
+                            "of function `%s' are not matched", NAME(t));
                         checker_error(err_msg);
                     }
-                    t->expr_type = t->declaration->func_ret_type;
+                    t->expr_type = DECL_OF(t)->func_ret_type;
                 break;
                 
-                case S_COMPOUND: t->expr_type = ET_VOID; break;
+                case S_COMPOUND:
+                    t->expr_type = ET_VOID;
+                    if (trace_analyze)
+                        dump_current_scope();
+                    leave_scope();
+                break;
                 
                 default:
                     sprintf(err_msg, "Unknown statement type in type-checker");
@@ -197,16 +471,16 @@ static void do_type_check(node_t *t)
             switch (t->whichkind.expr) {
                 case E_OP:
                     if (t->op >= PLUS && t->op <= DIVIDE) {
-                        expr_t child_0 = t->child[0]->expr_type;
-                        expr_t child_1 = t->child[1]->expr_type;
+                        expr_t child_0 = CHILD(t, 0)->expr_type;
+                        expr_t child_1 = CHILD(t, 1)->expr_type;
                         if (child_0 == ET_INT && child_1 == ET_INT)
                             t->expr_type = ET_INT;
                         else
                             checker_error("Arithmetic operators must have integer operands");
                     }
                     else if (t->op >= LT && t->op <= NE) {
-                        expr_t child_0 = t->child[0]->expr_type;
-                        expr_t child_1 = t->child[1]->expr_type;
+                        expr_t child_0 = CHILD(t, 0)->expr_type;
+                        expr_t child_1 = CHILD(t, 1)->expr_type;
                         if (child_0 == ET_INT && child_1 == ET_INT)
                             t->expr_type = ET_INT;
                         else
@@ -219,20 +493,22 @@ static void do_type_check(node_t *t)
                 case E_NUM: t->expr_type = ET_INT; break;
                 
                 case E_ID:
-                    if (t->declaration->expr_type == ET_INT) {
-                        if (t->child[0] == NULL)
+                    if (t->declaration == 0)    // REPORTED ALREADY
+                        break;
+                    if (DECL_OF(t)->expr_type == ET_INT) {
+                        if (CHILD(t, 0) == NULL)
                             t->expr_type = ET_INT;
                         else
                             checker_error("Cannot access a non-array element");
                     }
-                    else if (t->declaration->expr_type == ET_ARR) {
-                        if (t->child[0] == NULL)
+                    else if (DECL_OF(t)->expr_type == ET_ARR) {
+                        if (CHILD(t, 0) == NULL)
                             t->expr_type = ET_ARR;
                         else {
-                            if (t->child[0]->expr_type == ET_INT)
+                            if (CHILD(t, 0)->expr_type == ET_INT)
                                 t->expr_type = ET_INT;
                             else {
-                                sprintf(err_msg, "Array `%s' must be indexed by a integer", t->name);
+                                sprintf(err_msg, "Array `%s' must be indexed by a integer", NAME(t));
                                 checker_error(err_msg);
                             }
                         }
@@ -242,7 +518,7 @@ static void do_type_check(node_t *t)
                 break;
                 
                 case E_ASSIGN:
-                    if (t->child[0]->expr_type == ET_INT && t->child[1]->expr_type == ET_INT)
+                    if (CHILD(t, 0)->expr_type == ET_INT && CHILD(t, 1)->expr_type == ET_INT)
                         t->expr_type = ET_INT;
                     else
                         checker_error("Both assigner and assignee must be integer");
@@ -262,16 +538,14 @@ static void do_type_check(node_t *t)
     }
 }
 
-static void mark_globals(node_t *tree)
+static void checker_error(cchar *str)
 {
-    node_t *cursor = tree;
-    while (cursor != NULL) {
-        if (cursor->nodekind == N_DECL && (
-            cursor->whichkind.decl == D_SCA ||
-            cursor->whichkind.decl == D_VEC))
-            cursor->is_global = true;
-        cursor = cursor->sibling;
-    }
+    char err_msg[LENGTH];
+    strncpy(err_msg, str, LENGTH-1);
+    err_msg[LENGTH-1] = '\0';
+    sprintf(err_msg, "Type check -> %s", str);
+    PANIC(51, err_msg);
+    is_error = true;
 }
 
 static void decl_builtins(void)
@@ -280,45 +554,45 @@ static void decl_builtins(void)
     
     // int input(void)
     input = new_decl_node(D_FUN);
-    input->name = copy_string("input");
+    IDENT(input) = ID_INPUT;
     input->func_ret_type = ET_INT;
     input->expr_type = ET_FUNC;
     input->local_size = 0;
     
     // void output(int)
     output_arg = new_decl_node(D_SCA);
-    output_arg->name = copy_string("_argument");
+    IDENT(output_arg) = ID_ARGUMENT;
     output_arg->var_data_type = ET_INT;
     output_arg->expr_type = ET_INT;
     // DON'T FORGET THIS
     output_arg->is_parameter = true;
     
     output = new_decl_node(D_FUN);
-    output->name = copy_string("output");
+    IDENT(output) = ID_OUTPUT;
     output->func_ret_type = ET_VOID;
     output->expr_type = ET_FUNC;
-    output->child[0] = output_arg;
+    output->child[0] = node_id(output_arg);
     output->local_size = 0;
     
     // MAKE THEM TO GLOBAL SCOPE
-    insert_symbol("input", input, 0);
-    insert_symbol("output", output, 0);
+    insert_symbol(ID_INPUT, input, 0);
+    insert_symbol(ID_OUTPUT, output, 0);
 }
 
 static bool para_check(const node_t *formal, const node_t *actual)
 {
-    node_t *p_formal = formal->child[0];
-    node_t *p_actual = actual->child[0];
+    node_t *p_formal = CHILD(formal, 0);
+    node_t *p_actual = CHILD(actual, 0);
     while (p_formal != NULL && p_actual != NULL) {
         if (p_formal->expr_type != p_actual->expr_type)
             return false;
-        p_formal = p_formal->sibling;
-        p_actual = p_actual->sibling;
+        p_formal = SIBLING(p_formal);
+        p_actual = SIBLING(p_actual);
     }
     // IF ONE THEM ARE NULL -- BUT NOT BOTH
     //if ((p_formal == NULL && actual != NULL) ||
     //    (p_formal != NULL && actual == NULL))
-    if ((int) p_formal ^ (int) p_actual)
+    if ((p_formal == NULL) != (p_actual == NULL))
         return false;
     return true;
 }
@@ -3,8 +3,7 @@
 
 #include "globals.h"
 
-void build_symtab(node_t *);
-
-void type_check(node_t *);
+// RESOLVES NAMES, MARKS GLOBALS AND TYPES THE TREE IN ONE WALK
+void analyze(node_t *);
 
 #endif
@@ -0,0 +1,92 @@
+// ERRNO: [91, 100]
+#include "globals.h"
+#include "arena.h"
+
+// NODES, NAMES AND SYMBOLS ALL LIVE AS LONG AS THE COMPILATION -- SO
+// THEY ARE BUMPED OFF CHUNKS THAT ONLY GO AWAY TOGETHER -- CHUNKS
+// DOUBLE UP TO CHUNK_MAX SO EVEN A HUGE SOURCE TAKES FEW OF THEM
+#define CHUNK_MIN (64 * 1024)
+#define CHUNK_MAX (64 * 1024 * 1024)
+
+#define ALIGN sizeof(void *)
+
+typedef struct chunk_t {
+	struct chunk_t *prev;
+	size_t size;
+	char data[];
+} chunk_t;
+
+static __thread chunk_t *chunk = NULL;		// NEWEST -- THE ONE BUMPED
+static __thread char *bump = NULL;
+static __thread char *limit = NULL;
+static __thread size_t next_size = CHUNK_MIN;
+
+static __thread arena_stat_t total;
+
+static bool grow(size_t n)
+{
+	size_t size = next_size;
+	chunk_t *c;
+	if (size < n)
+		size = n;
+	c = malloc(sizeof(chunk_t) + size);
+	if (c == NULL) {
+		PANIC(91, "Memory exhausted in arena_alloc()");
+		return false;
+	}
+	c->prev = chunk;
+	c->size = size;
+	chunk = c;
+	bump = c->data;
+	limit = c->data + size;
+	if (next_size < CHUNK_MAX)
+		next_size *= 2;
+	return true;
+}
+
+void * arena_alloc(size_t n)
+{
+	void *p;
+	n = (n + ALIGN - 1) & ~(ALIGN - 1);
+	if ((size_t) (limit - bump) < n && !grow(n))
+		return NULL;
+	p = bump;
+	bump += n;
+	total.bytes += n;
+	total.count++;
+	return p;
+}
+
+// THE FIRST CHUNK STAYS FOR THE NEXT COMPILATION ON THE THREAD --
+// A SMALL SOURCE THEN NEVER CALLS malloc() FOR ITS NAMES AND SYMBOLS
+void arena_release(void)
+{
+	while (chunk != NULL && chunk->prev != NULL) {
+		chunk_t *prev = chunk->prev;
+		free(chunk);
+		chunk = prev;
+	}
+	if (chunk != NULL && chunk->size > CHUNK_MIN)
+		arena_drop();
+	if (chunk != NULL) {
+		bump = chunk->data;
+		limit = chunk->data + chunk->size;
+	}
+	next_size = chunk != NULL ? 2 * CHUNK_MIN : CHUNK_MIN;
+	total.bytes = total.count = 0;
+}
+
+void arena_drop(void)
+{
+	while (chunk != NULL) {
+		chunk_t *prev = chunk->prev;
+		free(chunk);
+		chunk = prev;
+	}
+	bump = limit = NULL;
+	next_size = CHUNK_MIN;
+	total.bytes = total.count = 0;
+}
+
+arena_stat_t arena_stats(void)
+{ return total; }
@@ -0,0 +1,25 @@
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include "globals.h"
+
+// WHAT THE ARENA HANDED OUT SO FAR -- SUBTRACT TWO FOR A PHASE
+typedef struct arena_stat_t {
+	size_t bytes;
+	size_t count;
+} arena_stat_t;
+
+// BUMPS n BYTES OFF THE ARENA OF THE COMPILATION -- NULL (AND AN
+// ERROR) IF MEMORY RUNS OUT -- THERE IS NO FREEING ONE BY ONE
+void * arena_alloc(size_t);
+
+// DROPS EVERYTHING THE ARENA EVER HANDED OUT AT ONCE -- KEEPING ITS
+// FIRST CHUNK, EMPTY, FOR THE NEXT COMPILATION ON THE THREAD
+void arena_release(void);
+
+// FREES THE CHUNK arena_release() KEPT TOO
+void arena_drop(void);
+
+arena_stat_t arena_stats(void);
+
+#endif
@@ -0,0 +1,316 @@
+// ERRNO: [121, 130]
+#define _DEFAULT_SOURCE
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "globals.h"
+#include "libcm.h"
+#include "batch.h"
+
+// ONE SOURCE FILE AND HOW IT WENT
+typedef struct job_t {
+	cchar *path;
+	off_t size;
+	int result;				// AS cm_compile_file() -- -2 IF NEVER TAKEN
+	bool cached;
+	double ms;
+} job_t;
+
+// A RUN OF order[] FOR ONE THREAD -- ITS OWNER TAKES FROM THE FRONT
+// AND THE OTHERS STEAL FROM THE BACK -- lo AND hi ARE PACKED IN ONE
+// WORD SO A SINGLE COMPARE-AND-SWAP MOVES EITHER END -- NOTHING IS
+// EVER PUSHED, SO A THREAD IS DONE ONCE EVERY RUN IS EMPTY
+typedef struct deque_t {
+	uint64_t span;			// hi << 32 | lo
+	uint stolen;			// TAKEN FROM THIS RUN BY OTHER THREADS
+	char pad[64 - sizeof(uint64_t) - sizeof(uint)];
+} deque_t;
+
+typedef struct batch_t {
+	job_t *job;
+	uint *order;			// INDICES OF job[] -- ONE RUN PER THREAD
+	deque_t *deque;
+	uint n_threads;
+	target_k target;
+	uint parts;
+	cchar *cache;			// SEE cm_set_cache()
+	size_t cache_max;
+	bool is_incremental;	// SEE cm_set_incremental()
+} batch_t;
+
+typedef struct worker_t {
+	batch_t *b;
+	uint self;
+	pthread_t thread;
+	bool started;
+} worker_t;
+
+#define SPAN(lo, hi)	((uint64_t) (hi) << 32 | (lo))
+
+static int take_front(deque_t *d)
+{
+	uint64_t s = __atomic_load_n(&d->span, __ATOMIC_RELAXED);
+	for (;;) {
+		uint lo = (uint) s, hi = (uint) (s >> 32);
+		if (lo >= hi)
+			return -1;
+		if (__atomic_compare_exchange_n(&d->span, &s, SPAN(lo + 1, hi),
+			false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+			return lo;
+	}
+}
+
+static int take_back(deque_t *d)
+{
+	uint64_t s = __atomic_load_n(&d->span, __ATOMIC_RELAXED);
+	for (;;) {
+		uint lo = (uint) s, hi = (uint) (s >> 32);
+		if (lo >= hi)
+			return -1;
+		if (__atomic_compare_exchange_n(&d->span, &s, SPAN(lo, hi - 1),
+			false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+			return hi - 1;
+	}
+}
+
+// ITS OWN RUN FIRST -- THEN THE BACK OF THE NEXT ONE THAT HAS ANY
+static int next_job(batch_t *b, uint self)
+{
+	int k = take_front(b->deque + self);
+	for (uint i = 1; k < 0 && i < b->n_threads; i++) {
+		deque_t *d = b->deque + (self + i) % b->n_threads;
+		if ((k = take_back(d)) >= 0)
+			__atomic_fetch_add(&d->stolen, 1, __ATOMIC_RELAXED);
+	}
+	return k < 0 ? -1 : (int) b->order[k];
+}
+
+static double now_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// WHAT THE FILE LISTED -- ALWAYS IF IT FAILED, OTHERWISE IF ASKED FOR
+static void save_listing(cm_context *c, job_t *j, uint parts)
+{
+	size_t len;
+	cchar *text = cm_listing(c, &len);
+	char *name;
+	FILE *fp;
+	if (text == NULL || (j->result == 0 && parts == 0))
+		return ;
+	if ((name = malloc(strlen(j->path) + 5)) == NULL)
+		return ;
+	sprintf(name, "%s.lst", j->path);
+	fp = fopen(name, "w");
+	if (fp == NULL || fwrite(text, 1, len, fp) != len)
+		fprintf(stderr, "[!] ERROR (NO.121): Cannot write `%s'\n", name);
+	if (fp != NULL)
+		fclose(fp);
+	free(name);
+}
+
+static void *work(void *arg)
+{
+	worker_t *w = arg;
+	batch_t *b = w->b;
+	cm_context *c = cm_open();
+	int i;
+	if (c == NULL)
+		return NULL;		// THE OTHERS STEAL ITS RUN
+	cm_set_target(c, b->target);
+	cm_set_listing(c, b->parts, NULL);
+	if (b->cache != NULL && !cm_set_cache(c, b->cache, b->cache_max))
+		fprintf(stderr, "[!] ERROR (NO.123): Cannot keep a cache in `%s'\n", b->cache);
+	cm_set_incremental(c, b->is_incremental);
+	while ((i = next_job(b, w->self)) >= 0) {
+		job_t *j = b->job + i;
+		double start = now_ms();
+		j->result = cm_compile_file(c, j->path);
+		j->cached = cm_cached(c);
+		j->ms = now_ms() - start;
+		save_listing(c, j, b->parts);
+	}
+	cm_close(c);
+	return NULL;
+}
+
+// A FILE BY SIZE -- BIGGEST FIRST SO THE LAST ONES TO GO ARE SMALL
+typedef struct rank_t {
+	off_t size;
+	uint job;
+} rank_t;
+
+static int by_size(const void *x, const void *y)
+{
+	off_t a = ((const rank_t *) x)->size, b = ((const rank_t *) y)->size;
+	return (a < b) - (a > b);
+}
+
+static void summarize(batch_t *b, uint n, double wall)
+{
+	static cchar *status[] = {"NOTRUN", "FAILED", "OK", "ERROR"};
+	uint count[4] = {0, 0, 0, 0}, stolen = 0, cached = 0;
+	double busy = 0;
+	for (uint i = 0; i < n; i++) {
+		job_t *j = b->job + i;
+		fprintf(stderr, "%-7s%10.2f ms  %s\n", j->cached ? "CACHED" : status[j->result + 2],
+			j->ms, j->path);
+		count[j->result + 2]++;
+		cached += j->cached;
+		busy += j->ms;
+	}
+	for (uint t = 0; t < b->n_threads; t++)
+		stolen += b->deque[t].stolen;
+	fprintf(stderr, "[*] C- BATCH: %u compiled, %u with errors, %u not opened "
+		"on %u thread(s), %u stolen\n", count[2], count[3], count[1] + count[0],
+		b->n_threads, stolen);
+	fprintf(stderr, "[*] C- BATCH: %.2f ms in all, %.2f ms of compiling\n", wall, busy);
+	if (b->cache != NULL)
+		fprintf(stderr, "[*] C- BATCH: %u of %u compiled from the cache\n", cached, count[2]);
+}
+
+// WHERE THE OUTPUT OF path GOES, LESS ITS SUFFIX -- ITS DIRECTORY
+// RESOLVED SO ./a.cm AND a.cm MEET -- malloc()'D
+static char *output_of(cchar *path)
+{
+	cchar *slash = strrchr(path, '/'), *base = slash != NULL ? slash + 1 : path;
+	char *dir = NULL, *key;
+	if (slash == NULL)
+		dir = realpath(".", NULL);
+	else {
+		char *given = strndup(path, slash == path ? 1 : (size_t) (slash - path));
+		if (given != NULL)
+			dir = realpath(given, NULL);
+		free(given);
+	}
+	if (dir == NULL)
+		return strdup(path);
+	if ((key = malloc(strlen(dir) + strlen(base) + 2)) != NULL)
+		sprintf(key, "%s/%s", dir, base);
+	free(dir);
+	return key;
+}
+
+typedef struct named_t {
+	char *output;			// SEE output_of()
+	uint i;
+} named_t;
+
+static int by_output(const void *x, const void *y)
+{
+	const named_t *a = x, *b = y;
+	int c = strcmp(a->output, b->output);
+	return c != 0 ? c : (a->i > b->i) - (a->i < b->i);
+}
+
+// THE *n FILES OF path -- LESS ANY WHOSE OUTPUT AN EARLIER ONE WRITES,
+// WHICH TWO THREADS WOULD WRITE AT ONCE -- INTO kept, IN ORDER, AND
+// THEIR NUMBER INTO *n -- FALSE IF MEMORY RAN OUT
+static bool unique(cchar **path, uint *n, cchar **kept)
+{
+	named_t *name = malloc(*n * sizeof(named_t));
+	bool *is_again = calloc(*n, sizeof(bool));
+	uint named = 0, m = 0;
+	bool is_ok = false;
+	if (name != NULL && is_again != NULL)
+		for (; named < *n; named++)
+			if ((name[named] = (named_t) {output_of(path[named]), named}).output == NULL)
+				break;
+	if (name != NULL && is_again != NULL && named == *n) {
+		qsort(name, *n, sizeof(named_t), by_output);
+		for (uint k = 1; k < *n; k++)
+			is_again[name[k].i] = strcmp(name[k].output, name[k-1].output) == 0;
+		for (uint i = 0; i < *n; i++)
+			if (!is_again[i])
+				kept[m++] = path[i];
+			else
+				fprintf(stderr, "[*] C- BATCH: `%s' given again -- compiled once\n", path[i]);
+		*n = m;
+		is_ok = true;
+	}
+	for (uint k = 0; k < named; k++)
+		free(name[k].output);
+	free(name);
+	free(is_again);
+	return is_ok;
+}
+
+uint batch_compile(cchar **path, uint n, uint jobs, target_k target, uint parts,
+	cchar *cache, size_t cache_max, bool is_incremental)
+{
+	batch_t b = {NULL, NULL, NULL, 0, target, parts, cache, cache_max, is_incremental};
+	cchar **kept = malloc(n * sizeof(cchar *));
+	worker_t *worker = NULL;
+	rank_t *rank = NULL;
+	uint *fill = NULL, failed = n;
+	double start = now_ms();
+	
+	if (kept == NULL || !unique(path, &n, kept)) {
+		fprintf(stderr, "[!] ERROR (NO.122): Memory exhausted in batch_compile()\n");
+		goto done;
+	}
+	path = kept;
+	b.n_threads = jobs < n ? jobs : n;
+	if (b.n_threads == 0)
+		b.n_threads = 1;
+	b.job = calloc(n, sizeof(job_t));
+	b.order = malloc(n * sizeof(uint));
+	b.deque = calloc(b.n_threads, sizeof(deque_t));
+	worker = calloc(b.n_threads, sizeof(worker_t));
+	rank = malloc(n * sizeof(rank_t));
+	fill = calloc(b.n_threads, sizeof(uint));
+	if (b.job == NULL || b.order == NULL || b.deque == NULL ||
+		worker == NULL || rank == NULL || fill == NULL) {
+		fprintf(stderr, "[!] ERROR (NO.122): Memory exhausted in batch_compile()\n");
+		goto done;
+	}
+	
+	for (uint i = 0; i < n; i++) {
+		struct stat st;
+		b.job[i].path = path[i];
+		b.job[i].size = stat(path[i], &st) == 0 ? st.st_size : 0;
+		b.job[i].result = -2;
+		rank[i] = (rank_t) {b.job[i].size, i};
+	}
+	qsort(rank, n, sizeof(rank_t), by_size);
+	
+	// DEALT ROUND-ROBIN -- RUN t HOLDS THE t-TH, THE t+n_threads-TH ...
+	// BIGGEST -- SO EVERY RUN STARTS WITH A BIG ONE AND ENDS SMALL
+	for (uint t = 0, lo = 0; t < b.n_threads; t++) {
+		uint len = n / b.n_threads + (t < n % b.n_threads);
+		b.deque[t].span = SPAN(lo, lo + len);
+		fill[t] = lo;
+		lo += len;
+	}
+	for (uint i = 0; i < n; i++)
+		b.order[fill[i % b.n_threads]++] = rank[i].job;
+	
+	// THIS THREAD IS WORKER 0
+	for (uint t = 0; t < b.n_threads; t++)
+		worker[t] = (worker_t) {.b = &b, .self = t, .started = false};
+	for (uint t = 1; t < b.n_threads; t++)
+		worker[t].started = pthread_create(&worker[t].thread, NULL, work, worker + t) == 0;
+	work(worker);
+	for (uint t = 1; t < b.n_threads; t++)
+		if (worker[t].started)
+			pthread_join(worker[t].thread, NULL);
+	
+	summarize(&b, n, now_ms() - start);
+	failed = 0;
+	for (uint i = 0; i < n; i++)
+		failed += b.job[i].result != 0;
+	
+done:
+	free(kept);
+	free(b.job);
+	free(b.order);
+	free(b.deque);
+	free(worker);
+	free(rank);
+	free(fill);
+	return failed;
+}
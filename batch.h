@@ -0,0 +1,15 @@
+#ifndef _BATCH_H_
+#define _BATCH_H_
+
+#include "globals.h"
+
+// COMPILES THE n FILES AT path ON jobs THREADS -- EACH INTO ITS OWN
+// OUTPUT AS `cm -f' DOES AND ITS LISTING OF parts (SEE libcm.h) INTO
+// ITS OWN path.lst -- THEN SUMMARIZES ON stderr WITH THE TIME EACH
+// FILE TOOK -- RETURNS HOW MANY DIDN'T COMPILE -- cache AS FOR
+// cm_set_cache(), NULL FOR NONE, is_incremental AS FOR
+// cm_set_incremental()
+uint batch_compile(cchar **path, uint n, uint jobs, target_k, uint parts,
+	cchar *cache, size_t cache_max, bool is_incremental);
+
+#endif
@@ -0,0 +1,297 @@
+// ERRNO: [141, 150]
+#define _DEFAULT_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "globals.h"
+#include "cache.h"
+
+// AN ENTRY IS A FILE NAMED AFTER ITS HASH -- ITS HEADER, THEN name, src
+// AND code -- WRITTEN UNDER A NAME OF ITS OWN AND rename()'D INTO PLACE
+// SO ANOTHER PROCESS SEES A WHOLE ENTRY OR NONE -- ITS mtime IS WHEN IT
+// WAS LAST USED, WHICH IS WHAT EVICTION GOES BY
+#define ENTRY_MAGIC		"CM-CACHE"
+#define ENTRY_SUFFIX	".cme"
+#define TEMP_SUFFIX		".tmp"
+
+typedef struct entry_t {
+	char magic[8];
+	char version[16];
+	uint32_t target;
+	uint32_t flags;
+	uint32_t name_len;
+	uint32_t lines;
+	uint64_t src_len;
+	uint64_t code_len;
+} entry_t;
+
+// EVICTION GOES ON TILL dir IS DOWN TO THIS -- SO A FULL CACHE ISN'T
+// SCANNED AGAIN ON THE VERY NEXT STORE
+#define LOW_WATER(max)	((max) / 4 * 3)
+
+// A TEMPORARY THIS OLD WAS LEFT BY A WRITER THAT DIED
+#define STALE_SECONDS	3600
+
+// AN ENTRY FILE AND WHEN IT WAS LAST USED -- FOR EVICTION
+typedef struct aged_t {
+	struct timespec used;
+	off_t size;
+	char *path;
+} aged_t;
+
+static char *path_of(cchar *dir, cchar *file)
+{
+	char *path = malloc(strlen(dir) + strlen(file) + 2);
+	if (path != NULL)
+		sprintf(path, "%s/%s", dir, file);
+	return path;
+}
+
+static uint64_t fnv(uint64_t h, const void *p, size_t n)
+{
+	const unsigned char *s = p;
+	for (size_t i = 0; i < n; i++)
+		h = (h ^ s[i]) * 1099511628211u;
+	return h;
+}
+
+static void header_of(entry_t *e, const cache_key_t *key, uint lines, size_t code_len)
+{
+	memset(e, 0, sizeof(entry_t));
+	memcpy(e->magic, ENTRY_MAGIC, sizeof(e->magic));
+	strncpy(e->version, VERSION, sizeof(e->version));
+	e->target = key->target;
+	e->flags = key->flags;
+	e->name_len = key->name != NULL ? strlen(key->name) : 0;
+	e->lines = lines;
+	e->src_len = key->src_len;
+	e->code_len = code_len;
+}
+
+static bool write_all(int fd, const void *buf, size_t n)
+{
+	const char *p = buf;
+	while (n > 0) {
+		ssize_t put = write(fd, p, n);
+		if (put < 0 && errno == EINTR)
+			continue;
+		if (put <= 0)
+			return false;
+		p += put;
+		n -= put;
+	}
+	return true;
+}
+
+static int by_age(const void *x, const void *y)
+{
+	const struct timespec *a = &((const aged_t *) x)->used;
+	const struct timespec *b = &((const aged_t *) y)->used;
+	if (a->tv_sec != b->tv_sec)
+		return (a->tv_sec > b->tv_sec) - (a->tv_sec < b->tv_sec);
+	return (a->tv_nsec > b->tv_nsec) - (a->tv_nsec < b->tv_nsec);
+}
+
+// WHAT dir REALLY HOLDS GOES INTO s->bytes -- LESS THE LEAST RECENTLY
+// USED ENTRIES IF THAT IS MORE THAN max -- A READER THAT HAS ONE OPEN
+// STILL READS IT WHOLE
+static void evict(cchar *dir, size_t max, cache_stats_t *s)
+{
+	DIR *d = opendir(dir);
+	struct dirent *de;
+	aged_t *all = NULL;
+	size_t n = 0, room = 0;
+	uint64_t bytes = 0;
+	time_t now = time(NULL);
+
+	if (d == NULL)
+		return ;
+	while ((de = readdir(d)) != NULL) {
+		size_t len = strlen(de->d_name);
+		bool is_entry = len > 4 && strcmp(de->d_name + len - 4, ENTRY_SUFFIX) == 0;
+		bool is_temp = len > 4 && strcmp(de->d_name + len - 4, TEMP_SUFFIX) == 0;
+		struct stat st;
+		char *path;
+		if (!is_entry && !is_temp)
+			continue;
+		if ((path = path_of(dir, de->d_name)) == NULL)
+			continue;
+		if (is_temp) {				// GONE ONCE ITS WRITER RENAMES IT
+			if (stat(path, &st) == 0 && now - st.st_mtime > STALE_SECONDS)
+				unlink(path);
+			free(path);
+			continue;
+		}
+		if (stat(path, &st) != 0) {
+			free(path);
+			continue;
+		}
+		if (n == room) {
+			aged_t *more = realloc(all, (room ? 2 * room : 256) * sizeof(aged_t));
+			if (more == NULL) {
+				free(path);
+				break;
+			}
+			all = more;
+			room = room ? 2 * room : 256;
+		}
+		all[n++] = (aged_t) {st.st_mtim, st.st_size, path};
+		bytes += st.st_size;
+	}
+	closedir(d);
+
+	if (bytes > max) {
+		qsort(all, n, sizeof(aged_t), by_age);
+		for (size_t i = 0; i < n && bytes > LOW_WATER(max); i++)
+			if (unlink(all[i].path) == 0) {
+				bytes -= all[i].size;
+				s->evictions++;
+			}
+	}
+	s->bytes = bytes;
+	for (size_t i = 0; i < n; i++)
+		free(all[i].path);
+	free(all);
+}
+
+// THE COUNTERS OF dir UNDER AN flock() OF dir/stats -- WHICH ALSO KEEPS
+// TWO PROCESSES FROM EVICTING AT ONCE -- stored BYTES ARE ACCOUNTED FOR
+// EVEN WHEN THE STORE ISN'T COUNTED
+static void account(cchar *dir, uint hits, uint misses, uint stores, size_t stored,
+	size_t replaced, size_t max)
+{
+	char *path = path_of(dir, "stats");
+	int fd = path != NULL ? open(path, O_RDWR | O_CREAT, 0644) : -1;
+	cache_stats_t s;
+	if (fd >= 0 && flock(fd, LOCK_EX) == 0) {
+		if (pread(fd, &s, sizeof(s), 0) != sizeof(s))
+			memset(&s, 0, sizeof(s));
+		s.hits += hits;
+		s.misses += misses;
+		s.stores += stores;
+		if (stored != 0) {
+			s.bytes += stored;
+			s.bytes -= replaced < s.bytes ? replaced : s.bytes;
+			if (s.bytes > max)
+				evict(dir, max, &s);
+		}
+		if (pwrite(fd, &s, sizeof(s), 0) != sizeof(s))
+			ftruncate(fd, 0);		// COUNTING STARTS OVER
+		flock(fd, LOCK_UN);
+	}
+	if (fd >= 0)
+		close(fd);
+	free(path);
+}
+
+bool cache_open(cchar *dir)
+{
+	if (mkdir(dir, 0755) != 0 && errno != EEXIST)
+		return false;
+	return access(dir, R_OK | W_OK | X_OK) == 0;
+}
+
+void cache_key(cache_key_t *key)
+{
+	uint64_t h = 14695981039346656037u;
+	uint32_t word[2] = {key->target, key->flags};
+	h = fnv(h, VERSION, sizeof(VERSION));
+	h = fnv(h, word, sizeof(word));
+	if (key->name != NULL)
+		h = fnv(h, key->name, strlen(key->name) + 1);
+	key->hash = fnv(h, key->src, key->src_len);
+}
+
+char *cache_fetch(cchar *dir, const cache_key_t *key, size_t *len, uint *lines, bool is_counted)
+{
+	char file[32], *path, *code = NULL, *map;
+	entry_t want, got;
+	struct stat st;
+	int fd;
+
+	snprintf(file, sizeof(file), "%016llx" ENTRY_SUFFIX, (unsigned long long) key->hash);
+	path = path_of(dir, file);
+	fd = path != NULL ? open(path, O_RDONLY) : -1;
+	header_of(&want, key, 0, 0);
+	if (fd >= 0 && fstat(fd, &st) == 0 && (size_t) st.st_size >= sizeof(entry_t) &&
+		(map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) != MAP_FAILED) {
+		cchar *name = map + sizeof(entry_t);
+		cchar *src = name + want.name_len;
+		memcpy(&got, map, sizeof(entry_t));
+		want.lines = got.lines;
+		want.code_len = got.code_len;
+		if (memcmp(&want, &got, sizeof(entry_t)) == 0 && got.code_len <= (uint64_t) st.st_size &&
+			sizeof(entry_t) + got.name_len + got.src_len + got.code_len == (uint64_t) st.st_size &&
+			(got.name_len == 0 || memcmp(name, key->name, got.name_len) == 0) &&
+			(got.src_len == 0 || memcmp(src, key->src, got.src_len) == 0) &&
+			(code = malloc(got.code_len + 1)) != NULL) {
+			memcpy(code, src + got.src_len, got.code_len);
+			*len = got.code_len;
+			*lines = got.lines;
+			futimens(fd, NULL);				// USED NOW
+		}
+		munmap(map, st.st_size);
+	}
+	if (fd >= 0)
+		close(fd);
+	free(path);
+	if (is_counted)
+		account(dir, code != NULL, code == NULL, 0, 0, 0, 0);
+	return code;
+}
+
+void cache_store(cchar *dir, size_t max, const cache_key_t *key, cchar *code, size_t len, uint lines,
+	bool is_counted)
+{
+	static uint serial = 0;
+	char file[32], temp[64], *path, *temp_path;
+	entry_t e;
+	struct stat st;
+	size_t replaced = 0;
+	bool is_ok;
+	int fd;
+
+	snprintf(file, sizeof(file), "%016llx" ENTRY_SUFFIX, (unsigned long long) key->hash);
+	snprintf(temp, sizeof(temp), "%016llx.%ld.%u" TEMP_SUFFIX, (unsigned long long) key->hash,
+		(long) getpid(), __atomic_fetch_add(&serial, 1, __ATOMIC_RELAXED));
+	path = path_of(dir, file);
+	temp_path = path_of(dir, temp);
+	fd = path != NULL && temp_path != NULL ?
+		open(temp_path, O_WRONLY | O_CREAT | O_EXCL, 0644) : -1;
+	header_of(&e, key, lines, len);
+	is_ok = fd >= 0 && write_all(fd, &e, sizeof(e)) &&
+		write_all(fd, key->name, e.name_len) &&
+		write_all(fd, key->src, key->src_len) && write_all(fd, code, len);
+	if (fd >= 0 && close(fd) != 0)
+		is_ok = false;
+	if (is_ok && stat(path, &st) == 0)		// ANOTHER PROCESS'S MISS TOO
+		replaced = st.st_size;
+	if (is_ok && rename(temp_path, path) == 0)
+		account(dir, 0, 0, is_counted, sizeof(e) + e.name_len + key->src_len + len, replaced, max);
+	else if (fd >= 0)
+		unlink(temp_path);
+	free(path);
+	free(temp_path);
+}
+
+bool cache_stats(cchar *dir, cache_stats_t *s)
+{
+	char *path = path_of(dir, "stats");
+	int fd = path != NULL ? open(path, O_RDONLY) : -1;
+	bool is_ok = fd >= 0 || (path != NULL && errno == ENOENT);	// NONE KEPT YET
+	memset(s, 0, sizeof(cache_stats_t));
+	if (fd >= 0 && flock(fd, LOCK_SH) == 0) {
+		if (pread(fd, s, sizeof(cache_stats_t), 0) != sizeof(cache_stats_t))
+			memset(s, 0, sizeof(cache_stats_t));
+		flock(fd, LOCK_UN);
+	}
+	if (fd >= 0)
+		close(fd);
+	free(path);
+	return is_ok;
+}
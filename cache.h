@@ -0,0 +1,46 @@
+#ifndef _CACHE_H_
+#define _CACHE_H_
+
+#include <stdint.h>
+#include "globals.h"
+
+// WHAT THE CODE OF A COMPILATION DEPENDS ON -- BESIDES VERSION -- name
+// ONLY WHERE THE CODE NAMES ITSELF (THE x86 AND C HEADERS), ELSE NULL
+typedef struct cache_key_t {
+	target_k target;
+	uint flags;				// CM_LIST_CODE -- COMMENTS IN THE CODE
+	cchar *name;
+	cchar *src;
+	size_t src_len;
+	uint64_t hash;			// OF ALL THE ABOVE -- SET BY cache_key()
+} cache_key_t;
+
+// KEPT IN dir/stats FOR EVERY PROCESS USING dir
+typedef struct cache_stats_t {
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t stores;
+	uint64_t evictions;
+	uint64_t bytes;			// OF ALL ENTRIES AS OF THE LAST STORE
+} cache_stats_t;
+
+// MAKES dir IF IT ISN'T THERE -- FALSE IF IT CAN'T BE WRITTEN
+bool cache_open(cchar *dir);
+
+void cache_key(cache_key_t *);
+
+// THE CODE KEPT IN dir FOR key -- malloc()'D -- AND THE LINES ITS SOURCE
+// HAD -- NULL ON A MISS -- AN ENTRY ONLY MATCHES IF ITS SOURCE DOES,
+// BYTE FOR BYTE, SO A HASH COLLISION IS JUST A MISS -- ONLY COUNTED IN
+// dir/stats IF is_counted, AS A LOOKUP OF incr.c'S ISN'T A COMPILATION'S
+char *cache_fetch(cchar *dir, const cache_key_t *, size_t *len, uint *lines, bool is_counted);
+
+// KEEPS code FOR key IN dir -- THEN, IF dir HOLDS MORE THAN max BYTES,
+// EVICTS THE LEAST RECENTLY USED ENTRIES -- A FAILURE ONLY COSTS A
+// LATER MISS -- ITS BYTES COUNT TOWARDS max EVEN IF THE STORE ISN'T
+void cache_store(cchar *dir, size_t max, const cache_key_t *, cchar *code, size_t len, uint lines,
+	bool is_counted);
+
+bool cache_stats(cchar *dir, cache_stats_t *);
+
+#endif
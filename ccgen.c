@@ -0,0 +1,393 @@
+// ERRNO: [81, 90]
+#include "ccgen.h"
+#include "intern.h"
+
+// C SOURCE BACKEND -- C- IS ALMOST A SUBSET OF C SO THE TREE IS
+// PRINTED BACK MOSTLY AS IT IS -- WHAT NEEDS CARE:
+//   NAMES		FUNCTIONS BECOME cm_*, PARAMETERS p_* AND OTHER
+//				VARIABLES v_* -- NO CLASH WITH C KEYWORDS OR LIBC
+//				AND A LOCAL CAN SHADOW A PARAMETER AS IN C-
+//   int[]		AN ARRAY PARAMETER IS AN int * -- ARRAYS DECAY
+//				WHEN PASSED JUST AS THE TM PASSES THEIR ADDRESS
+//   ARITH		WRAPS AND COMPARES lhs - rhs AGAINST 0 LIKE THE TM
+//				-- DONE IN unsigned SO gcc -O2 CANNOT ASSUME
+//				NO OVERFLOW
+//   ORDER		THE TM EVALUATES OPERANDS AND ARGUMENTS LEFT TO
+//				RIGHT (AND AN ASSIGNMENT'S RIGHT SIDE FIRST) -- C
+//				DOESN'T -- SO WHERE IT MATTERS THE EARLY ONES GO
+//				THROUGH TEMPORARIES rt_N IN A COMMA EXPRESSION
+//   BUILTINS	input() output() AND / COME FROM A SMALL PRELUDE
+//				WHOSE FAULTS EXIT WITH THE STATUS OF `tm --run'
+
+static __thread uint temp_next = 0;		// NEXT rt_N IN THE CURRENT FUNCTION
+
+static void gen_func(node_t *);
+
+static void gen_decls(node_t *, uint);
+
+static void gen_stmt(node_t *, uint);
+
+static void gen_expr(node_t *, bool);
+
+static void gen_call(node_t *, bool);
+
+static cchar *prelude =
+	"#include <stdio.h>\n"
+	"#include <stdlib.h>\n"
+	"\n"
+	"#define CM_ADD(a, b) ((int) ((unsigned) (a) + (unsigned) (b)))\n"
+	"#define CM_SUB(a, b) ((int) ((unsigned) (a) - (unsigned) (b)))\n"
+	"#define CM_MUL(a, b) ((int) ((unsigned) (a) * (unsigned) (b)))\n"
+	"\n"
+	"static void rt_fault(const char *msg, int status)\n"
+	"{\n"
+	"\tfflush(stdout);\n"
+	"\tfputs(msg, stderr);\n"
+	"\texit(status);\n"
+	"}\n"
+	"\n"
+	"static inline int cm_input(void)\n"
+	"{\n"
+	"\tint value;\n"
+	"\tif (scanf(\"%d\", &value) != 1)\n"
+	"\t\trt_fault(\"Input Exhausted\\n\", 5);\n"
+	"\treturn value;\n"
+	"}\n"
+	"\n"
+	"static inline void cm_output(int value)\n"
+	"{ printf(\"%d\\n\", value); }\n"
+	"\n"
+	"static inline int rt_div(int lhs, int rhs)\n"
+	"{\n"
+	"\tif (rhs == 0)\n"
+	"\t\trt_fault(\"Division by 0\\n\", 4);\n"
+	"\treturn lhs / rhs;\n"
+	"}\n";
+
+static inline void indent(uint depth)
+{
+	while (depth-- != 0)
+		fputc('\t', out);
+}
+
+static inline void put_var(node_t *decl)
+{ fprintf(out, "%s_%s", decl->is_parameter ? "p" : "v", NAME(decl)); }
+
+static inline bool is_func(node_t *t)
+{ return t->nodekind == N_DECL && t->whichkind.decl == D_FUN; }
+
+// OPERANDS WHOSE VALUE CANNOT CHANGE -- NEVER WORTH A TEMPORARY
+static inline bool is_fixed(node_t *t)
+{
+	if (t->nodekind != N_EXPR)
+		return false;
+	if (t->whichkind.expr == E_NUM)
+		return true;
+	return t->whichkind.expr == E_ID &&
+		DECL_OF(t)->whichkind.decl == D_VEC && CHILD(t, 0) == NULL;
+}
+
+// DOES EVALUATING tree CALL OR ASSIGN
+static bool has_effect(node_t *tree)
+{
+	if (tree == NULL)
+		return false;
+	if (tree->nodekind == N_STMT || tree->whichkind.expr == E_ASSIGN)
+		return true;
+	return has_effect(CHILD(tree, 0)) || has_effect(CHILD(tree, 1));
+}
+
+// HOW MANY TEMPORARIES tree ITSELF NEEDS TO KEEP THE TM'S ORDER
+static uint hoisted(node_t *tree)
+{
+	node_t *p;
+	uint n = 0;
+	bool effect = false;
+	if (tree->nodekind == N_STMT && tree->whichkind.stmt == S_CALL) {
+		for (p = CHILD(tree, 0); p != NULL; p = SIBLING(p))
+			effect = effect || has_effect(p);
+		if (effect)
+			for (p = CHILD(tree, 0); p != NULL && SIBLING(p) != NULL; p = SIBLING(p))
+				n += !is_fixed(p);
+		return n;
+	}
+	if (tree->nodekind != N_EXPR)
+		return 0;
+	if (tree->whichkind.expr == E_OP)
+		return !is_fixed(CHILD(tree, 0)) && !is_fixed(CHILD(tree, 1)) &&
+			(has_effect(CHILD(tree, 0)) || has_effect(CHILD(tree, 1)));
+	if (tree->whichkind.expr == E_ASSIGN && CHILD(CHILD(tree, 0), 0) != NULL)
+		return has_effect(CHILD(CHILD(tree, 0), 0)) || has_effect(CHILD(tree, 1));
+	return 0;
+}
+
+static uint count_temps(node_t *tree)
+{
+	uint n = 0;
+	for (; tree != NULL; tree = SIBLING(tree)) {
+		if (tree->nodekind != N_DECL)
+			n += hoisted(tree);
+		for (tint i = 0; i < MAX_CHILDS; i++)
+			n += count_temps(CHILD(tree, i));
+	}
+	return n;
+}
+
+static void put_prototype(node_t *func)
+{
+	node_t *p;
+	fprintf(out, "static %s cm_%s(", func->func_ret_type == ET_VOID ? "void" : "int", NAME(func));
+	if (CHILD(func, 0) == NULL)
+		fputs("void", out);
+	for (p = CHILD(func, 0); p != NULL; p = SIBLING(p)) {
+		fputs(p->whichkind.decl == D_VEC ? "int *" : "int ", out);
+		put_var(p);
+		if (SIBLING(p) != NULL)
+			fputs(", ", out);
+	}
+	fputc(')', out);
+}
+
+void cc_gen(node_t *tree, cchar *outfile)
+{
+	node_t *cursor;
+	bool has_main = false;
+
+	fprintf(out, "// C- %s -- C99\n%s\n", outfile, prelude);
+
+	// GLOBALS ARE ZERO LIKE THE TM'S STACK AT START
+	gen_decls(tree, 0);
+	for (cursor = tree; cursor != NULL; cursor = SIBLING(cursor))
+		if (is_func(cursor)) {
+			put_prototype(cursor);
+			fputs(";\n", out);
+		}
+
+	for (cursor = tree; cursor != NULL; cursor = SIBLING(cursor))
+		if (is_func(cursor)) {
+			if (IDENT(cursor) == ID_MAIN)
+				has_main = true;
+			gen_func(cursor);
+		}
+
+	// A PROGRAM WITHOUT main() HALTS AT ONCE AS ON THE TM
+	fprintf(out, "\nint main(void)\n{\n");
+	if (has_main)
+		fprintf(out, "\tcm_main();\n");
+	fprintf(out, "\treturn 0;\n}\n");
+}
+
+static void gen_func(node_t *tree)
+{
+	node_t *body = CHILD(tree, 1);
+	fputc('\n', out);
+	if (trace_code)
+		fprintf(out, "// %s()\n", NAME(tree));
+	put_prototype(tree);
+	fputs("\n{\n", out);
+	if (body != NULL) {
+		uint temps = count_temps(body);
+		temp_next = 0;
+		gen_decls(CHILD(body, 0), 1);
+		if (temps != 0) {
+			fputs("\tint rt_0", out);
+			for (uint i = 1; i < temps; i++)
+				fprintf(out, ", rt_%u", i);
+			fputs(";\n", out);
+		}
+		gen_stmt(CHILD(body, 1), 1);
+	}
+	fputs("}\n", out);
+}
+
+// VARIABLE DECLARATIONS AMONG cursor AND ITS SIBLINGS
+static void gen_decls(node_t *cursor, uint depth)
+{
+	for (; cursor != NULL; cursor = SIBLING(cursor)) {
+		if (cursor->nodekind != N_DECL || is_func(cursor))
+			continue;
+		indent(depth);
+		fprintf(out, "%sint ", depth == 0 ? "static " : "");
+		put_var(cursor);
+		if (cursor->whichkind.decl == D_VEC)
+			fprintf(out, "[%d]", cursor->val);
+		fputs(";\n", out);
+	}
+}
+
+// BODY OF if OR while -- A LONE COMPOUND-STMT IS NOT WRAPPED TWICE
+static void gen_block(node_t *list, uint depth)
+{
+	fputs(" {\n", out);
+	if (list != NULL && SIBLING(list) == NULL &&
+		list->nodekind == N_STMT && list->whichkind.stmt == S_COMPOUND) {
+		gen_decls(CHILD(list, 0), depth + 1);
+		list = CHILD(list, 1);
+	}
+	gen_stmt(list, depth + 1);
+	indent(depth);
+	fputc('}', out);
+}
+
+static void gen_stmt(node_t *cursor, uint depth)
+{
+	for (; cursor != NULL; cursor = SIBLING(cursor)) {
+		if (cursor->nodekind == N_EXPR && cursor->whichkind.expr == E_ASSIGN) {
+			indent(depth);
+			gen_expr(cursor, true);
+			fputs(";\n", out);
+		} else if (cursor->nodekind == N_STMT)
+			switch (cursor->whichkind.stmt) {
+				case S_IF:
+					indent(depth);
+					fputs("if (", out);
+					gen_expr(CHILD(cursor, 0), true);
+					fputc(')', out);
+					gen_block(CHILD(cursor, 1), depth);
+					if (CHILD(cursor, 2) != NULL) {
+						fputs(" else", out);
+						gen_block(CHILD(cursor, 2), depth);
+					}
+					fputc('\n', out);
+				break;
+
+				case S_WHILE:
+					indent(depth);
+					fputs("while (", out);
+					gen_expr(CHILD(cursor, 0), true);
+					fputc(')', out);
+					gen_block(CHILD(cursor, 1), depth);
+					fputc('\n', out);
+				break;
+
+				case S_RETURN:
+					indent(depth);
+					fputs("return", out);
+					if (CHILD(cursor, 0) != NULL) {
+						fputc(' ', out);
+						gen_expr(CHILD(cursor, 0), true);
+					}
+					fputs(";\n", out);
+				break;
+
+				case S_CALL:
+					indent(depth);
+					gen_call(cursor, true);
+					fputs(";\n", out);
+				break;
+
+				case S_COMPOUND:
+					indent(depth);
+					fputs("{\n", out);
+					gen_decls(CHILD(cursor, 0), depth + 1);
+					gen_stmt(CHILD(cursor, 1), depth + 1);
+					indent(depth);
+					fputs("}\n", out);
+				break;
+			}
+		// OTHER EXPRESSION STATEMENTS ARE DROPPED AS IN cgen.c
+	}
+}
+
+// bare LEAVES OUT THE OUTERMOST PARENTHESES
+static void gen_expr(node_t *tree, bool bare)
+{
+	static cchar *arith[] = {"CM_ADD", "CM_SUB", "CM_MUL", "rt_div"};
+	static cchar *relop[] = {"<", "<=", ">", ">=", "==", "!="};
+	uint temp = 0;
+	bool paren, hoist;
+	if (tree->nodekind == N_STMT) {
+		if (tree->whichkind.stmt == S_CALL)
+			gen_call(tree, bare);
+		return ;
+	}
+	if (tree->nodekind != N_EXPR) return ;
+	switch (tree->whichkind.expr) {
+		case E_OP:
+			hoist = hoisted(tree);
+			paren = !bare && (tree->op >= LT || hoist);
+			if (paren)
+				fputc('(', out);
+			if (hoist) {
+				temp = temp_next++;
+				fprintf(out, "rt_%u = ", temp);
+				gen_expr(CHILD(tree, 0), false);
+				fputs(", ", out);
+			}
+			fprintf(out, "%s(", tree->op <= DIVIDE ? arith[tree->op - PLUS] : "CM_SUB");
+			if (hoist)
+				fprintf(out, "rt_%u", temp);
+			else
+				gen_expr(CHILD(tree, 0), false);
+			fputs(", ", out);
+			gen_expr(CHILD(tree, 1), false);
+			fputc(')', out);
+			if (tree->op >= LT && tree->op <= NE)
+				fprintf(out, " %s 0", relop[tree->op - LT]);
+			if (paren)
+				fputc(')', out);
+		break;
+
+		case E_NUM:
+			fprintf(out, "%d", tree->val);
+		break;
+
+		case E_ID:
+			put_var(DECL_OF(tree));
+			if (DECL_OF(tree)->whichkind.decl == D_VEC && CHILD(tree, 0) != NULL) {
+				fputc('[', out);
+				gen_expr(CHILD(tree, 0), true);
+				fputc(']', out);
+			}
+		break;
+
+		case E_ASSIGN:
+			if (!bare)
+				fputc('(', out);
+			if (hoisted(tree)) {
+				temp = temp_next++;
+				fprintf(out, "rt_%u = ", temp);
+				gen_expr(CHILD(tree, 1), false);
+				fputs(", ", out);
+				gen_expr(CHILD(tree, 0), true);
+				fprintf(out, " = rt_%u", temp);
+			} else {
+				gen_expr(CHILD(tree, 0), true);
+				fputs(" = ", out);
+				gen_expr(CHILD(tree, 1), false);
+			}
+			if (!bare)
+				fputc(')', out);
+		break;
+	}
+}
+
+static void gen_call(node_t *tree, bool bare)
+{
+	node_t *p;
+	uint temp = temp_next, n = hoisted(tree);
+	temp_next += n;
+	if (n != 0) {
+		if (!bare)
+			fputc('(', out);
+		for (p = CHILD(tree, 0); SIBLING(p) != NULL; p = SIBLING(p))
+			if (!is_fixed(p)) {
+				fprintf(out, "rt_%u = ", temp++);
+				gen_expr(p, false);
+				fputs(", ", out);
+			}
+		temp -= n;
+	}
+	fprintf(out, "cm_%s(", NAME(tree));
+	for (p = CHILD(tree, 0); p != NULL; p = SIBLING(p)) {
+		if (n != 0 && SIBLING(p) != NULL && !is_fixed(p))
+			fprintf(out, "rt_%u", temp++);
+		else
+			gen_expr(p, false);
+		if (SIBLING(p) != NULL)
+			fputs(", ", out);
+	}
+	fputc(')', out);
+	if (n != 0 && !bare)
+		fputc(')', out);
+}
@@ -0,0 +1,11 @@
+#ifndef _CCGEN_H_
+#define _CCGEN_H_
+
+#include "globals.h"
+
+// WRITES THE ANALYZED TREE AS C99 SOURCE TO out -- THE NAME IS ONLY
+// FOR ITS HEADER -- BUILD IT WITH ANY C COMPILER (E.G.
+// `gcc -O2 -o prog file.cm.c')
+void cc_gen(node_t *, cchar *);
+
+#endif
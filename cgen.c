@@ -1,19 +1,29 @@
 #include "cgen.h"
 #include "code.h"
+#include "intern.h"
+#include "incr.h"
 
 #define NIL 0		// PLACEHOLDER
 
-static uint local_bound = 0;
+static __thread uint local_bound = 0;
 
-static uint scope_depth = 0;
+static __thread uint scope_depth = 0;
 
-static bool has_outmost_ret = false;
+static __thread bool has_outmost_ret = false;
+
+// WHERE EACH FUNCTION LAID OUT SO FAR STARTS, BY ident_t, -1 FOR NONE
+// -- FOR THE CALLS OF A REPLAYED ONE
+static __thread int *fn_loc = NULL;
+
+static __thread uint fn_locs = 0;
 
 static void do_code_gen(node_t *);
 
 static void gen_func(node_t *);
 
-static void calc_offset(node_t *);
+static void gen_func_incr(node_t *);
+
+static int loc_of(cchar *, uint);
 
 static void calc_offset2(node_t *);
 
@@ -29,13 +39,9 @@ static void gen_return(node_t *);
 
 static void gen_call(node_t *);
 
-void code_gen(node_t *tree, cchar *outfile)
+void code_gen(node_t *tree)
 {
-	out = fopen(outfile, "w");
-	if (out == NULL) {
-		sprintf(median, "Cannot open `%s'", outfile);
-		PANIC(1, median);
-	}
+	emit_start();
 	
 	// IN TVM -- ALL REGISTERS INITIALIZED TO ZERO
 	// AX BX PC BP FP TP INCLUDED
@@ -57,45 +63,47 @@ void code_gen(node_t *tree, cchar *outfile)
 	emit_rm("ST", FP, 0, TP, "backup FP to TP");
 	
 	do_code_gen(tree);
-	fclose(out);
+	emit_finish();
 }
 
 static void do_code_gen(node_t *tree)
 {
 	// UPDATE BP TO RECORD SIZE OF PUBLIC-AREA
-	uint public_bound = 0;
+	uint public_bound = calc_globals(tree);
 	node_t *temp = tree;
-	while (tree != NULL) {
-		if (tree->nodekind == N_DECL) {
-			if (tree->whichkind.decl == D_SCA)
-				tree->offset = public_bound++;
-			else if (tree->whichkind.decl == D_VEC) {
-				tree->offset = public_bound;
-				public_bound += tree->val;
-			}
-		}
-		// SPLITED BY SCOPE-0
-		tree = tree->sibling;
-	}
+	emit_data(public_bound);
 	if (public_bound != 0) {
 		emit_ro("LDC", BP, public_bound, NIL, "update public area");
 		emit_ro("LDC", FP, public_bound, NIL, "also apply to FP");
 	}
 	
 	int jmp_main = emit_skip(1);	// PREPARE TO JUMP TO main()
-	static uint entry_point = 0;	// LOCATION OF main()
+	uint entry_point = 0;		// LOCATION OF main()
+	
+	if (incr_is_on() && (fn_loc = malloc((ident_count() + 1) * sizeof(int))) != NULL) {
+		fn_locs = ident_count() + 1;
+		memset(fn_loc, -1, fn_locs * sizeof(int));
+	}
 	
 	tree = temp;
 	while (tree != NULL) {
 		if (tree->nodekind == N_DECL && tree->whichkind.decl == D_FUN) {
 			tree->offset = emit_skip(0);	// GET CURRENT INST. LINE
-			if (entry_point == 0 && strcmp(tree->name, "main") == 0)
+			emit_symbol(NAME(tree), tree->offset);
+			if (entry_point == 0 && IDENT(tree) == ID_MAIN)
 				entry_point = tree->offset;
-			gen_func(tree);
+			if (incr_is_on())
+				gen_func_incr(tree);
+			else
+				gen_func(tree);
 		}
-		tree = tree->sibling;
+		tree = SIBLING(tree);
 	}
+	free(fn_loc);
+	fn_loc = NULL;
+	fn_locs = 0;
 	
+	emit_line(0);
 	emit_backup(jmp_main);
 	emit_rm("LDC", PC, entry_point, NIL, "jump to main()");
 	emit_restore();
@@ -104,7 +112,12 @@ static void do_code_gen(node_t *tree)
 static void gen_func(node_t *tree)
 {	// tree NOT NULL
 	calc_offset(tree);
-	gen_stmt(tree->child[1]);	// FUNCTION BODY
+	
+	// A AD-HOC METHOD TO UPDATES main()'S LOCAL AREA
+	if (tree->local_size != 0 && IDENT(tree) == ID_MAIN)
+		emit_ro("LDA", FP, tree->local_size, FP, "update main() local area");
+	
+	gen_stmt(CHILD(tree, 1));	// FUNCTION BODY
 	
 	scope_depth = 0;			// TO DEFAULT
 	
@@ -115,7 +128,7 @@ static void gen_func(node_t *tree)
 	}
 	
 	// WE NEED A MANUALLY RETURN FOR NO RETURN-STMT
-	sprintf(median, "general return inst. of %s()", tree->name);
+	sprintf(median, "general return inst. of %s()", NAME(tree));
 	emit_ro("RET", NIL, NIL, NIL, median);
 /*
 	// THE ACTUAL OPERATION OF `RET' IS EQUAL TO:
@@ -125,12 +138,59 @@ static void gen_func(node_t *tree)
 */
 }
 
-static void calc_offset(node_t *tree)
+// THE CODE KEPT FOR A FUNCTION THAT HASN'T CHANGED, MOVED TO WHERE IT
+// STARTS NOW -- ELSE ITS CODE AS gen_func() EMITS IT, KEPT FOR LATER
+static void gen_func_incr(node_t *tree)
+{
+	size_t len;
+	cchar *kept;
+	char *rec;
+	
+	if (IDENT(tree) < fn_locs)
+		fn_loc[IDENT(tree)] = tree->offset;
+	calc_offset(tree);				// THE PRINT HAS THE FRAME
+	kept = incr_lookup(tree, &len);
+	if (kept != NULL && emit_replay(kept, len, tree->offset, LINE(tree), loc_of)) {
+		incr_keep(kept, len);
+		return ;
+	}
+	emit_record(tree->offset, LINE(tree));
+	gen_func(tree);
+	rec = emit_recorded(&len);
+	incr_keep(rec, len);
+	free(rec);
+}
+
+static int loc_of(cchar *name, uint len)
+{
+	ident_t id = intern(name, len, ident_hash_of(name, len));
+	return id < fn_locs ? fn_loc[id] : -1;
+}
+
+uint calc_globals(node_t *tree)
+{
+	uint public_bound = 0;
+	while (tree != NULL) {
+		if (tree->nodekind == N_DECL) {
+			if (tree->whichkind.decl == D_SCA)
+				tree->offset = public_bound++;
+			else if (tree->whichkind.decl == D_VEC) {
+				tree->offset = public_bound;
+				public_bound += tree->val;
+			}
+		}
+		// SPLITED BY SCOPE-0
+		tree = SIBLING(tree);
+	}
+	return public_bound;
+}
+
+void calc_offset(node_t *tree)
 {
 	// COMPOUND-STMT -> INNER-DECL
-	node_t *cursor = tree->child[1];
+	node_t *cursor = CHILD(tree, 1);
 	local_bound = 0;
-	if (cursor) cursor = cursor->child[0];
+	if (cursor) cursor = CHILD(cursor, 0);
 	while (cursor != NULL) {
 		if (cursor->nodekind == N_DECL) {
 			decl_k dtype = cursor->whichkind.decl;
@@ -139,29 +199,25 @@ static void calc_offset(node_t *tree)
 				local_bound += (dtype == D_SCA) ? 1 : cursor->val;
 			}
 		}
-		cursor = cursor->sibling;
+		cursor = SIBLING(cursor);
 	}
 	
 	// COMPOUND-STMT -> SCOPED-DECL
-	cursor = tree->child[1];
-	if (cursor->child[1])
-		calc_offset2(cursor->child[1]);
-	
-	// A AD-HOC METHOD TO UPDATES main()'S LOCAL AREA
-	if (local_bound != 0 && strcmp(tree->name, "main") == 0)
-		emit_ro("LDA", FP, local_bound, FP, "update main() local area");
+	cursor = CHILD(tree, 1);
+	if (CHILD(cursor, 1))
+		calc_offset2(CHILD(cursor, 1));
 	
 	tree->local_size = local_bound;
 	
 	// CALCULATE PARAMETER OFFSET
-	cursor = tree->child[0];
+	cursor = CHILD(tree, 0);
 	while (cursor != NULL) {
 		if (cursor->nodekind == N_DECL) {
 			decl_k dtype = cursor->whichkind.decl;
 			if (dtype == D_SCA || dtype == D_VEC)
 				cursor->offset = local_bound++;
 		}
-		cursor = cursor->sibling;
+		cursor = SIBLING(cursor);
 	}
 }
 
@@ -169,14 +225,14 @@ static void calc_offset2(node_t *cursor)
 {
 	while (cursor != NULL) {
 		for (tint i = 0; i < MAX_CHILDS; i++)
-			calc_offset2(cursor->child[i]);
+			calc_offset2(CHILD(cursor, i));
 		// SINCE `dtype' NOT D_FUN IT MUST BE `D_SCA' || `D_VEC'
 		decl_k dtype = cursor->whichkind.decl;
 		if (cursor->nodekind == N_DECL && dtype != D_FUN) {
 			cursor->offset = local_bound;
 			local_bound += (dtype == D_SCA) ? 1 : cursor->val;
 		}
-		cursor = cursor->sibling;
+		cursor = SIBLING(cursor);
 	}
 }
 
@@ -184,16 +240,17 @@ static void gen_stmt(node_t *cursor)
 {
 	bool is_in_compound = false;
 	while (cursor != NULL) {
+		emit_line(LINE(cursor));
 		if (cursor->nodekind == N_EXPR && cursor->whichkind.expr == E_ASSIGN) {
-			gen_expr(cursor->child[1], false, true);
+			gen_expr(CHILD(cursor, 1), false, true);
 			// NOW AX STORES ASSIGNEE -- PUSH IT INTO TP
 			emit_rm("ST", AX, 0, TP, "[1] store assignee into TP");
 			
-			node_t *tmp = cursor->child[0]->declaration;
+			node_t *tmp = DECL_OF(CHILD(cursor, 0));
 			if (tmp->nodekind == N_DECL && tmp->whichkind.decl == D_VEC && tmp->is_parameter)
-				gen_expr(cursor->child[0], false, false);
+				gen_expr(CHILD(cursor, 0), false, false);
 			else
-				gen_expr(cursor->child[0], true, false);
+				gen_expr(CHILD(cursor, 0), true, false);
 			// NOW AX STORES ASSIGNER -- POP THE ASSIGNEE INTO BX FROM TP
 			emit_rm("LD", BX, 0, TP, "load assignee from TP");
 			
@@ -232,12 +289,12 @@ static void gen_stmt(node_t *cursor)
 					// cursor->child[1] = (STATEMENTS)
 					is_in_compound = true;
 					scope_depth++;
-					gen_stmt(cursor->child[1]);
+					gen_stmt(CHILD(cursor, 1));
 				break;
 			}
 		else if (cursor->nodekind == N_EXPR)
 			; //gen_expr(cursor, false, true);	// OPTIMIZATION
-		cursor = cursor->sibling;
+		cursor = SIBLING(cursor);
 	}
 	// WE'RE LEAVING A COMPOUND SCOPE
 	if (is_in_compound) scope_depth--;
@@ -246,6 +303,7 @@ static void gen_stmt(node_t *cursor)
 static void gen_expr(node_t *tree, bool need_addr, bool load_val)
 {
 	node_k nkind = tree->nodekind;
+	emit_line(LINE(tree));
 	if (nkind == N_STMT)
 		if (tree->whichkind.stmt == S_CALL) {
 			// HERE IS THE SIMILAR STRUCTURE AS IN gen_stmt()
@@ -266,9 +324,9 @@ static void gen_expr(node_t *tree, bool need_addr, bool load_val)
 	switch (tree->whichkind.expr) {
 		case E_OP:
 			// EVALUATE ORDER: LR
-			gen_expr(tree->child[0], false, true);
+			gen_expr(CHILD(tree, 0), false, true);
 			emit_rm("ST", AX, 0, TP, "store lhs to TP");
-			gen_expr(tree->child[1], false, true);
+			gen_expr(CHILD(tree, 1), false, true);
 			emit_rm("LD", BX, 0, TP, "load lhs to BX from TP");
 			// AX: RSIDE   BX: LSIDE
 			switch (tree->op) {
@@ -306,15 +364,15 @@ static void gen_expr(node_t *tree, bool need_addr, bool load_val)
 		
 		case E_ID:
 			;static cchar *ld_map[] = {"LD", "LDA"};
-			tint which_reg = tree->declaration->is_global ? BP : FP;
-			if (tree->declaration->whichkind.decl == D_VEC) {
-				if (tree->child[0] == NULL)		// ONLY POSSIBLE FOR FUNCTION INVOCATION
-					emit_rm(ld_map[need_addr], AX, -(tree->declaration->offset + 1), which_reg, "load addr/val of [] into AX");
+			tint which_reg = DECL_OF(tree)->is_global ? BP : FP;
+			if (DECL_OF(tree)->whichkind.decl == D_VEC) {
+				if (CHILD(tree, 0) == NULL)		// ONLY POSSIBLE FOR FUNCTION INVOCATION
+					emit_rm(ld_map[need_addr], AX, -(DECL_OF(tree)->offset + 1), which_reg, "load addr/val of [] into AX");
 				else {
-					gen_expr(tree->child[0], false, true);
+					gen_expr(CHILD(tree, 0), false, true);
 					// NOW reg[AX] STORES ARRAY INDEX
 					
-					emit_rm(ld_map[need_addr], BX, -(tree->declaration->offset + 1), which_reg, "load addr/val of [*] into AX");
+					emit_rm(ld_map[need_addr], BX, -(DECL_OF(tree)->offset + 1), which_reg, "load addr/val of [*] into AX");
 					emit_ro("SUB", AX, BX, AX, "calculate array's index");
 					
 					// WE NEED TO RESTORE ITS ORIGINAL VALUE TO CHECK IF IT NEEDS TO LOAD VALUE
@@ -322,19 +380,19 @@ static void gen_expr(node_t *tree, bool need_addr, bool load_val)
 						emit_rm("LD", AX, 0, AX, "load value of [*]");
 				}
 			}
-			else if (tree->declaration->whichkind.decl == D_SCA)
-				emit_rm(ld_map[need_addr], AX, -(tree->declaration->offset + 1), which_reg, "load addr/val of * into AX");
+			else if (DECL_OF(tree)->whichkind.decl == D_SCA)
+				emit_rm(ld_map[need_addr], AX, -(DECL_OF(tree)->offset + 1), which_reg, "load addr/val of * into AX");
 		break;
 		
 		case E_ASSIGN:
-			gen_expr(tree->child[1], false, true);
+			gen_expr(CHILD(tree, 1), false, true);
 			emit_rm("ST", AX, 0, TP, "[2] store assignee into TP");
 			
-			node_t *tmp = tree->child[0]->declaration;
+			node_t *tmp = DECL_OF(CHILD(tree, 0));
 			if (tmp->nodekind == N_DECL && tmp->whichkind.decl == D_VEC && tmp->is_parameter)
-				gen_expr(tree->child[0], false, false);
+				gen_expr(CHILD(tree, 0), false, false);
 			else
-				gen_expr(tree->child[0], true, false);
+				gen_expr(CHILD(tree, 0), true, false);
 			emit_rm("LD", BX, 0, TP, "load assignee from TP");
 			// AX: LVALUE(BP-ADDR ALREADY ADDED IN AX)   BX: RVALUE
 			
@@ -350,13 +408,13 @@ static void gen_expr(node_t *tree, bool need_addr, bool load_val)
 static void gen_if(node_t *tree)
 {
 	// IF-EXPR DOESN'T MEAN A NEW SCOPE
-	gen_expr(tree->child[0], false, true);
+	gen_expr(CHILD(tree, 0), false, true);
 	// NOW RESULT OF if IN AX
 	int else_jmp_loc = emit_skip(1);
 	
 	// THEN-PART
 	scope_depth++;
-	gen_stmt(tree->child[1]);
+	gen_stmt(CHILD(tree, 1));
 	scope_depth--;
 	int end_jmp_loc = emit_skip(1);
 	int else_loc = emit_skip(0);
@@ -366,11 +424,11 @@ static void gen_if(node_t *tree)
 	
 	// ELSE-PART
 	scope_depth++;
-	gen_stmt(tree->child[2]);
+	gen_stmt(CHILD(tree, 2));
 	scope_depth--;
 	int end_loc = emit_skip(0);
 	emit_backup(end_jmp_loc);
-	emit_rm("LDC", PC, end_loc, NIL, "jump to end of if");
+	emit_jump(end_loc, "jump to end of if");
 	emit_restore();
 }
 
@@ -378,12 +436,12 @@ static void gen_while(node_t *tree)
 {
 	int while_head = emit_skip(0);
 	// WHILE-EXPR (NO NEW SCOPE)
-	gen_expr(tree->child[0], false, true);
+	gen_expr(CHILD(tree, 0), false, true);
 	
 	int jmp_while_end = emit_skip(1);
 	// WHILE-BODY
 	scope_depth++;
-	gen_stmt(tree->child[1]);
+	gen_stmt(CHILD(tree, 1));
 	scope_depth--;
 	
 	int jmp_while_head = emit_skip(1);
@@ -393,7 +451,7 @@ static void gen_while(node_t *tree)
 	emit_rm_abs("JEQ", AX, while_end, "jump to end if AX is zero");
 	
 	emit_backup(jmp_while_head);
-	emit_rm("LDC", PC, while_head, NIL, "jump to head of while");
+	emit_jump(while_head, "jump to head of while");
 	
 	emit_restore();
 }
@@ -421,8 +479,8 @@ static void gen_return(node_t *tree)
 	if (scope_depth == 1) has_outmost_ret = true;
 	
 	// gen_expr(child[0]) AND RECONVER FP AND PC
-	if (tree->child[0] != NULL)
-		gen_expr(tree->child[0], false, true);
+	if (CHILD(tree, 0) != NULL)
+		gen_expr(CHILD(tree, 0), false, true);
 	// NOW reg[AX] CONTAINS RET-VALUE
 	// NOTE THAT FOR A VOID-RET-TYPE FUNC
 	// ITS `RET-VALUE' DEPENDS ON LAST OPERATION INTO AX
@@ -434,9 +492,9 @@ static void gen_return(node_t *tree)
 static void gen_call(node_t *tree)
 {
 	uint pcot = 0;		// PARAMETER COUNT
-	if (tree->child[0]) {
+	if (CHILD(tree, 0)) {
 		// p IS POINT TO CALL'S ARGUMENT-LIST
-		node_t *p = tree->child[0];
+		node_t *p = CHILD(tree, 0);
 		bool is_need_addr, is_need_val;
 		
 		while (p != NULL) {
@@ -445,26 +503,26 @@ static void gen_call(node_t *tree)
 			if (
 				p->nodekind == N_EXPR &&
 				p->whichkind.expr == E_ID && 
-				p->declaration->whichkind.decl == D_VEC
+				DECL_OF(p)->whichkind.decl == D_VEC
 			) {
 				// DEFAULT VALUE IN CASE p IS A []
-				// E.G. p->child[0] IS NULL
+				// E.G. CHILD(p, 0) IS NULL
 				is_need_addr = true;
 				is_need_val = false;
 				// IF ARGUMENT OF CALLEE p IS CALLER'S PARAMETER
 				// THEN IT MEANS THAT ITS ACTUAL-ADDR IS ALREADY
 				// BE IN STACK -- .: WE CAN'T LOAD ITS ADDR AGAIN
 				// JUST USING `LD' TO LOAD ITS ACTUAL-ADDR
-				if (p->declaration->is_parameter)
+				if (DECL_OF(p)->is_parameter)
 					is_need_addr = false;
-				if (p->child[0] != NULL)
+				if (CHILD(p, 0) != NULL)
 					is_need_val = true;
 			}
 			
 			gen_expr(p, is_need_addr, is_need_val);
 			// THERE IS NO NEED TO PUSH ARGUMENT OF output() INTO FP
-			if (strcmp(tree->name, "output") == 0) {
-				p = p->sibling;
+			if (IDENT(tree) == ID_OUTPUT) {
+				p = SIBLING(p);
 				continue;
 			}
 			
@@ -476,16 +534,16 @@ static void gen_call(node_t *tree)
 			pcot++;		// RECORD PUSHED ARGUMENT
 			
 			// EACH ARGUMENT STORED IN sibling
-			p = p->sibling;
+			p = SIBLING(p);
 		}
 	}
 	// NOW TO CHANGE PC TO CALLEE()
-	if (strcmp(tree->name, "input") == 0) {
+	if (IDENT(tree) == ID_INPUT) {
 		emit_ro("IN", AX, NIL, NIL, "input integer from stdin");
 		emit_ro("RET", NIL, NIL, NIL, "return stmt. of IN");
 		return ;
 	}
-	if (strcmp(tree->name, "output") == 0) {
+	if (IDENT(tree) == ID_OUTPUT) {
 		// output() JUST READ ARGUMENT FROM AX -- :. ITS ARGUMENT
 		// REQUIRES A INT-RET-TYPE FUNC AND WHEN THE FUNC RETURNS
 		// ITS RESULT STORED IN AX -- SO WE CAN SAFELY USE IT
@@ -501,12 +559,12 @@ static void gen_call(node_t *tree)
 	
 	// WE NEED TO UPDATE FP FOR LOCAL-VARIABLES(PARAMETER EXCLUDED)
 	uint lsize = 0;
-	if (tree->declaration) lsize = tree->declaration->local_size;
+	if (DECL_OF(tree)) lsize = DECL_OF(tree)->local_size;
 	if (lsize != 0 && tree->nodekind == N_STMT && tree->whichkind.stmt == S_CALL) {
-		sprintf(median, "update %s()'s local size", tree->name);
+		sprintf(median, "update %s()'s local size", NAME(tree));
 		emit_ro("LDA", FP, lsize, FP, median);
 	}
 	
-	sprintf(median, "jump to %s()", tree->declaration->name);
-	emit_rm("LDC", PC, tree->declaration->offset, NIL, median);
+	sprintf(median, "jump to %s()", NAME(DECL_OF(tree)));
+	emit_call(NAME(DECL_OF(tree)), DECL_OF(tree)->offset, median);
 }
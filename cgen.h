@@ -3,6 +3,18 @@
 
 #include "globals.h"
 
-void code_gen(node_t *, cchar *);
+// WRITES TM CODE (OR A .tmb IMAGE) FOR THE ANALYZED TREE TO out
+void code_gen(node_t *);
+
+// FRAME LAYOUT SHARED BY THE BACKENDS -- A VARIABLE WITH offset k
+// LIVES k+1 WORDS BELOW ITS BASE (BP FOR GLOBALS, FP OTHERWISE)
+// AND ELEMENT i OF AN ARRAY i WORDS BELOW ELEMENT 0
+
+// ASSIGNS offset TO EVERY GLOBAL -- RETURNS THE WORDS THEY TAKE
+uint calc_globals(node_t *);
+
+// ASSIGNS offset TO THE LOCALS OF A FUNCTION THEN ITS PARAMETERS
+// AND SETS local_size TO THE WORDS OF LOCALS
+void calc_offset(node_t *);
 
 #endif
@@ -0,0 +1,247 @@
+// CLIENT OF `cm --serve' -- COMPILES AS cm DOES, BUT IN A SERVER
+// THAT IS ALREADY RUNNING AND WARM, SO NO PROCESS STARTS PER FILE
+#define _DEFAULT_SOURCE
+#include <errno.h>
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include "globals.h"
+#include "libcm.h"
+#include "serve.h"
+
+#define CMC_USAGE												\
+	"Usage: cmc -S socket [options] -f file [-f file ...]\n"	\
+	"       cmc -S socket -b times [-C cm] [-t target] -f file\n" \
+	"Options: \n"												\
+	"   -h     Display this information\n"						\
+	"   -S     Socket of the server, as given to cm --serve\n"	\
+	"   -q -e -s -p -a -c -m -t\n"								\
+	"          As for cm -- the listing comes back to stderr\n"	\
+	"   -f     File to compile into file.tm (or as -t says)\n"	\
+	"   -b     Compile the file this many times in the server,\n" \
+	"          then as many times by running cm, and compare\n"	\
+	"   -C     The cm that -b runs (default: cm)\n"
+
+static cchar *suffix[] = {".tm", ".tmb", ".s", ".c"};
+
+static char *slurp(cchar *path, size_t *len)
+{
+	FILE *fp = fopen(path, "rb");
+	char *text = NULL;
+	long size;
+	if (fp == NULL)
+		return NULL;
+	if (fseek(fp, 0, SEEK_END) == 0 && (size = ftell(fp)) >= 0 &&
+		fseek(fp, 0, SEEK_SET) == 0 && (text = malloc(size + 1)) != NULL) {
+		*len = fread(text, 1, size, fp);
+		if ((long) *len != size) {
+			free(text);
+			text = NULL;
+		}
+	}
+	fclose(fp);
+	return text;
+}
+
+static int dial(cchar *path)
+{
+	struct sockaddr_un addr;
+	int fd;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(addr.sun_path))
+		return -1;
+	strcpy(addr.sun_path, path);
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd >= 0 && connect(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+		close(fd);
+		fd = -1;
+	}
+	return fd;
+}
+
+// ONE ROUND TRIP -- out AND lst ARE REALLOCATED TO FIT THE REPLY
+static bool ask(int fd, target_k target, uint parts, cchar *name, cchar *src, size_t len,
+	serve_rep_t *rep, char **out, char **lst)
+{
+	serve_req_t req = {SERVE_MAGIC, target, parts, strlen(name), len};
+	char *more;
+	if (!serve_write_all(fd, &req, sizeof(req)) || !serve_write_all(fd, name, req.name_len) ||
+		!serve_write_all(fd, src, len) || !serve_read_all(fd, rep, sizeof(*rep)) ||
+		rep->magic != SERVE_MAGIC)
+		return false;
+	if ((more = realloc(*out, rep->out_len + 1)) == NULL)
+		return false;
+	*out = more;
+	if ((more = realloc(*lst, rep->lst_len + 1)) == NULL)
+		return false;
+	*lst = more;
+	return serve_read_all(fd, *out, rep->out_len) && serve_read_all(fd, *lst, rep->lst_len);
+}
+
+static double now_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// WHAT A BUILD DRIVER PAYS PER FILE EITHER WAY -- ONE REQUEST ON AN
+// OPEN CONNECTION AGAINST fork(), exec() AND A COLD cm -- NEITHER LISTS
+static int bench(int fd, cchar *cm, target_k target, cchar *path, uint times)
+{
+	static cchar *target_name[] = {"tm", "tmb", "x86", "c"};
+	char *src, *out = NULL, *lst = NULL;
+	size_t len;
+	serve_rep_t rep;
+	double start, served, spawned;
+	int null;
+
+	if ((src = slurp(path, &len)) == NULL) {
+		fprintf(stderr, "[!] Cannot read `%s'\n", path);
+		return 1;
+	}
+	if (!ask(fd, target, 0, path, src, len, &rep, &out, &lst)) {	// WARM IT UP
+		fprintf(stderr, "[!] The server didn't answer\n");
+		return 1;
+	}
+	start = now_ms();
+	for (uint i = 0; i < times; i++)
+		if (!ask(fd, target, 0, path, src, len, &rep, &out, &lst)) {
+			fprintf(stderr, "[!] The server didn't answer\n");
+			return 1;
+		}
+	served = now_ms() - start;
+
+	null = open("/dev/null", O_WRONLY);
+	start = now_ms();
+	for (uint i = 0; i < times; i++) {
+		int status;
+		pid_t pid = fork();
+		if (pid == 0) {
+			dup2(null, 1);
+			dup2(null, 2);
+			execlp(cm, cm, "-q", "-t", target_name[target], "-f", path, (char *) NULL);
+			_exit(127);
+		}
+		if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+			WEXITSTATUS(status) == 127) {
+			fprintf(stderr, "[!] Cannot run `%s'\n", cm);
+			return 1;
+		}
+	}
+	spawned = now_ms() - start;
+	close(null);
+
+	printf("[*] CMC BENCH: `%s' %u time(s), %zu byte(s) of code\n", path, times, (size_t) rep.out_len);
+	printf("  server      %10.0f req/s %10.1f us each\n", times / served * 1e3, served / times * 1e3);
+	printf("  fork+exec   %10.0f req/s %10.1f us each\n", times / spawned * 1e3, spawned / times * 1e3);
+	printf("  server is %.1fx as fast\n", spawned / served);
+	free(src);
+	free(out);
+	free(lst);
+	return 0;
+}
+
+// EACH FILE AS cm -f WOULD DO IT -- CODE BESIDE IT, LISTING TO stderr
+static int compile(int fd, target_k target, uint parts, cchar *path)
+{
+	char *src, *out = NULL, *lst = NULL, *outname;
+	size_t len;
+	serve_rep_t rep;
+	int r = 1;
+
+	if ((src = slurp(path, &len)) == NULL) {
+		fprintf(stderr, "[!] Cannot read `%s'\n", path);
+		return 1;
+	}
+	if (!ask(fd, target, parts, path, src, len, &rep, &out, &lst)) {
+		fprintf(stderr, "[!] The server didn't answer for `%s'\n", path);
+		free(src);
+		return 1;
+	}
+	fwrite(lst, 1, rep.lst_len, stderr);
+	if (rep.status == 0 && (outname = malloc(strlen(path) + 5)) != NULL) {
+		FILE *fp;
+		sprintf(outname, "%s%s", path, suffix[target]);
+		fp = fopen(outname, target == TG_TMB ? "wb" : "w");
+		if (fp != NULL && fwrite(out, 1, rep.out_len, fp) == rep.out_len && fclose(fp) == 0)
+			r = 0;
+		else
+			fprintf(stderr, "[!] Cannot write `%s'\n", outname);
+		free(outname);
+	}
+	free(src);
+	free(out);
+	free(lst);
+	return r;
+}
+
+int main(int argc, char *argv[])
+{
+	cchar *sock = NULL, *cm = "cm";
+	cchar **inputs = calloc(argc, sizeof(cchar *));
+	uint n_inputs = 0, times = 0, parts = CM_LIST_ALL;
+	target_k target = TG_TM;
+	bool quiet = false;
+	uint asked = 0;
+	int ch, fd, failed = 0;
+
+	opterr = 0;
+	while ((ch = getopt(argc, argv, "hqespacmf:t:S:b:C:")) != -1) {
+		switch (ch) {
+			case 'h':  fprintf(stderr, CMC_USAGE);  return 0;
+			case 'q':  quiet = true;  break;
+			case 'e':  asked |= CM_LIST_ECHO;  break;
+			case 's':  asked |= CM_LIST_SCAN;  break;
+			case 'p':  asked |= CM_LIST_PARSE;  break;
+			case 'a':  asked |= CM_LIST_ANALYZE;  break;
+			case 'c':  asked |= CM_LIST_CODE;  break;
+			case 'm':  parts |= CM_LIST_MEMORY;  break;
+			case 'f':  inputs[n_inputs++] = optarg;  break;
+			case 'S':  sock = optarg;  break;
+			case 'b':  times = atoi(optarg);  break;
+			case 'C':  cm = optarg;  break;
+			case 't':
+				if (strcmp(optarg, "tm") == 0)
+					target = TG_TM;
+				else if (strcmp(optarg, "tmb") == 0)
+					target = TG_TMB;
+				else if (strcmp(optarg, "x86") == 0)
+					target = TG_X86;
+				else if (strcmp(optarg, "c") == 0)
+					target = TG_C;
+				else
+					ch = '?';
+			break;
+			default:  ch = '?';  break;
+		}
+		if (ch == '?') {
+			fprintf(stderr, CMC_USAGE);
+			return -2;
+		}
+	}
+	if (sock == NULL || n_inputs == 0 || (times != 0 && n_inputs != 1)) {
+		fprintf(stderr, CMC_USAGE);
+		return -2;
+	}
+	if (quiet)
+		parts = (parts & CM_LIST_MEMORY) | asked;
+
+	if ((fd = dial(sock)) < 0) {
+		fprintf(stderr, "[!] Cannot connect to `%s'\n", sock);
+		return -2;
+	}
+	if (times != 0)
+		failed = bench(fd, cm, target, inputs[0], times);
+	else
+		for (uint i = 0; i < n_inputs; i++)
+			failed |= compile(fd, target, parts, inputs[i]);
+	close(fd);
+	free(inputs);
+	return failed ? 1 : 0;
+}
@@ -1,5 +1,7 @@
+// ERRNO: [61, 70]
 #include "globals.h"
 #include "code.h"
+#include "tmb.h"
 
 static bool debug_flag = false;
 
@@ -9,39 +11,458 @@ static cchar *reg_map[] = {
 };
 
 // LOCATION NUMBER OF CURRENT INSTRUCTION IN TVM
-static uint emit_loc = 0;
+static __thread uint emit_loc = 0;
 
 // HIGHEST TVM LOCATION EMITTED SO FAR
 // USED IN emit_skip() emit_backup() emit_restore()
-static uint high_emit_loc = 0;
+static __thread uint high_emit_loc = 0;
+
+// .tmb IMAGE -- BUFFERED UNTIL emit_finish() SINCE emit_backup()
+// REWRITES EARLIER LOCATIONS
+static cchar *opcode_map[] = { OPCODE_NAMES };
+static __thread tmb_insn *bin_code = NULL;
+static __thread uint32_t *bin_line = NULL;
+static __thread uint bin_cap = 0;
+static __thread uint cur_line = 0;
+static __thread uint data_words = 0;
+static __thread tmb_sym *bin_sym = NULL;
+static __thread uint sym_count = 0, sym_cap = 0;
+static __thread char *bin_str = NULL;
+static __thread uint str_size = 0, str_cap = 0;
+
+// WHAT ONE FUNCTION EMITS, AS BYTES AN INCREMENTAL BUILD KEEPS -- EACH
+// INSTRUCTION WITH ITS LOCATION IN THE FUNCTION, SO THAT IT REPLAYS IN
+// THE ORDER AND AT THE PLACE IT WAS EMITTED AND THE OUTPUT IS THE SAME
+// -- AN ABSOLUTE LOCATION IN IT IS KEPT RELATIVE TO THE FUNCTION (A
+// JUMP WITHIN IT) OR BY NAME (A CALL)
+enum { EV_LINE = 'L', EV_INSN = 'I', EV_NOTE = 'C', EV_END = 'E' };
+enum { RELOC_NONE, RELOC_SELF, RELOC_CALL };
+
+// A LINE OF TM TEXT AFTER ITS LOCATION -- ITS NOTE IS AT MOST LENGTH
+#define TEXT_MAX	(2 * LENGTH + 2)
+
+// "%03d:" OF A LOCATION
+#define LOC_MAX		16
+
+// TM TEXT A REPLAY WRITES AT ONCE -- MORE THAN A LINE
+#define CHUNK		8192
+
+// AN EV_INSN -- THE CALLEE'S NAME FOLLOWS A RELOC_CALL, THEN FOR THE TM
+// TEXT, THE LINE AFTER THE LOCATION (OR THE NOTE IF IT IS RELOCATED)
+typedef struct rec_insn {
+	uint8_t op;				// INDEX OF opcode_map[]
+	uint8_t a1, a3;			// REGISTERS
+	uint8_t reloc;
+	int32_t a2;				// RELATIVE TO THE FUNCTION IF RELOC_SELF
+	uint32_t loc;			// DITTO
+} rec_insn;
+
+static __thread bool is_recording = false;
+static __thread uint rec_base = 0;		// WHERE THE FUNCTION STARTS
+static __thread uint rec_line = 0;		// AND ITS LINE
+static __thread char *rec = NULL;
+static __thread size_t rec_size = 0, rec_room = 0;
+static __thread int rec_reloc = RELOC_NONE;	// OF THE NEXT INSTRUCTION
+static __thread cchar *rec_callee = NULL;
+
+// GROW *buf OF *cap ITEMS TO HOLD need ITEMS -- NEW ITEMS ZEROED
+static bool reserve(void **buf, uint *cap, uint need, size_t size)
+{
+	uint new_cap = *cap ? *cap : 64;
+	void *temp;
+	if (need <= *cap)
+		return true;
+	while (new_cap < need)
+		new_cap *= 2;
+	temp = realloc(*buf, new_cap * size);
+	if (temp == NULL) {
+		PANIC(61, "Memory exhausted in reserve()");
+		return false;
+	}
+	memset((char *) temp + *cap * size, 0, (new_cap - *cap) * size);
+	*buf = temp;
+	*cap = new_cap;
+	return true;
+}
+
+// bin_code AND bin_line GROW TOGETHER
+static bool reserve_code(uint need)
+{
+	uint cap = bin_cap;
+	return reserve((void **) &bin_code, &bin_cap, need, sizeof(tmb_insn)) && 
+		reserve((void **) &bin_line, &cap, need, sizeof(uint32_t));
+}
+
+static void record(int code, int a1, int a2, int a3, cchar *text);
+
+static int opcode_of(cchar *op)
+{
+	int code = 0;
+	while (code < RA_LIM && strcmp(opcode_map[code], op) != 0)
+		code++;
+	return code;
+}
+
+static inline void store_bin(uint loc, int code, int a1, int a2, int a3)
+{
+	bin_code[loc].op = code;
+	bin_code[loc].a1 = a1;
+	bin_code[loc].a2 = a2;
+	bin_code[loc].a3 = a3;
+	bin_line[loc] = cur_line;
+}
+
+// STORE ONE INSTRUCTION AT emit_loc -- a1 a2 a3 IN TEXT ORDER
+static void emit_bin(cchar *op, int a1, int a2, int a3)
+{
+	int code = opcode_of(op);
+	assert(code < RA_LIM);
+	if (is_recording)
+		record(code, a1, a2, a3, NULL);
+	if (reserve_code(emit_loc + 1))
+		store_bin(emit_loc, code, a1, a2, a3);
+}
+
+static void put(const void *p, size_t n)
+{
+	if (rec_size + n > rec_room) {
+		size_t room = rec_room ? 2 * rec_room : 1024;
+		char *more;
+		while (room < rec_size + n)
+			room *= 2;
+		if ((more = realloc(rec, room)) == NULL) {
+			is_recording = false;			// NOTHING KEPT -- NO HARM
+			return ;
+		}
+		rec = more;
+		rec_room = room;
+	}
+	memcpy(rec + rec_size, p, n);
+	rec_size += n;
+}
+
+static void put_int(int32_t v)
+{ put(&v, sizeof(v)); }
+
+// WITH ITS '\0' -- SO A REPLAY PASSES IT ON WHERE IT LIES
+static void put_text(cchar *str)
+{ put(str, strlen(str) + 1); }
+
+// a1 a2 a3 AS FOR emit_bin() -- text IS WHAT THE TM TEXT HAS AFTER THE
+// LOCATION, OR FOR AN INSTRUCTION TO RELOCATE, ITS NOTE
+static void record(int code, int a1, int a2, int a3, cchar *text)
+{
+	rec_insn in;
+	if ((uint) a1 > UINT8_MAX || (uint) a3 > UINT8_MAX) {
+		is_recording = false;				// NOT A REGISTER -- KEEP NOTHING
+		return ;
+	}
+	memset(&in, 0, sizeof(in));
+	in.op = code;
+	in.a1 = a1;
+	in.a3 = a3;
+	in.reloc = rec_reloc;
+	in.a2 = rec_reloc == RELOC_SELF ? a2 - (int) rec_base : a2;
+	in.loc = emit_loc - rec_base;
+	put(&(char) {EV_INSN}, 1);
+	put(&in, sizeof(in));
+	if (rec_reloc == RELOC_CALL)
+		put_text(rec_callee);
+	if (text != NULL)
+		put_text(text);
+}
+
+void emit_record(uint base, uint line)
+{
+	is_recording = true;
+	rec_base = base;
+	rec_line = line;
+	rec_size = 0;
+}
+
+char *emit_recorded(size_t *len)
+{
+	char *done = NULL;
+	put(&(char) {EV_END}, 1);
+	put_int(high_emit_loc - rec_base);
+	if (is_recording) {
+		done = rec;
+		*len = rec_size;
+	}
+	else
+		free(rec);
+	rec = NULL;
+	rec_size = rec_room = 0;
+	is_recording = false;
+	return done;
+}
+
+// READ n BYTES OF THE RECORD AT *p -- FALSE PAST end
+static bool get(cchar **p, cchar *end, void *to, size_t n)
+{
+	if ((size_t) (end - *p) < n)
+		return false;
+	memcpy(to, *p, n);
+	*p += n;
+	return true;
+}
+
+static bool get_text(cchar **p, cchar *end, cchar **str)
+{
+	cchar *nul = memchr(*p, '\0', end - *p);
+	if (nul == NULL)
+		return false;
+	*str = *p;
+	*p = nul + 1;
+	return true;
+}
+
+// "%03d:" OF loc AT to -- RETURNS ITS LENGTH
+static size_t put_loc(char *to, uint loc)
+{
+	char digit[LOC_MAX];
+	size_t n = 0, len;
+	do
+		digit[n++] = '0' + loc % 10;
+	while ((loc /= 10) != 0);
+	while (n < 3)
+		digit[n++] = '0';
+	for (len = 0; n > 0; len++)
+		to[len] = digit[--n];
+	to[len++] = ':';
+	return len;
+}
+
+// ONCE TO CHECK ALL OF rec, ONCE TO EMIT IT -- SO A BROKEN ONE EMITS
+// NOTHING -- WHAT NEEDN'T MOVE IS COPIED AS IT WAS EMITTED
+bool emit_replay(cchar *rec, size_t len, uint base, uint line, int (*loc_of)(cchar *, uint))
+{
+	int32_t size = -1;
+	char chunk[CHUNK];				// OF TM TEXT, WRITTEN AT ONCE
+	size_t used = 0;
+	for (tint pass = 0; pass < 2; pass++) {
+		cchar *p = rec, *end = rec + len;
+		bool is_done = false;
+		if (pass == 1 && target == TG_TMB && !reserve_code(base + size))
+			return false;
+		while (p < end && !is_done) {
+			char ev = *p++;
+			int32_t a2, n;
+			size_t n_text;
+			rec_insn in;
+			cchar *callee, *text = NULL;
+			switch (ev) {
+				case EV_LINE:
+					if (!get(&p, end, &n, sizeof(n)))
+						return false;
+					if (pass == 1)
+						cur_line = line + n;
+				break;
+				
+				case EV_INSN:
+					if (!get(&p, end, &in, sizeof(in)) || in.op >= RA_LIM)
+						return false;
+					a2 = in.a2;
+					if (in.reloc == RELOC_SELF)
+						a2 += base;
+					else if (in.reloc == RELOC_CALL) {
+						if (!get_text(&p, end, &callee) ||
+							(a2 = loc_of(callee, strlen(callee))) < 0)
+							return false;
+					}
+					if (target != TG_TMB &&
+						(!get_text(&p, end, &text) || strlen(text) >= TEXT_MAX))
+						return false;
+					if (pass == 0)
+						break;
+					if (target == TG_TMB) {
+						store_bin(base + in.loc, in.op, in.a1, a2, in.a3);
+						break;
+					}
+					n_text = strlen(text);
+					if (used + LOC_MAX + n_text > CHUNK || in.reloc != RELOC_NONE) {
+						fwrite(chunk, 1, used, out);
+						used = 0;
+					}
+					if (in.reloc != RELOC_NONE) {
+						emit_loc = base + in.loc;
+						emit_rm(opcode_map[in.op], in.a1, a2, in.a3, text);
+					}
+					else {
+						used += put_loc(chunk + used, base + in.loc);
+						memcpy(chunk + used, text, n_text);
+						used += n_text;
+					}
+				break;
+				
+				case EV_NOTE:
+					if (!get_text(&p, end, &text))
+						return false;
+					if (pass == 1) {
+						fwrite(chunk, 1, used, out);
+						used = 0;
+						emit_comment(text);
+					}
+				break;
+				
+				case EV_END:
+					if (!get(&p, end, &size, sizeof(size)) || size < 0)
+						return false;
+					if (pass == 1) {
+						emit_loc = base + size;
+						if (high_emit_loc < emit_loc)
+							high_emit_loc = emit_loc;
+					}
+					is_done = true;
+				break;
+				
+				default: return false;
+			}
+		}
+		if (!is_done)
+			return false;
+	}
+	fwrite(chunk, 1, used, out);
+	return true;
+}
+
+void emit_start(void)
+{
+	emit_loc = high_emit_loc = 0;
+	cur_line = data_words = 0;
+}
 
 inline void emit_comment(cchar *str)
-{ if (trace_code) fprintf(out, "* %s\n", str); }
+{
+	if (is_recording && trace_code) {
+		put(&(char) {EV_NOTE}, 1);
+		put_text(str);
+	}
+	if (trace_code && target == TG_TM) fprintf(out, "* %s\n", str);
+}
+
+void emit_line(uint line)
+{
+	if (is_recording) {
+		put(&(char) {EV_LINE}, 1);
+		put_int(line - rec_line);
+	}
+	cur_line = line;
+}
+
+void emit_data(uint words)
+{
+	data_words = words;
+	if (target == TG_TM)
+		fprintf(out, TM_STK_COMMENT "%u\n", words + TMB_STK_SLACK);
+}
+
+void emit_symbol(cchar *name, uint loc)
+{
+	uint len = strlen(name) + 1;
+	if (target != TG_TMB)
+		return;
+	if (!reserve((void **) &bin_sym, &sym_cap, sym_count + 1, sizeof(tmb_sym)) || 
+		!reserve((void **) &bin_str, &str_cap, str_size + len, 1))
+		return;
+	bin_sym[sym_count].loc = loc;
+	bin_sym[sym_count].name = str_size;
+	sym_count++;
+	memcpy(bin_str + str_size, name, len);
+	str_size += len;
+}
+
+// LAY OUT AND WRITE THE .tmb -- SEE tmb.h
+void emit_finish(void)
+{
+	tmb_header hd;
+	uint32_t pad = 0;
+	bool is_ok;
+	if (target != TG_TMB)
+		return;
+	if (!reserve_code(high_emit_loc))
+		return;
+	memset(&hd, 0, sizeof(hd));
+	memcpy(hd.magic, TMB_MAGIC, sizeof(hd.magic));
+	hd.version = TMB_VERSION;
+	hd.header_size = sizeof(hd);
+	hd.code_off = sizeof(hd);
+	hd.code_count = high_emit_loc;
+	hd.sym_off = hd.code_off + hd.code_count * sizeof(tmb_insn);
+	hd.sym_count = sym_count;
+	hd.line_off = hd.sym_off + sym_count * sizeof(tmb_sym);
+	hd.str_off = hd.line_off + hd.code_count * sizeof(uint32_t);
+	hd.str_size = str_size;
+	hd.stk_size = data_words + TMB_STK_SLACK;
+	
+	is_ok = fwrite(&hd, sizeof(hd), 1, out) == 1;
+	is_ok = is_ok && fwrite(bin_code, sizeof(tmb_insn), hd.code_count, out) == hd.code_count;
+	is_ok = is_ok && fwrite(bin_sym, sizeof(tmb_sym), sym_count, out) == sym_count;
+	is_ok = is_ok && fwrite(bin_line, sizeof(uint32_t), hd.code_count, out) == hd.code_count;
+	is_ok = is_ok && fwrite(bin_str, 1, str_size, out) == str_size;
+	// KEEP THE FILE A MULTIPLE OF 4 BYTES
+	is_ok = is_ok && fwrite(&pad, 1, -str_size & 3, out) == (-str_size & 3);
+	if (!is_ok)
+		PANIC(62, "Cannot write TM binary");
+	
+	free(bin_code);
+	free(bin_line);
+	free(bin_sym);
+	free(bin_str);
+	bin_code = NULL;
+	bin_line = NULL;
+	bin_sym = NULL;
+	bin_str = NULL;
+	bin_cap = sym_count = sym_cap = str_size = str_cap = 0;
+}
+
+// WRITES THE TM TEXT OF AN INSTRUCTION -- line IS WHAT FOLLOWS ITS
+// LOCATION, TO WHICH THE NOTE c AND THE NEWLINE ARE ADDED
+static void emit_text(cchar *op, int a1, int a2, int a3, char *line, cchar *c)
+{
+	size_t n = strlen(line), room = TEXT_MAX - 1 - n;
+	if (trace_code) {
+		size_t wrote = snprintf(line + n, room, "\t\t%s", c);
+		n += wrote < room ? wrote : room - 1;
+	}
+	strcpy(line + n, "\n");
+	if (is_recording)
+		record(opcode_of(op), a1, a2, a3, rec_reloc == RELOC_NONE ? line : trace_code ? c : "");
+	fprintf(out, "%03d:%s", emit_loc++, line);
+	if (high_emit_loc < emit_loc)
+		high_emit_loc = emit_loc;
+}
 
 void emit_ro(cchar *op, int r, int s, int t, cchar *c)
 {
+	char line[TEXT_MAX];
+	if (target == TG_TMB) {
+		emit_bin(op, r, s, t);
+		if (high_emit_loc < ++emit_loc)
+			high_emit_loc = emit_loc;
+		return;
+	}
 	if (debug_flag)
-		fprintf(out, "%03d:  %-5s  %d,%s,%s ", emit_loc++, op, reg_map[r], reg_map[s], reg_map[t]);
+		snprintf(line, LENGTH, "  %-5s  %d,%s,%s ", op, reg_map[r], reg_map[s], reg_map[t]);
 	else
-		fprintf(out, "%03d:  %-5s  %d,%d,%d ", emit_loc++, op, r, s, t);
-	if (trace_code)
-		fprintf(out, "\t\t%s", c);
-	fprintf(out, "\n");
-	if (high_emit_loc < emit_loc)
-		high_emit_loc = emit_loc;
+		snprintf(line, LENGTH, "  %-5s  %d,%d,%d ", op, r, s, t);
+	emit_text(op, r, s, t, line, c);
 }
 
 void emit_rm(cchar * op, int r, int d, int s, cchar *c)
 {
+	char line[TEXT_MAX];
+	if (target == TG_TMB) {
+		emit_bin(op, r, d, s);
+		if (high_emit_loc < ++emit_loc)
+			high_emit_loc = emit_loc;
+		return;
+	}
 	if (debug_flag)
-		fprintf(out, "%03d:  %-5s  %s,%d(%s) ", emit_loc++, op, reg_map[r], d, reg_map[s]);
+		snprintf(line, LENGTH, "  %-5s  %s,%d(%s) ", op, reg_map[r], d, reg_map[s]);
 	else
-		fprintf(out, "%03d:  %-5s  %d,%d(%d) ", emit_loc++, op, r, d, s);
-	if (trace_code)
-		fprintf(out, "\t\t%s", c);
-	fprintf(out, "\n");
-	if (high_emit_loc < emit_loc)
-		high_emit_loc = emit_loc;
+		snprintf(line, LENGTH, "  %-5s  %d,%d(%d) ", op, r, d, s);
+	emit_text(op, r, d, s, line, c);
 }
 
 uint emit_skip(uint steps)
@@ -65,15 +486,31 @@ inline void emit_restore(void)
 
 void emit_rm_abs(cchar *op, int r, int a, cchar *c)
 {
+	char line[TEXT_MAX];
+	if (target == TG_TMB) {
+		emit_bin(op, r, a-(emit_loc+1), PC);
+		if (high_emit_loc < ++emit_loc)
+			high_emit_loc = emit_loc;
+		return;
+	}
 	if (debug_flag)
-		fprintf(out, "%03d:  %-5s  %s,%d(%s) ",
-			emit_loc, op, reg_map[r], a-(emit_loc+1), reg_map[PC]);
+		snprintf(line, LENGTH, "  %-5s  %s,%d(%s) ", op, reg_map[r], a-(emit_loc+1), reg_map[PC]);
 	else
-		fprintf(out, "%03d:  %-5s  %d,%d(%d) ", 
-			emit_loc, op, r, a-(emit_loc+1), PC);
- 	++emit_loc;
-	if (trace_code) fprintf(out, "\t\t%s", c);
-	fprintf(out, "\n");
-	if (high_emit_loc < emit_loc)
-		high_emit_loc = emit_loc;
+		snprintf(line, LENGTH, "  %-5s  %d,%d(%d) ", op, r, a-(emit_loc+1), PC);
+	emit_text(op, r, a-(emit_loc+1), PC, line, c);
+}
+
+void emit_jump(uint loc, cchar *c)
+{
+	rec_reloc = RELOC_SELF;
+	emit_rm("LDC", PC, loc, 0, c);
+	rec_reloc = RELOC_NONE;
+}
+
+void emit_call(cchar *name, uint loc, cchar *c)
+{
+	rec_reloc = RELOC_CALL;
+	rec_callee = name;
+	emit_rm("LDC", PC, loc, 0, c);
+	rec_reloc = RELOC_NONE;
 }
@@ -13,9 +13,25 @@
 
 #define TP 5		// TEMP POINTER
 
+// STARTS A NEW PROGRAM AT LOCATION 0 -- WRITTEN TO out
+void emit_start(void);
+
 // EMITS A COMMENT INTO CODE FILE
 void emit_comment(cchar *);
 
+// SOURCE LINE OF THE INSTRUCTIONS EMITTED NEXT -- .tmb ONLY
+void emit_line(uint);
+
+// WORDS OF GLOBALS BELOW BP -- SIZES THE STACK, IN THE .tmb HEADER OR
+// IN A TM_STK_COMMENT OF A .tm
+void emit_data(uint words);
+
+// RECORDS A FUNCTION NAMED name STARTING AT loc -- .tmb ONLY
+void emit_symbol(cchar *name, uint loc);
+
+// WRITES THE BUFFERED .tmb IMAGE -- NOTHING FOR TEXT OUTPUT
+void emit_finish(void);
+
 // emit_ro() EMITS A REGISTER-ONLY TVM INSTRUCTION
 // op		OPCODE
 //  r		TAR REGISTER
@@ -48,4 +64,23 @@ void emit_restore(void);
 //  a		ABSOLUTE LOCATION IN MEMORY
 void emit_rm_abs(cchar *op, int r, int a, cchar *);
 
+// emit_rm("LDC", PC, loc, ...) -- A JUMP TO loc IN THE SAME FUNCTION
+void emit_jump(uint loc, cchar *);
+
+// emit_rm("LDC", PC, loc, ...) -- A CALL OF name, WHICH STARTS AT loc
+void emit_call(cchar *name, uint loc, cchar *);
+
+// KEEPS WHAT IS EMITTED FROM NOW ON FOR THE FUNCTION STARTING AT base
+// ON line -- TILL emit_recorded() HANDS IT OVER, malloc()'D -- NULL IF
+// MEMORY RAN OUT
+void emit_record(uint base, uint line);
+
+char *emit_recorded(size_t *);
+
+// EMITS THE len BYTES OF A RECORD AGAIN FOR THE FUNCTION NOW STARTING
+// AT base ON line -- loc_of() GIVES WHERE THE FUNCTION OF A NAME STARTS
+// NOW, OR -1 -- FALSE, HAVING EMITTED NOTHING, IF IT CAN'T BE REPLAYED
+// -- A RECORD ONLY REPLAYS FOR THE target AND trace_code IT WAS MADE FOR
+bool emit_replay(cchar *, size_t, uint base, uint line, int (*loc_of)(cchar *, uint));
+
 #endif
@@ -13,16 +13,37 @@
 	"Parts borrowed from Ben Fowler's C- compiler project\n\n"
 
 #define USAGE													\
-	"Usage: cm [options] -f file\n"								\
+	"Usage: cm [options] -f file [-f file ...]\n"				\
+	"       cm [-j threads] --serve socket\n"					\
+	"       cm --cache dir --cache-stats\n"					\
 	"Options: \n"												\
 	"   -h     Display this information\n"						\
+	"   -q     Quiet -- no listing but what the options below ask\n" \
 	"   -e     Echo the source code as parsing proceeds\n" 		\
 	"   -s     Display lexeme occured for debug output\n" 		\
 	"   -p     Display parser debug output information\n" 		\
 	"   -a     Display semantic analyzer debug information\n" 	\
 	"   -c     Display code generation debug information\n" 	\
-	"   -f     Specify which file do you want to compile\n\n" 	\
-	"Note that -f option cannot be omitted\n"
+	"   -m     Display memory taken by each phase and how\n"	\
+	"          full the symbol table got\n"						\
+	"   -f     Specify which file do you want to compile\n" 	\
+	"   -F     Compile each file listed in this one, a line each\n" \
+	"   -j     Threads to compile many files on, 0 for one per\n"	\
+	"          CPU -- each file then lists to file.lst, with -q\n"	\
+	"          only if it fails\n"								\
+	"   -t     Output target: tm (text, default), tmb (binary)\n"	\
+	"          x86 (x86-64 assembly, link with cc) or c (C99)\n" \
+	"   --serve  Compile for clients of cmc on this Unix socket,\n" \
+	"          on -j threads, till SIGINT or SIGTERM\n"		\
+	"   --cache  Reuse the code of identical compilations kept in\n" \
+	"          this directory, shared by any number of cm's\n"	\
+	"   --cache-max  Megabytes the cache holds (64) -- the least\n" \
+	"          recently used code goes first\n"				\
+	"   --cache-stats  Show its hits, misses and size on stderr\n" \
+	"   --incremental  With --cache, also reuse the code of each\n" \
+	"          function (tm, tmb) that hasn't changed since the\n" \
+	"          last compilation of the same file\n\n"			\
+	"Note that -f (or -F) option cannot be omitted\n"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -51,16 +72,21 @@ typedef enum token_t {
 
 extern cchar *token_map[];	// FROM utils.c
 
-// THOSE EXTERNAL VARIBLES IMPORTED FROM `main.c'
-extern FILE* src;				// SOURCE CODE
-extern FILE* lst;				// LISTING OUTPUT
-extern FILE* out;				// CODE FOR VM
+// THOSE EXTERNAL VARIBLES IMPORTED FROM `libcm.c' -- ONE OF EACH PER
+// THREAD SO CONTEXTS ON THREADS OF THEIR OWN COMPILE AT ONCE
+extern __thread FILE* lst;		// LISTING OUTPUT
+extern __thread FILE* out;		// CODE FOR VM
 
-extern uint lineno;				// SOURCE LINE-NO FOR LISTING
-extern uint linecol;
+// OUTPUT FORMAT OF THE CODE GENERATOR
+typedef enum { TG_TM, TG_TMB, TG_X86, TG_C } target_k;
+
+extern __thread target_k target;	// SET BY -t
+
+extern __thread uint lineno;		// SOURCE LINE-NO FOR LISTING
+extern __thread uint linecol;
 
 #define LENGTH 128
-char median[LENGTH];			// COOPERATE WITH PANIC()
+extern __thread char median[LENGTH];	// COOPERATE WITH PANIC() -- FROM utils.c
 
 #define PANIC(ERRNO, MSG)		 				\
 	fprintf( 									\
@@ -80,50 +106,79 @@ typedef enum { ET_VOID, ET_INT, ET_BOOL, ET_ARR, ET_FUNC } expr_t;
 
 #define MAX_CHILDS 3			// ALL USED IFF. stmt_k IS S_IF
 
+typedef uint nid_t;				// INDEX OF A NODE -- 0 IS NO NODE
+
+typedef uint ident_t;			// INTERNED IDENTIFIER -- 0 IS NONE
+
+// ONLY WHAT THE PASSES READ OVER AND OVER -- LINKS ARE 32-BIT INDICES
+// AND THE KINDS AND TYPES A BYTE EACH -- THE LINE AND THE NAME OF A
+// NODE ARE COLD AND KEPT APART IN node_line[] AND node_ident[]
 typedef struct node_t {
-	struct node_t *child[MAX_CHILDS];
-	struct node_t *sibling;
+	nid_t child[MAX_CHILDS];
+	nid_t sibling;
+	nid_t declaration;		// TYPE-CHECKER MARK
 	
-	uint lineno;
-	node_k nodekind;
+	int val;		// NOT ONLY FOR int, ALSO FOR DIMENSION OF int[]
+	
+	// HERE'RE TWO CGEN-RELATED THINGS LEFTED
+	uint offset;		// VAR OFFSET IN STACK OR FUNC LOCATION IN INST[]
+	uint local_size;
+	
+	tint nodekind;			// node_k
 	
 	union {
-		decl_k decl;
-		stmt_k stmt;
-		expr_k expr;
+		tint decl;			// decl_k
+		tint stmt;			// stmt_k
+		tint expr;			// expr_k
 	} whichkind;
 	
-	token_t op;
-	int val;		// NOT ONLY FOR int, ALSO FOR DIMENSION OF int[]
-	char *name;
+	tint op;				// token_t
 	
-	union {
-		expr_t func_ret_type;
-		expr_t var_data_type;
+	union {					// expr_t
+		tint func_ret_type;
+		tint var_data_type;
 	};
 	
-	// TYPE-CHECKER MARKS
-	struct node_t *declaration;
-	expr_t expr_type;
+	tint expr_type;			// expr_t -- TYPE-CHECKER MARK
 	
-	bool is_parameter;
-	bool is_global;
-	
-	// HERE'RE TWO CGEN-RELATED THINGS LEFTED
-    uint offset;        // VAR OFFSET IN STACK OR FUNC LOCATION IN INST[]
-	uint local_size;
+	tint is_parameter;
+	tint is_global;
 } node_t;
 
-extern bool echo_source;
+// THE NODES OF THE COMPILATION -- FROM utils.c -- ALL THREE
+// ARRAYS ARE INDEXED BY nid_t
+extern __thread node_t *node_pool;
+extern __thread uint *node_line;
+extern __thread ident_t *node_ident;
+
+#define NODE(i)			((i) ? node_pool + (i) : NULL)
+
+static inline nid_t node_id(const node_t *t)
+{ return t ? (nid_t) (t - node_pool) : 0; }
+
+#define CHILD(t, i)		NODE((t)->child[i])
+#define SIBLING(t)		NODE((t)->sibling)
+#define DECL_OF(t)		NODE((t)->declaration)
+
+#define LINE(t)			node_line[(t) - node_pool]
+#define IDENT(t)		node_ident[(t) - node_pool]
+#define NAME(t)			ident_name(IDENT(t))
+
+// SPELLING OF AN IDENTIFIER -- FROM intern.c
+cchar *ident_name(ident_t);
+
+extern __thread bool echo_source;
+
+extern __thread bool trace_scan;
 
-extern bool trace_scan;
+extern __thread bool trace_parse;
 
-extern bool trace_parse;
+extern __thread bool trace_analyze;
 
-extern bool trace_analyze;
+extern __thread bool trace_code;
 
-extern bool trace_code;
+extern __thread bool trace_memory;
 
-extern bool is_error;
+extern __thread bool is_error;	// analyze() GATHERS ITS THREADS' ONES
 
 #endif
@@ -0,0 +1,234 @@
+#include <stdint.h>
+#include "globals.h"
+#include "libcm.h"
+#include "cache.h"
+#include "incr.h"
+
+// A PACK -- THE ENTRY OF A SOURCE -- IS A COUNT, THEN FOR EACH FUNCTION
+// THE LENGTHS OF ITS PRINT AND ITS RECORD, THE PRINT AND THE RECORD --
+// IT IS KEYED BY THE NAME, THE TARGET AND -c, IN A SPACE OF KEYS OF ITS
+// OWN
+#define PACK_FLAG		(1u << 31)
+
+typedef struct piece_t {
+	uint64_t hash;			// OF THE PRINT -- 0 FOR AN EMPTY SLOT
+	cchar *print;
+	cchar *rec;
+	uint32_t print_len;
+	uint32_t rec_len;
+} piece_t;
+
+typedef struct buf_t {
+	char *p;
+	size_t size, room;
+} buf_t;
+
+static __thread bool is_on = false;
+static __thread bool is_broken = false;		// NOTHING OF IT IS KEPT
+static __thread char *old = NULL;			// THE PACK FETCHED
+static __thread piece_t *table = NULL;		// OVER IT
+static __thread uint table_mask = 0;
+static __thread buf_t pack = {NULL, 0, 0};	// THE PACK BEING MADE
+static __thread buf_t print = {NULL, 0, 0};	// OF THE FUNCTION LOOKED UP
+static __thread cchar *found = NULL;		// ITS RECORD IN old
+static __thread uint reused = 0, total = 0;
+
+static bool grow(buf_t *b, size_t n)
+{
+	size_t room = b->room ? 2 * b->room : 4096;
+	char *more;
+	while (room < b->size + n)
+		room *= 2;
+	if ((more = realloc(b->p, room)) == NULL)
+		return false;
+	b->p = more;
+	b->room = room;
+	return true;
+}
+
+static inline bool put(buf_t *b, const void *p, size_t n)
+{
+	if (b->size + n > b->room && !grow(b, n))
+		return false;
+	memcpy(b->p + b->size, p, n);
+	b->size += n;
+	return true;
+}
+
+static inline bool put_int(buf_t *b, int32_t v)
+{ return put(b, &v, sizeof(v)); }
+
+static bool put_name(buf_t *b, node_t *t)
+{
+	cchar *name = ident_name(IDENT(t));
+	return put(b, name, strlen(name) + 1);
+}
+
+// A WORD AT A TIME -- PRINTS ARE LONG AND EACH IS HASHED AGAIN ON EVERY
+// COMPILATION -- AN EQUAL HASH IS CHECKED BYTE FOR BYTE ANYWAY
+static uint64_t hash_of(cchar *p, size_t n)
+{
+	uint64_t h = n, w;
+	for (; n >= sizeof(w); p += sizeof(w), n -= sizeof(w)) {
+		memcpy(&w, p, sizeof(w));
+		h = ((h << 5 | h >> 59) ^ w) * 0x9e3779b97f4a7c15u;
+	}
+	for (; n > 0; p++, n--)
+		h = ((h << 5 | h >> 59) ^ (unsigned char) *p) * 0x9e3779b97f4a7c15u;
+	h ^= h >> 32;
+	return h | 1;						// NEVER AN EMPTY SLOT
+}
+
+// EVERYTHING OF A NODE cgen.c READS -- ITS LINE AS FROM THE FUNCTION'S
+// SO A FUNCTION THAT ONLY MOVED PRINTS THE SAME -- A NAME ONLY WHERE IT
+// GOES INTO THE CODE, WHICH IS FOR A FUNCTION AND A CALL
+static bool print_chain(node_t *t, node_t *fn)
+{
+	for (; t != NULL; t = SIBLING(t)) {
+		node_t *decl = DECL_OF(t);
+		tint kind[5] = {t->nodekind, t->whichkind.decl, t->op, t->is_parameter, t->is_global};
+		bool is_call = t->nodekind == N_STMT && t->whichkind.stmt == S_CALL;
+		bool is_ok = put(&print, kind, sizeof(kind)) && put_int(&print, t->val) &&
+			put_int(&print, LINE(t) - LINE(fn));
+		if (is_ok && t->nodekind == N_DECL && t->whichkind.decl != D_FUN)
+			is_ok = put_int(&print, t->offset);
+		if (is_ok && t == fn)
+			is_ok = put_int(&print, t->local_size);
+		if (is_ok && (t == fn || is_call))
+			is_ok = put_name(&print, t);
+		if (is_ok && decl != NULL) {	// A FUNCTION'S START IS RELOCATED
+			bool is_fun = decl->nodekind == N_DECL && decl->whichkind.decl == D_FUN;
+			tint of[4] = {decl->nodekind, decl->whichkind.decl, decl->is_parameter, decl->is_global};
+			is_ok = put(&print, of, sizeof(of)) &&
+				put_int(&print, is_fun ? decl->local_size : decl->offset) &&
+				(!is_fun || put_name(&print, decl));
+		}
+		for (tint i = 0; is_ok && i < MAX_CHILDS; i++)	// AND ITS END
+			is_ok = print_chain(CHILD(t, i), fn) && put(&print, &(tint) {UINT8_MAX}, 1);
+		if (!is_ok || t == fn)
+			return is_ok;
+	}
+	return true;
+}
+
+// INDEXES THE PIECES OF old -- NONE IF IT DOESN'T HOLD TOGETHER
+static void index_old(size_t len)
+{
+	cchar *p = old, *end = old + len;
+	uint32_t n, word[2];
+	if (len < sizeof(n))
+		return ;
+	memcpy(&n, p, sizeof(n));
+	p += sizeof(n);
+	if (n > len / sizeof(word))
+		return ;
+	for (table_mask = 15; table_mask < 2 * n; table_mask = 2 * table_mask + 1)
+		continue;
+	if ((table = calloc(table_mask + 1, sizeof(piece_t))) == NULL)
+		return ;
+	for (uint32_t i = 0; i < n; i++) {
+		piece_t piece;
+		uint h;
+		if ((size_t) (end - p) < sizeof(word))
+			break;
+		memcpy(word, p, sizeof(word));
+		p += sizeof(word);
+		if ((size_t) (end - p) < (size_t) word[0] + word[1])
+			break;
+		piece = (piece_t) {hash_of(p, word[0]), p, p + word[0], word[0], word[1]};
+		p += word[0] + word[1];
+		for (h = piece.hash & table_mask; table[h].hash != 0; h = (h + 1) & table_mask)
+			continue;
+		table[h] = piece;
+	}
+}
+
+static void key_of(cache_key_t *key, cchar *name)
+{
+	key->target = target;
+	key->flags = (trace_code ? CM_LIST_CODE : 0) | PACK_FLAG;
+	key->name = NULL;
+	key->src = name;
+	key->src_len = strlen(name);
+	cache_key(key);
+}
+
+void incr_open(cchar *dir, cchar *name)
+{
+	cache_key_t key;
+	size_t len;
+	uint lines;
+	key_of(&key, name);
+	is_on = true;
+	is_broken = false;
+	reused = total = 0;
+	pack.size = 0;
+	if (!put_int(&pack, 0))
+		is_broken = true;
+	if ((old = cache_fetch(dir, &key, &len, &lines, false)) != NULL)
+		index_old(len);
+}
+
+void incr_close(cchar *dir, size_t max, cchar *name, bool keep)
+{
+	if (keep && !is_broken) {
+		cache_key_t key;
+		key_of(&key, name);
+		memcpy(pack.p, &total, sizeof(uint32_t));
+		cache_store(dir, max, &key, pack.p, pack.size, 0, false);
+	}
+	free(old);
+	free(table);
+	free(pack.p);
+	free(print.p);
+	old = NULL;
+	table = NULL;
+	table_mask = 0;
+	pack = print = (buf_t) {NULL, 0, 0};
+	found = NULL;
+	is_on = false;
+}
+
+bool incr_is_on(void)
+{ return is_on; }
+
+cchar *incr_lookup(node_t *fn, size_t *len)
+{
+	uint64_t hash;
+	found = NULL;
+	print.size = 0;
+	if (!print_chain(fn, fn)) {
+		is_broken = true;
+		return NULL;
+	}
+	if (table == NULL)
+		return NULL;
+	hash = hash_of(print.p, print.size);
+	for (uint h = hash & table_mask; table[h].hash != 0; h = (h + 1) & table_mask)
+		if (table[h].hash == hash && table[h].print_len == print.size &&
+			memcmp(table[h].print, print.p, print.size) == 0) {
+			*len = table[h].rec_len;
+			return found = table[h].rec;
+		}
+	return NULL;
+}
+
+void incr_keep(cchar *rec, size_t len)
+{
+	total++;
+	if (rec == NULL) {
+		is_broken = true;
+		return ;
+	}
+	if (rec == found)
+		reused++;
+	if (!put_int(&pack, print.size) || !put_int(&pack, len) ||
+		!put(&pack, print.p, print.size) || !put(&pack, rec, len))
+		is_broken = true;
+}
+
+void incr_counts(uint *r, uint *t)
+{
+	*r = reused;
+	*t = total;
+}
@@ -0,0 +1,31 @@
+#ifndef _INCR_H_
+#define _INCR_H_
+
+#include "globals.h"
+
+// THE CODE OF EACH FUNCTION OF A SOURCE, KEPT IN THE CACHE AS ONE ENTRY
+// PER SOURCE NAME -- A FUNCTION IS KNOWN BY A PRINT OF ITS TREE AND OF
+// WHAT IT USES FROM OUTSIDE (THE GLOBALS' OFFSETS, THE CALLEES' FRAMES)
+// SO ONE THAT PRINTS THE SAME EMITS THE SAME CODE, MOVED TO WHERE IT
+// STARTS NOW -- ONLY cgen.c ASKS
+
+// FETCHES WHAT THE LAST COMPILATION OF name KEPT IN dir
+void incr_open(cchar *dir, cchar *name);
+
+// KEEPS WHAT THIS COMPILATION GAVE FOR THE NEXT ONE -- IF keep
+void incr_close(cchar *dir, size_t max, cchar *name, bool keep);
+
+bool incr_is_on(void);
+
+// THE RECORD OF code.h KEPT FOR A FUNCTION THAT PRINTED AS fn DOES --
+// ITS OFFSETS AND local_size SET -- NULL IF THERE'S NONE
+cchar *incr_lookup(node_t *fn, size_t *);
+
+// KEEPS THE RECORD OF THE FUNCTION LAST LOOKED UP -- NULL IF THERE'S
+// NONE, WHICH KEEPS NOTHING OF THIS COMPILATION
+void incr_keep(cchar *, size_t);
+
+// FUNCTIONS REPLAYED AND ALL OF THEM, SINCE incr_open()
+void incr_counts(uint *reused, uint *total);
+
+#endif
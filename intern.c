@@ -0,0 +1,172 @@
+// ERRNO: [101, 110]
+#include "globals.h"
+#include "intern.h"
+#include "arena.h"
+
+// EACH DISTINCT IDENTIFIER ONCE -- ITS NAME IN THE ARENA AND ITS HASH
+// AND LENGTH BESIDE IT -- slot[] MAPS A HASH TO THE ident_t BY
+// LINEAR PROBING AND IS KEPT AT MOST HALF FULL
+struct intern_t {
+	cchar **names;
+	uint *hashes;
+	uint *lens;
+	uint n_idents;
+	uint n_room;
+	
+	ident_t *slot;
+	uint slot_mask;
+};
+
+// THE TABLE OF THE COMPILATION ON THIS THREAD -- OR THE ONE ADOPTED
+static __thread intern_t own;
+static __thread intern_t *in;
+
+#define SLOTS_MIN 1024
+
+static bool grow_slots(void)
+{
+	uint size = in->slot ? 2 * (in->slot_mask + 1) : SLOTS_MIN;
+	ident_t *grown = calloc(size, sizeof(ident_t));
+	if (grown == NULL)
+		return false;
+	for (ident_t id = 1; id < in->n_idents; id++) {
+		uint i = in->hashes[id] & (size - 1);
+		while (grown[i] != ID_NONE)
+			i = (i + 1) & (size - 1);
+		grown[i] = id;
+	}
+	free(in->slot);
+	in->slot = grown;
+	in->slot_mask = size - 1;
+	return true;
+}
+
+static bool grow_idents(void)
+{
+	uint room = in->n_room ? 2 * in->n_room : SLOTS_MIN / 2;
+	cchar **nn = realloc(in->names, room * sizeof(cchar *));
+	if (nn != NULL)
+		in->names = nn;
+	uint *nh = realloc(in->hashes, room * sizeof(uint));
+	if (nh != NULL)
+		in->hashes = nh;
+	uint *nl = realloc(in->lens, room * sizeof(uint));
+	if (nl != NULL)
+		in->lens = nl;
+	if (nn == NULL || nh == NULL || nl == NULL)
+		return false;
+	in->n_room = room;
+	return true;
+}
+
+// PUTS name -- WHICH OUTLIVES THE TABLE -- IN AS THE NEXT ident_t AT
+// slot[i], WHERE THE PROBE FOR ITS hash ENDED
+static ident_t insert(cchar *name, uint len, uint hash, uint i)
+{
+	ident_t id;
+	if (in->n_idents == in->n_room && !grow_idents()) {
+		PANIC(101, "Memory exhausted in intern()");
+		return ID_NONE;
+	}
+	id = in->n_idents++;
+	in->names[id] = name;
+	in->hashes[id] = hash;
+	in->lens[id] = len;
+	in->slot[i] = id;
+	
+	if (2 * in->n_idents > in->slot_mask + 1 && !grow_slots())
+		PANIC(102, "Memory exhausted in intern()");
+	return id;
+}
+
+ident_t intern(cchar *s, uint len, uint hash)
+{
+	uint i = hash & in->slot_mask;
+	ident_t id;
+	char *name;
+	
+	for (; (id = in->slot[i]) != ID_NONE; i = (i + 1) & in->slot_mask)
+		if (in->hashes[id] == hash && in->lens[id] == len &&
+			memcmp(in->names[id], s, len) == 0)
+			return id;
+	
+	if ((name = arena_alloc(len + 1)) == NULL) {
+		PANIC(101, "Memory exhausted in intern()");
+		return ID_NONE;
+	}
+	memcpy(name, s, len);
+	name[len] = '\0';
+	return insert(name, len, hash, i);
+}
+
+// A TABLE NO BIGGER THAN THIS KEEPS ITS ARRAYS AND THE BUILTINS FOR
+// THE NEXT COMPILATION ON THE THREAD
+#ifndef INTERN_KEEP_MAX
+	#define INTERN_KEEP_MAX (64 * 1024)
+#endif
+
+bool intern_open(void)
+{
+	static cchar *builtin[] = {"input", "output", "_argument", "main"};
+	in = &own;
+	if (in->slot != NULL)				// WARM FROM THE LAST ONE
+		return true;
+	in->n_idents = 1;					// ID_NONE
+	if (!grow_idents() || !grow_slots())
+		return false;
+	in->names[ID_NONE] = "";
+	in->hashes[ID_NONE] = in->lens[ID_NONE] = 0;
+	for (uint i = 0; i < N_BUILTIN_IDENTS - 1; i++) {
+		uint len = strlen(builtin[i]);
+		uint hash = ident_hash_of(builtin[i], len);
+		uint at = hash & in->slot_mask;
+		while (in->slot[at] != ID_NONE)
+			at = (at + 1) & in->slot_mask;
+		insert(builtin[i], len, hash, at);
+	}
+	return true;
+}
+
+// THE BUILTINS WENT IN FIRST, SO NO PROBE FOR ONE OF THEM RUNS PAST A
+// SLOT OF A LATER NAME -- CLEARING ALL THOSE LEAVES THE BUILTINS FOUND
+void intern_close(void)
+{
+	if (in->slot_mask + 1 > INTERN_KEEP_MAX) {
+		intern_drop();
+		return ;
+	}
+	for (ident_t id = N_BUILTIN_IDENTS; id < in->n_idents; id++) {
+		uint i = in->hashes[id] & in->slot_mask;
+		while (in->slot[i] != id)
+			i = (i + 1) & in->slot_mask;
+		in->slot[i] = ID_NONE;
+	}
+	in->n_idents = N_BUILTIN_IDENTS;
+}
+
+void intern_drop(void)
+{
+	free(own.names);
+	free(own.hashes);
+	free(own.lens);
+	free(own.slot);
+	own.names = NULL;
+	own.hashes = own.lens = NULL;
+	own.slot = NULL;
+	own.n_idents = own.n_room = own.slot_mask = 0;
+}
+
+intern_t *intern_state(void)
+{ return in; }
+
+void adopt_intern(intern_t *table)
+{ in = table; }
+
+cchar *ident_name(ident_t id)
+{ return in->names[id]; }
+
+uint ident_hash(ident_t id)
+{ return in->hashes[id]; }
+
+uint ident_count(void)
+{ return in->n_idents - 1; }
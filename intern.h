@@ -0,0 +1,47 @@
+#ifndef _INTERN_H_
+#define _INTERN_H_
+
+#include "globals.h"
+
+// IDENTIFIERS intern_open() PUTS IN FIRST -- IN THIS ORDER
+enum {
+	ID_NONE, 			// NO IDENTIFIER
+	ID_INPUT, ID_OUTPUT, ID_ARGUMENT, ID_MAIN,
+	N_BUILTIN_IDENTS
+};
+
+// FNV-1a -- THE SCANNER HASHES EACH ID AS IT LEXES IT SO intern()
+// NEEDN'T READ THE NAME TWICE
+static inline uint ident_hash_of(cchar *s, uint len)
+{
+	uint h = 2166136261u;
+	for (uint i = 0; i < len; i++)
+		h = (h ^ (unsigned char) s[i]) * 16777619u;
+	return h;
+}
+
+typedef struct intern_t intern_t;
+
+bool intern_open(void);
+
+// FORGETS THE NAMES OF THE COMPILATION -- A SMALL TABLE KEEPS ITS
+// ARRAYS AND THE BUILTINS FOR THE NEXT intern_open() ON THE THREAD
+void intern_close(void);
+
+// FREES WHAT intern_close() KEPT
+void intern_drop(void);
+
+// THE ident_t OF THE len BYTES AT s -- A NEW ONE THE FIRST TIME
+ident_t intern(cchar *, uint, uint);
+
+uint ident_hash(ident_t);
+
+uint ident_count(void);
+
+// THE TABLE OF THIS THREAD'S COMPILATION -- A HELPER THREAD THAT ONLY
+// READS NAMES TAKES IT OVER WITH adopt_intern()
+intern_t *intern_state(void);
+
+void adopt_intern(intern_t *);
+
+#endif
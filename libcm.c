@@ -0,0 +1,499 @@
+// ERRNO: [111, 120]
+#define _DEFAULT_SOURCE		// open_memstream()
+#include <pthread.h>
+#include "globals.h"
+#include "libcm.h"
+
+// RVALUE OF #define CANNOT BE enum-TYPE
+// E.G. false AND true -- SO I MAKE BOTH
+// OF THEM INTO MACRO-TYPE WITH UPPER-CASE
+
+#ifndef FALSE
+	#define FALSE 0
+#endif
+#ifndef TRUE
+	#define TRUE 1
+#endif
+
+#define NO_PARSE	FALSE
+
+#define NO_ANALYZE 	FALSE
+
+#define NO_CODE 	FALSE
+
+#include "utils.h"
+#include "arena.h"
+#include "intern.h"
+#include "scan.h"
+#include "cache.h"
+#include "incr.h"
+
+#if NO_PARSE
+	#define BUILDTYPE "SCANNER ONLY"
+#else
+	#include "parse.h"
+	#if NO_ANALYZE
+		#define BUILDTYPE "SCANNER/PARSER ONLY"
+	#else
+		#include "analyze.h"
+		#if NO_CODE
+			#define BUILDTYPE "SCANNER/PARSER/ANALYZER ONLY"
+		#else
+			#define BUILDTYPE "COMPLETE COMPILER"
+			#include "cgen.h"
+			#include "x86gen.h"
+			#include "ccgen.h"
+		#endif
+	#endif
+#endif
+
+// WHAT A COMPILATION GOES BY -- SET FROM ITS cm_context ON THE THREAD
+// RUNNING IT
+__thread FILE* lst;					// LISTING OUTPUT
+__thread FILE* out;					// CODE FOR VM
+
+__thread uint lineno = 0;
+__thread uint linecol = 0;
+
+__thread bool echo_source 	= true;
+__thread bool trace_scan	= true;
+__thread bool trace_parse 	= true;
+__thread bool trace_analyze = true;
+__thread bool trace_code	= true;
+__thread bool trace_memory	= false;
+
+__thread bool is_error = false;
+
+__thread target_k target	= TG_TM;
+
+struct cm_context {
+	target_k target;
+	uint parts;				// CM_LIST_*
+	FILE *to;				// LISTING -- NULL TO KEEP IT IN lst_text
+
+	char *out_text;			// FROM cm_compile()
+	size_t out_size;
+	char *lst_text;
+	size_t lst_size;
+
+	char *cache;			// DIRECTORY -- NULL FOR NONE
+	size_t cache_max;
+	bool is_cached;			// THE LAST COMPILATION CAME FROM IT
+	bool is_incremental;	// KEEPS AND REUSES EACH FUNCTION IN IT
+};
+
+static cchar *suffix[] = {".tm", ".tmb", ".s", ".c"};
+static cchar *what[] = {"TM", "TM", "x86-64", "C"};
+
+// NODES, TOKENS, THE FIRST ARENA CHUNK AND THE NAME TABLE WITH ITS
+// BUILTINS OUTLIVE A COMPILATION SO THE NEXT ONE ON THE THREAD FINDS
+// THEM WARM -- THE KEY FREES THEM WHEN THE THREAD ENDS
+static pthread_once_t key_made = PTHREAD_ONCE_INIT;
+static pthread_key_t warm_key;
+static __thread bool is_warm = false;
+
+static void make_key(void);
+
+static void drop_warm(void *);
+
+static bool begin(cm_context *);
+
+static int run(cm_context *, cchar *, bool);
+
+static void key_of(cm_context *, cache_key_t *, cchar *, cchar *, size_t);
+
+static int replay(cm_context *, const cache_key_t *, cchar *, bool);
+
+static void keep(cm_context *, const cache_key_t *, cchar *, bool);
+
+static char *output_name(cchar *);
+
+static void end(cm_context *);
+
+cm_context *cm_open(void)
+{
+	cm_context *c = calloc(1, sizeof(cm_context));
+	if (c != NULL) {
+		c->target = TG_TM;
+		c->parts = CM_LIST_ALL;
+	}
+	return c;
+}
+
+void cm_close(cm_context *c)
+{
+	if (c == NULL)
+		return ;
+	free(c->out_text);
+	free(c->lst_text);
+	free(c->cache);
+	free(c);
+}
+
+void cm_set_target(cm_context *c, target_k tg)
+{ c->target = tg; }
+
+void cm_set_listing(cm_context *c, uint parts, FILE *to)
+{
+	c->parts = parts;
+	c->to = to;
+}
+
+bool cm_set_cache(cm_context *c, cchar *dir, size_t max)
+{
+	char *copy = NULL;
+	if (dir != NULL && (!cache_open(dir) || (copy = strdup(dir)) == NULL))
+		return false;
+	free(c->cache);
+	c->cache = copy;
+	c->cache_max = max;
+	return true;
+}
+
+void cm_set_incremental(cm_context *c, bool is_on)
+{ c->is_incremental = is_on; }
+
+bool cm_cached(cm_context *c)
+{ return c->is_cached; }
+
+int cm_compile(cm_context *c, cchar *name, cchar *src, size_t len)
+{
+	cache_key_t key;
+	int r = -1;
+	if (!begin(c))
+		return -1;
+	key_of(c, &key, name, src, len);
+	if (c->cache == NULL || (r = replay(c, &key, name, false)) < 0) {
+		if (!scan_open_text(src, len))
+			PANIC(112, "Memory exhausted for the tokens");
+		else if ((r = run(c, name, false)) == 0 && c->cache != NULL)
+			keep(c, &key, name, false);
+		scan_close();
+	}
+	if (r != 0) {					// NO HALF-WRITTEN CODE
+		free(c->out_text);
+		c->out_text = NULL;
+		c->out_size = 0;
+	}
+	end(c);
+	return r;
+}
+
+int cm_compile_file(cm_context *c, cchar *path)
+{
+	int r = -1;
+	FILE *src;
+	if (!begin(c))
+		return -1;
+	src = fopen(path, "r");
+	if (src == NULL || !scan_load(src)) {
+		sprintf(median, "Cannot open `%s'", path);
+		PANIC(1, median);
+	}
+	else if (c->cache == NULL) {
+		if (!scan_start())
+			PANIC(112, "Memory exhausted for the tokens");
+		else
+			r = run(c, path, true);
+	}
+	else {						// THE TEXT IS IN -- NONE OF IT LEXED YET
+		cache_key_t key;
+		size_t len;
+		cchar *text = scan_text(&len);
+		key_of(c, &key, path, text, len);
+		if ((r = replay(c, &key, path, true)) < 0) {
+			if (!scan_start())
+				PANIC(112, "Memory exhausted for the tokens");
+			else if ((r = run(c, path, true)) == 0)
+				keep(c, &key, path, true);
+		}
+	}
+	if (src != NULL) {
+		scan_close();
+		fclose(src);
+	}
+	end(c);
+	return r;
+}
+
+void cm_thread_done(void)
+{
+	if (!is_warm)
+		return ;
+	drop_warm(NULL);
+	pthread_setspecific(warm_key, NULL);
+}
+
+cchar *cm_output(cm_context *c, size_t *len)
+{
+	*len = c->out_size;
+	return c->out_text;
+}
+
+cchar *cm_listing(cm_context *c, size_t *len)
+{
+	*len = c->lst_size;
+	return c->lst_text;
+}
+
+static void make_key(void)
+{ pthread_key_create(&warm_key, drop_warm); }
+
+static void drop_warm(void *unused)
+{
+	(void) unused;
+	drop_nodes();
+	scan_drop();
+	arena_drop();
+	intern_drop();
+	is_warm = false;
+}
+
+// THE OPTIONS OF c FOR THIS THREAD -- AND NOTHING LEFT OF THE LAST
+// COMPILATION -- FALSE IF THERE'S NO LISTING TO WRITE TO
+static bool begin(cm_context *c)
+{
+	free(c->out_text);
+	free(c->lst_text);
+	c->out_text = c->lst_text = NULL;
+	c->out_size = c->lst_size = 0;
+
+	lst = c->to;
+	if (lst == NULL && (lst = open_memstream(&c->lst_text, &c->lst_size)) == NULL)
+		return false;
+
+	target			= c->target;
+	echo_source		= (c->parts & CM_LIST_ECHO) != 0;
+	trace_scan		= (c->parts & CM_LIST_SCAN) != 0;
+	trace_parse		= (c->parts & CM_LIST_PARSE) != 0;
+	trace_analyze	= (c->parts & CM_LIST_ANALYZE) != 0;
+	trace_code		= (c->parts & CM_LIST_CODE) != 0;
+	trace_memory	= (c->parts & CM_LIST_MEMORY) != 0;
+
+	lineno = linecol = 0;
+	is_error = false;
+	c->is_cached = false;
+
+	if (!is_warm) {
+		pthread_once(&key_made, make_key);
+		pthread_setspecific(warm_key, &is_warm);	// ANY NON-NULL WILL DO
+		is_warm = true;
+	}
+	return true;
+}
+
+static void end(cm_context *c)
+{
+	if (c->to == NULL)
+		fclose(lst);			// lst_text IS COMPLETE NOW
+	lst = NULL;
+}
+
+// NODES AND WHAT THE ARENA HANDED OUT SINCE THE LAST REPORT
+static void report_memory(cchar *phase, arena_stat_t *since, size_t *nodes)
+{
+	arena_stat_t now = arena_stats();
+	size_t used = nodes_used();
+	if (trace_memory)
+		fprintf(lst, "[*] Memory for %s: %zu node(s), %zu byte(s) in %zu allocation(s)\n",
+			phase, used - *nodes, now.bytes - since->bytes, now.count - since->count);
+	*since = now;
+	*nodes = used;
+}
+
+// THE SOURCE IS OPEN -- ITS CODE GOES TO A FILE NAMED AFTER IT OR, IF
+// NOT to_file, TO THE out_text OF c
+static int run(cm_context *c, cchar *name, bool to_file)
+{
+	node_t *syntax_tree;
+	arena_stat_t mark = {0, 0};
+	size_t nodes = 0;
+
+	if (!open_nodes(scan_max_tokens())) {
+		PANIC(8, "Memory exhausted for the syntax tree");
+		return -1;
+	}
+
+	if (!intern_open()) {
+		PANIC(9, "Memory exhausted for identifiers");
+		close_nodes();
+		return -1;
+	}
+
+	fprintf(lst, "Compiler built as " BUILDTYPE "\n");
+	fprintf(lst, "[*] C- COMPILATION: `%s'\n", name);
+
+#if NO_PARSE
+	while (get_token() != ENDFILE)
+		continue;
+#else
+	fprintf(lst, "[*] Parsing source code...\n");
+	syntax_tree = parse();
+	report_memory("parsing", &mark, &nodes);
+	if (trace_parse) {
+		fprintf(lst, "[*] Dumping syntax tree...\n");
+		print_tree(syntax_tree);
+	}
+	#if !NO_ANALYZE
+		if (!is_error) {
+			fprintf(lst, "[*] Building symbol table and checking types...\n");
+			analyze(syntax_tree);
+			report_memory("analysis", &mark, &nodes);
+		}
+		#if !NO_CODE
+			if (!is_error) {
+				char *outname = output_name(name);
+				if (outname != NULL) {
+					out = to_file ? fopen(outname, target == TG_TMB ? "wb" : "w") :
+						open_memstream(&c->out_text, &c->out_size);
+					if (out == NULL) {
+						sprintf(median, "Cannot open `%s'", outname);
+						PANIC(111, median);
+					}
+				}
+				if (!is_error) {
+					bool is_incremental = c->is_incremental && c->cache != NULL &&
+						(target == TG_TM || target == TG_TMB);
+					if (target == TG_X86)
+						x86_gen(syntax_tree, outname);
+					else if (target == TG_C)
+						cc_gen(syntax_tree, outname);
+					else if (is_incremental) {
+						uint reused, total;
+						incr_open(c->cache, name);
+						code_gen(syntax_tree);
+						incr_counts(&reused, &total);
+						incr_close(c->cache, c->cache_max, name, !is_error);
+						fprintf(lst, "[*] C- INCREMENTAL: %u of %u function(s) reused\n", reused, total);
+					}
+					else
+						code_gen(syntax_tree);
+					fclose(out);
+					out = NULL;
+					report_memory("code generation", &mark, &nodes);
+				}
+				if (!is_error) {
+					if (trace_code)
+						fprintf(lst, "[*] %s code generation done, no error\n", what[target]);
+					if (to_file)
+						fprintf(lst, "%s code written to `%s'\n", what[target], outname);
+					else
+						fprintf(lst, "%s code of `%s' kept in memory\n", what[target], outname);
+				}
+				free(outname);
+			}
+		#endif
+	#endif
+#endif
+
+	if (is_error)
+		fprintf(lst, "[!] ERROR ENCOUNTERED before %d:%d\n", lineno, linecol);
+	else
+		fprintf(lst, "COMPILATION COMPLETED for %d line(s)\n", lineno);
+
+	if (trace_memory) {
+		mark = arena_stats();
+		fprintf(lst, "[*] Memory in all: %zu node(s) of %zu byte(s), "
+			"%zu byte(s) in %zu allocation(s)\n", nodes_used(),
+			sizeof(node_t) + sizeof(uint) + sizeof(ident_t), mark.bytes, mark.count);
+	}
+	close_nodes();					// THE TREE AND SYMBOLS GO AT ONCE
+	intern_close();
+	arena_release();
+
+	return is_error ? 1 : 0;
+}
+
+// WHAT THE CODE OF name DEPENDS ON -- ITS NAME ONLY WHERE THE CODE
+// CARRIES IT
+static void key_of(cm_context *c, cache_key_t *key, cchar *name, cchar *src, size_t len)
+{
+	key->target = c->target;
+	key->flags = c->parts & CM_LIST_CODE;
+	key->name = c->target == TG_X86 || c->target == TG_C ? name : NULL;
+	key->src = src;
+	key->src_len = len;
+	if (c->cache != NULL)
+		cache_key(key);
+}
+
+static char *output_name(cchar *name)
+{
+	char *outname = malloc(strlen(name) + 5);
+	if (outname == NULL)
+		PANIC(113, "Memory exhausted in cm_compile()");
+	else
+		sprintf(outname, "%s%s", name, suffix[target]);
+	return outname;
+}
+
+// THE CODE OF AN IDENTICAL COMPILATION, IF THE CACHE HAS IT, AS IF
+// COMPILED NOW -- BUT LISTED IN SHORT, AS NO PHASE RAN -- RETURNS AS
+// run() OR -1 ON A MISS
+static int replay(cm_context *c, const cache_key_t *key, cchar *name, bool to_file)
+{
+	size_t len;
+	uint lines;
+	char *code = cache_fetch(c->cache, key, &len, &lines, true), *outname;
+	if (code == NULL)
+		return -1;
+	c->is_cached = true;
+	lineno = lines;
+	fprintf(lst, "Compiler built as " BUILDTYPE "\n");
+	fprintf(lst, "[*] C- COMPILATION: `%s'\n", name);
+	fprintf(lst, "[*] C- CACHE: code of an identical compilation, no phase run\n");
+	if ((outname = output_name(name)) == NULL)
+		;
+	else if (!to_file) {
+		c->out_text = code;
+		c->out_size = len;
+		code = NULL;
+		fprintf(lst, "%s code of `%s' kept in memory\n", what[target], outname);
+	}
+	else {
+		bool is_ok;
+		out = fopen(outname, target == TG_TMB ? "wb" : "w");
+		is_ok = out != NULL && fwrite(code, 1, len, out) == len;
+		if (out != NULL && fclose(out) != 0)
+			is_ok = false;
+		out = NULL;
+		if (is_ok)
+			fprintf(lst, "%s code written to `%s'\n", what[target], outname);
+		else {
+			sprintf(median, "Cannot write `%s'", outname);
+			PANIC(111, median);
+		}
+	}
+	free(outname);
+	free(code);
+	if (is_error)
+		fprintf(lst, "[!] ERROR ENCOUNTERED before %d:%d\n", lineno, linecol);
+	else
+		fprintf(lst, "COMPILATION COMPLETED for %d line(s)\n", lineno);
+	return is_error ? 1 : 0;
+}
+
+// THE CODE run() JUST GAVE GOES INTO THE CACHE -- FROM THE FILE IT WENT
+// TO OR FROM out_text
+static void keep(cm_context *c, const cache_key_t *key, cchar *name, bool to_file)
+{
+	char *outname, *code = NULL;
+	FILE *fp;
+	long len = -1;
+	if (!to_file) {
+		cache_store(c->cache, c->cache_max, key, c->out_text, c->out_size, lineno, true);
+		return ;
+	}
+	if ((outname = malloc(strlen(name) + 5)) == NULL)
+		return ;
+	sprintf(outname, "%s%s", name, suffix[target]);
+	if ((fp = fopen(outname, "rb")) != NULL) {
+		if (fseek(fp, 0, SEEK_END) == 0 && (len = ftell(fp)) >= 0 &&
+			fseek(fp, 0, SEEK_SET) == 0 && (code = malloc(len + 1)) != NULL &&
+			fread(code, 1, len, fp) == (size_t) len)
+			cache_store(c->cache, c->cache_max, key, code, len, lineno, true);
+		fclose(fp);
+	}
+	free(code);
+	free(outname);
+}
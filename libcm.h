@@ -0,0 +1,67 @@
+#ifndef _LIBCM_H_
+#define _LIBCM_H_
+
+#include "globals.h"
+
+// A COMPILER -- ITS OPTIONS AND WHAT ITS LAST COMPILATION GAVE -- A
+// CONTEXT IS USED BY ONE THREAD AT A TIME BUT ANY NUMBER OF THEM MAY
+// COMPILE AT ONCE, EACH ON A THREAD OF ITS OWN
+typedef struct cm_context cm_context;
+
+// PARTS OF THE LISTING -- OR'ED FOR cm_set_listing()
+enum {
+	CM_LIST_ECHO	= 1 << 0,		// -e
+	CM_LIST_SCAN	= 1 << 1,		// -s
+	CM_LIST_PARSE	= 1 << 2,		// -p
+	CM_LIST_ANALYZE	= 1 << 3,		// -a
+	CM_LIST_CODE	= 1 << 4,		// -c -- ALSO COMMENTS THE TM CODE
+	CM_LIST_MEMORY	= 1 << 5,		// -m
+	CM_LIST_ALL		= (1 << 5) - 1	// ALL BUT -m -- AS cm WITHOUT -q
+};
+
+// TM CODE AND THE WHOLE LISTING, KEPT IN MEMORY -- NULL IF NO MEMORY
+cm_context *cm_open(void);
+
+void cm_close(cm_context *);
+
+void cm_set_target(cm_context *, target_k);
+
+// WHAT TO LIST AND WHERE -- A NULL to KEEPS IT FOR cm_listing()
+void cm_set_listing(cm_context *, uint, FILE *);
+
+// KEEPS THE CODE OF EVERY COMPILATION THAT SUCCEEDS IN dir, UP TO max
+// BYTES OF IT, AND REUSES IT FOR THE SAME SOURCE, TARGET AND VERSION --
+// THEN NO PHASE RUNS AND THE LISTING IS A SUMMARY -- ANY NUMBER OF
+// PROCESSES MAY SHARE dir -- A NULL dir TURNS IT OFF -- FALSE IF dir
+// CAN'T BE MADE OR WRITTEN
+bool cm_set_cache(cm_context *, cchar *dir, size_t max);
+
+// WITH A CACHE -- ALSO KEEPS THE CODE OF EACH FUNCTION OF A TM OR TMB
+// COMPILATION, BY THE NAME OF ITS SOURCE, SO THE NEXT COMPILATION OF
+// THAT NAME EMITS A FUNCTION THAT HASN'T CHANGED BY COPYING ITS CODE --
+// EVERY PHASE BEFORE CODE GENERATION STILL RUNS OVER THE WHOLE SOURCE
+void cm_set_incremental(cm_context *, bool);
+
+// THE LAST COMPILATION CAME FROM THE CACHE
+bool cm_cached(cm_context *);
+
+// COMPILES THE len BYTES AT src -- name IS ONLY FOR THE LISTING AND
+// THE HEADER OF THE OUTPUT -- WHICH STAYS IN MEMORY FOR cm_output()
+// 0 IF IT COMPILED, 1 IF THE SOURCE HAS ERRORS, -1 IF IT NEVER STARTED
+int cm_compile(cm_context *, cchar *name, cchar *src, size_t len);
+
+// COMPILES THE FILE path INTO path WITH THE SUFFIX OF THE TARGET --
+// AS cm DOES -- RETURNS AS cm_compile() WITH NOTHING FOR cm_output()
+int cm_compile_file(cm_context *, cchar *path);
+
+// WHAT THE LAST cm_compile() GAVE -- GOOD TILL THE NEXT ONE -- NULL
+// IF IT GAVE NONE
+cchar *cm_output(cm_context *, size_t *);
+
+cchar *cm_listing(cm_context *, size_t *);
+
+// FREES WHAT THIS THREAD KEEPS WARM FOR ITS NEXT COMPILATION -- DONE
+// BY ITSELF WHEN A THREAD ENDS
+void cm_thread_done(void);
+
+#endif
@@ -1,66 +1,47 @@
+#define _DEFAULT_SOURCE		// strdup() getline()
 #include <getopt.h>
+#include <unistd.h>
 #include "globals.h"
+#include "libcm.h"
+#include "batch.h"
+#include "serve.h"
+#include "cache.h"
 
-// RVALUE OF #define CANNOT BE enum-TYPE
-// E.G. false AND true -- SO I MAKE BOTH
-// OF THEM INTO MACRO-TYPE WITH UPPER-CASE
-
-#ifndef FALSE
-	#define FALSE 0
-#endif
-#ifndef TRUE
-	#define TRUE 1
+#ifdef DEBUG
+static char input[LENGTH];
 #endif
 
-#define NO_PARSE	FALSE
+static cchar **inputs = NULL;			// FROM -f AND -F
+static uint n_inputs = 0;
+static uint inputs_room = 0;
 
-#define NO_ANALYZE 	FALSE
+static bool is_batch = false;			// -j, -F OR MORE THAN ONE -f
+static uint jobs = 0;					// 0 FOR ONE PER CPU
 
-#define NO_CODE 	FALSE
+static cchar *serve_path = NULL;		// --serve
 
-#include "utils.h"
+static cchar *cache_dir = NULL;			// --cache
+static size_t cache_max = 64 << 20;		// --cache-max, GIVEN IN MB
+static bool is_cache_stats = false;		// --cache-stats
+static bool is_incremental = false;		// --incremental
 
-#if NO_PARSE
-	#define BUILDTYPE "SCANNER ONLY"
-	#include "scan.h"
-#else
-	#include "parse.h"
-	#if NO_ANALYZE
-		#define BUILDTYPE "SCANNER/PARSER ONLY"
-	#else
-		#include "analyze.h"
-		#if NO_CODE
-			#define BUILDTYPE "SCANNER/PARSER/ANALYZER ONLY"
-		#else
-			#define BUILDTYPE "COMPLETE COMPILER"
-			#include "cgen.h"
-		#endif
-	#endif
-#endif
+static target_k target_asked = TG_TM;
 
-static char input[LENGTH];
+static uint parts = CM_LIST_ALL;		// WHAT TO LIST
 
-FILE* src;							// SOURCE CODE
-FILE* lst;							// LISTING OUTPUT
-FILE* out;							// CODE FOR VM
+bool parse_cmd(int, char *[]);
+void usage(void);
 
-uint lineno = 0;
-uint linecol = 0;
+static bool add_input(cchar *);
 
-bool echo_source 	= true;
-bool trace_scan		= true;
-bool trace_parse 	= true;
-bool trace_analyze 	= true;
-bool trace_code		= true;
+static bool read_manifest(cchar *);
 
-bool is_error 		= false;
-
-bool parse_cmd(int, char *[]);
-void usage(void);
+static void print_cache_stats(void);
 
 int main(int argc, char *argv[])
 {
-	node_t *syntax_tree;
+	cm_context *cm;
+	int r;
 	
 #ifdef DEBUG
 	FILE *fin = freopen("_input.txt", "r", stdin);
@@ -71,6 +52,7 @@ int main(int argc, char *argv[])
 	printf(">> ");
 	gets(input);
 	argv[1] = input;
+	add_input(input);
 #else
 	if (parse_cmd(argc, argv) == false) {
 		usage();
@@ -78,96 +60,180 @@ int main(int argc, char *argv[])
 	}
 #endif
 	
-	strncpy(input, argv[1], LENGTH-1);
-	input[LENGTH-1] = '\0';
+	if (n_inputs == 0 && serve_path == NULL) {	// --cache-stats ALONE
+		print_cache_stats();
+		return 0;
+	}
 	
-	src = fopen(input, "r");
+	if (is_batch || serve_path != NULL) {
+		long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+		fprintf(stderr, COPYRIGHT);
+		if (jobs == 0)
+			jobs = ncpu > 0 ? ncpu : 1;
+		if (serve_path != NULL)
+			return serve(serve_path, jobs, cache_dir, cache_max, is_incremental) < 0 ? -2 : 0;
+		r = batch_compile(inputs, n_inputs, jobs, target_asked, parts, cache_dir, cache_max,
+			is_incremental);
+		print_cache_stats();
+		return r ? 1 : 0;
+	}
 	
-	if (src == NULL) {
-		sprintf(median, "Cannot open `%s'", input);
-		PANIC(1, median);
+	cm = cm_open();
+	if (cm == NULL) {
+		fprintf(stderr, "[!] Memory exhausted\n");
 		exit(-2);
 	}
-	
-	lst = stderr;	// LIST TO STANDARD OUTPUT
-	
-	fprintf(lst, COPYRIGHT);
-	fprintf(lst, "Compiler built as " BUILDTYPE "\n");
-	fprintf(lst, "[*] C- COMPILATION: `%s'\n", input);
-	
-#if NO_PARSE
-	while (get_token() != ENDFILE)
-		continue;
-#else
-	fprintf(lst, "[*] Parsing source code...\n");
-	syntax_tree = parse();
-	if (trace_parse) {
-		fprintf(lst, "[*] Dumping syntax tree...\n");
-		print_tree(syntax_tree);
+	cm_set_target(cm, target_asked);
+	cm_set_listing(cm, parts, stderr);	// LIST TO STANDARD ERROR
+	if (cache_dir != NULL && !cm_set_cache(cm, cache_dir, cache_max)) {
+		fprintf(stderr, "[!] Cannot keep a cache in `%s'\n", cache_dir);
+		exit(-2);
 	}
-	#if !NO_ANALYZE
-		if (!is_error) {
-			fprintf(lst, "[*] Building symbol table...\n");
-			build_symtab(syntax_tree);
-			fprintf(lst, "[*] Performing type checking...\n");
-			type_check(syntax_tree);
-		}
-		#if !NO_CODE
-			if (!is_error) {
-				strcat(input, ".tm");
-				code_gen(syntax_tree, input);
-				if (!is_error) {
-					if (trace_code)
-						fprintf(lst, "[*] TM code generation done, no error\n");
-					fprintf(lst, "TM code written to `%s'\n", input);
-				}
-			}
-		#endif
-	#endif
-#endif
+	cm_set_incremental(cm, is_incremental);
 	
-	if (is_error)
-		fprintf(lst, "[!] ERROR ENCOUNTERED before %d:%d\n", lineno, linecol);
-	else
-		fprintf(lst, "COMPILATION COMPLETED for %d line(s)\n", lineno);
-	
-	reclaim_memory(syntax_tree);	// CLEAN UP MEMORIES
+	fprintf(stderr, COPYRIGHT);
+	r = cm_compile_file(cm, inputs[0]);
+	cm_close(cm);
+	print_cache_stats();
 	
-	return 0;
+	return r < 0 ? -2 : 0;
 }
 
 bool parse_cmd(int argc, char *argv[])
 {
+	static const struct option longs[] = {
+		{"serve", required_argument, NULL, 'S'},
+		{"cache", required_argument, NULL, 'K'},
+		{"cache-max", required_argument, NULL, 'M'},
+		{"cache-stats", no_argument, NULL, 'X'},
+		{"incremental", no_argument, NULL, 'I'},
+		{NULL, 0, NULL, 0}
+	};
 	char ch;
-	bool got_src = false;
+	bool quiet = false;
+	bool asked[5] = {false, false, false, false, false};	// -e -s -p -a -c
 	opterr = 0;		// SUPRESS getopt()'S DEFAULT
 					//    ERROR-HANDLING BEHAVIOR
-	while ((ch = getopt(argc, argv, "hespacf")) != EOF) {
+	while ((ch = getopt_long(argc, argv, "hqespacmf:F:j:t:", longs, NULL)) != EOF) {
 		switch (ch) {
 			case 'h':
 				fprintf(stderr, USAGE);
 				exit(0);
 			break;
-			case 'e':  echo_source   = true;  break;
-			case 's':  trace_scan    = true;  break;
-			case 'p':  trace_parse   = true;  break;
-			case 'a':  trace_analyze = true;  break;
-			case 'c':  trace_code    = true;  break;
+			case 'q':  quiet    = true;  break;
+			case 'e':  asked[0] = true;  break;
+			case 's':  asked[1] = true;  break;
+			case 'p':  asked[2] = true;  break;
+			case 'a':  asked[3] = true;  break;
+			case 'c':  asked[4] = true;  break;
+			case 'm':  parts |= CM_LIST_MEMORY;  break;
 			case 'f':
-				// ONLY PARSE 1 FILE EACH SESSION
-				if (got_src) return false;
-				got_src = true;
-				strncpy(input, optarg, LENGTH);
+				if (!add_input(optarg)) return false;
+			break;
+			case 'F':
+				if (!read_manifest(optarg)) return false;
+				is_batch = true;
+			break;
+			case 'j':
+				jobs = atoi(optarg);
+				is_batch = true;
+			break;
+			case 'S':  serve_path = optarg;  break;
+			case 'K':  cache_dir = optarg;  break;
+			case 'M':  cache_max = (size_t) atol(optarg) << 20;  break;
+			case 'X':  is_cache_stats = true;  break;
+			case 'I':  is_incremental = true;  break;
+			case 't':
+				if (strcmp(optarg, "tm") == 0)
+					target_asked = TG_TM;
+				else if (strcmp(optarg, "tmb") == 0)
+					target_asked = TG_TMB;
+				else if (strcmp(optarg, "x86") == 0)
+					target_asked = TG_X86;
+				else if (strcmp(optarg, "c") == 0)
+					target_asked = TG_C;
+				else
+					return false;
 			break;
 			default: return false;
 		}
 	}
-	// SOURCE CODE CAN'T BE OMITTED
-	if (got_src == false)
+	// FUNCTIONS ARE KEPT IN THE CACHE
+	if (is_incremental && cache_dir == NULL)
+		return false;
+	// THE SERVER GETS ITS SOURCES FROM ITS CLIENTS -- -j IS ITS THREADS
+	if (serve_path != NULL)
+		return n_inputs == 0;
+	// SOURCE CODE CAN'T BE OMITTED -- BUT TO SEE HOW A CACHE IS DOING
+	if (n_inputs == 0)
+		return is_cache_stats && cache_dir != NULL;
+	if (n_inputs > 1)
+		is_batch = true;
+	// ALL LISTINGS ARE ON UNLESS -q -- THEN ONLY THOSE ASKED FOR
+	if (quiet) {
+		static const uint part[] = {
+			CM_LIST_ECHO, CM_LIST_SCAN, CM_LIST_PARSE, CM_LIST_ANALYZE, CM_LIST_CODE
+		};
+		for (tint i = 0; i < 5; i++)
+			if (!asked[i])
+				parts &= ~part[i];
+	}
+	return true;
+}
+
+static bool add_input(cchar *path)
+{
+	if (n_inputs == inputs_room) {
+		uint room = inputs_room ? 2 * inputs_room : 16;
+		cchar **more = realloc(inputs, room * sizeof(cchar *));
+		if (more == NULL)
+			return false;
+		inputs = more;
+		inputs_room = room;
+	}
+	if ((inputs[n_inputs] = strdup(path)) == NULL)
 		return false;
+	n_inputs++;
 	return true;
 }
 
+// ONE SOURCE FILE A LINE -- BLANK LINES AND LINES FROM '#' SKIPPED
+static bool read_manifest(cchar *manifest)
+{
+	FILE *fp = fopen(manifest, "r");
+	char *line = NULL;
+	size_t room = 0;
+	ssize_t len;
+	bool is_ok = fp != NULL;
+	while (is_ok && (len = getline(&line, &room, fp)) != -1) {
+		while (len > 0 && isspace((unsigned char) line[len-1]))
+			line[--len] = '\0';
+		if (len != 0 && line[0] != '#')
+			is_ok = add_input(line);
+	}
+	if (fp != NULL)
+		fclose(fp);
+	free(line);
+	return is_ok;
+}
+
+// THE COUNTERS OF --cache -- IF --cache-stats ASKED FOR THEM
+static void print_cache_stats(void)
+{
+	cache_stats_t s;
+	if (!is_cache_stats || cache_dir == NULL)
+		return ;
+	if (!cache_stats(cache_dir, &s)) {
+		fprintf(stderr, "[!] Cannot read the counters of `%s'\n", cache_dir);
+		return ;
+	}
+	fprintf(stderr, "[*] C- CACHE: `%s' %llu hit(s), %llu miss(es), %llu stored, "
+		"%llu evicted, %llu of %zu byte(s) held\n", cache_dir,
+		(unsigned long long) s.hits, (unsigned long long) s.misses,
+		(unsigned long long) s.stores, (unsigned long long) s.evictions,
+		(unsigned long long) s.bytes, cache_max);
+}
+
 inline void usage(void)
 {
 	fprintf(stderr, COPYRIGHT);
@@ -0,0 +1,224 @@
+// GENERATES scantab.h -- THE TABLES OF THE SCANNER DFA
+//   mkscan > scantab.h			(DONE BY MakeCM)
+// THE DFA IS THE STATE MACHINE get_token() USED TO SPELL OUT BY HAND
+// -- EDIT THE RULES IN build() AND REBUILD RATHER THAN scantab.h
+#include "globals.h"
+
+#define S_LIST 										\
+	X(START) X(INNUM) X(INID) 						\
+	X(INLE) X(INEQ) X(INGE) X(INNE) 				\
+	X(INDIV) X(INC99) X(INKR) X(OUTKR)
+
+// A CLASS PER CHARACTER THE DFA TELLS APART -- C_EOF IS NOT A BYTE
+#define C_LIST 										\
+	X(DIGIT) X(ALPHA) X(SPACE) X(NL) 				\
+	X(LT) X(EQ) X(GT) X(BANG) X(SLASH) X(STAR) 		\
+	X(PLUS) X(MINUS) X(SEMI) X(COMMA) 				\
+	X(LPAREN) X(RPAREN) X(LSQUARE) X(RSQUARE) 		\
+	X(LBRACE) X(RBRACE) X(OTHER) X(EOF)
+
+#define X(N) S_##N,
+typedef enum { S_LIST N_STATES } dfa_state;
+#undef X
+#define X(N) C_##N,
+typedef enum { C_LIST N_CLASSES } dfa_class;
+#undef X
+
+// ACTIONS PAST THE LAST STATE -- ALL END THE TOKEN
+enum {
+	X_TAKE = N_STATES, 	// THE CHARACTER BELONGS TO THE TOKEN
+	X_BACK, 			// IT DOESN'T -- ROLL IT BACK
+	X_EARLY, 			// EOF INSIDE A TOKEN OR COMMENT
+	X_END 				// EOF BETWEEN TOKENS
+};
+
+static unsigned char next[N_STATES][N_CLASSES];
+static unsigned char emit[N_STATES][N_CLASSES];
+
+static void set(int s, int c, int to, token_t t)
+{
+	next[s][c] = to;
+	emit[s][c] = t;
+}
+
+// EVERY CLASS OF s NOT SET LATER
+static void fill(int s, int to, token_t t)
+{
+	for (int c = 0; c < N_CLASSES; c++)
+		set(s, c, to, t);
+	if (s != S_START)
+		set(s, C_EOF, X_EARLY, ENDFILE);
+}
+
+static void build(void)
+{
+	static const token_t single[] = {
+		PLUS, MINUS, SEMI, COMMA,
+		LPAREN, RPAREN, LSQUARE, RSQUARE, LBRACE, RBRACE
+	};
+	int c;
+
+	fill(S_START, X_TAKE, ERROR);
+	set(S_START, C_DIGIT, S_INNUM, 0);
+	set(S_START, C_ALPHA, S_INID, 0);
+	set(S_START, C_SPACE, S_START, 0);
+	set(S_START, C_NL, S_START, 0);
+	set(S_START, C_LT, S_INLE, 0);
+	set(S_START, C_EQ, S_INEQ, 0);
+	set(S_START, C_GT, S_INGE, 0);
+	set(S_START, C_BANG, S_INNE, 0);
+	set(S_START, C_SLASH, S_INDIV, 0);
+	set(S_START, C_STAR, X_TAKE, TIMES);
+	for (c = C_PLUS; c <= C_RBRACE; c++)
+		set(S_START, c, X_TAKE, single[c - C_PLUS]);
+	set(S_START, C_EOF, X_END, ENDFILE);
+
+	fill(S_INNUM, X_BACK, NUM);
+	set(S_INNUM, C_DIGIT, S_INNUM, 0);
+
+	fill(S_INID, X_BACK, ID);
+	set(S_INID, C_DIGIT, S_INID, 0);
+	set(S_INID, C_ALPHA, S_INID, 0);
+
+	fill(S_INLE, X_BACK, LT);
+	set(S_INLE, C_EQ, X_TAKE, LE);
+	fill(S_INEQ, X_BACK, ASSIGN);
+	set(S_INEQ, C_EQ, X_TAKE, EQ);
+	fill(S_INGE, X_BACK, GT);
+	set(S_INGE, C_EQ, X_TAKE, GE);
+	fill(S_INNE, X_BACK, ERROR);
+	set(S_INNE, C_EQ, X_TAKE, NE);
+
+	fill(S_INDIV, X_BACK, DIVIDE);
+	set(S_INDIV, C_STAR, S_INKR, 0);
+	set(S_INDIV, C_SLASH, S_INC99, 0);
+
+	fill(S_INC99, S_INC99, 0);
+	set(S_INC99, C_NL, S_START, 0);
+
+	fill(S_INKR, S_INKR, 0);
+	set(S_INKR, C_STAR, S_OUTKR, 0);
+
+	fill(S_OUTKR, S_INKR, 0);
+	set(S_OUTKR, C_STAR, S_OUTKR, 0);
+	set(S_OUTKR, C_SLASH, S_START, 0);
+}
+
+// ASCII ONLY -- THE SAME AS isdigit() AND FRIENDS IN THE "C" LOCALE
+static int classify(int ch)
+{
+	static const char singles[] = "+-;,()[]{}";
+	cchar *p;
+	if (ch >= '0' && ch <= '9')
+		return C_DIGIT;
+	if ((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '_')
+		return C_ALPHA;
+	if (ch == '\n')
+		return C_NL;
+	if (ch == ' ' || (ch >= '\t' && ch <= '\r'))
+		return C_SPACE;
+	switch (ch) {
+		case '<': return C_LT;
+		case '=': return C_EQ;
+		case '>': return C_GT;
+		case '!': return C_BANG;
+		case '/': return C_SLASH;
+		case '*': return C_STAR;
+	}
+	if (ch != '\0' && (p = strchr(singles, ch)) != NULL)
+		return C_PLUS + (p - singles);
+	return C_OTHER;
+}
+
+// KEYWORDS IN token_t ORDER -- FIND a AND b SO THAT
+// (a*s[0] + b*s[1] + len) & 7 IS DISTINCT FOR ALL OF THEM
+static cchar *keywords[] = {"else", "if", "int", "return", "void", "while"};
+
+#define N_KEYWORDS (sizeof(keywords) / sizeof(keywords[0]))
+
+static uint kw_hash(cchar *s, uint a, uint b)
+{ return (a * (unsigned char) s[0] + b * (unsigned char) s[1] + strlen(s)) & 7; }
+
+static bool find_hash(uint *pa, uint *pb)
+{
+	for (uint a = 1; a < 64; a++)
+		for (uint b = 0; b < 64; b++) {
+			uint used = 0, i;
+			for (i = 0; i < N_KEYWORDS; i++) {
+				uint h = kw_hash(keywords[i], a, b);
+				if (used & (1u << h))
+					break;
+				used |= 1u << h;
+			}
+			if (i == N_KEYWORDS) {
+				*pa = a;
+				*pb = b;
+				return true;
+			}
+		}
+	return false;
+}
+
+static void put_table(cchar *name, unsigned char tab[N_STATES][N_CLASSES])
+{
+	printf("static const unsigned char %s[N_STATES][N_CLASSES] = {\n", name);
+	for (int s = 0; s < N_STATES; s++) {
+		printf("\t{");
+		for (int c = 0; c < N_CLASSES; c++)
+			printf("%s%2d", c ? "," : "", tab[s][c]);
+		printf("},\n");
+	}
+	printf("};\n\n");
+}
+
+int main(void)
+{
+	uint a, b, i;
+	int slot[8] = {-1, -1, -1, -1, -1, -1, -1, -1};
+
+	build();
+	if (!find_hash(&a, &b)) {
+		fprintf(stderr, "mkscan: no perfect hash for the keywords\n");
+		return 1;
+	}
+
+	printf("// GENERATED BY mkscan.c -- DO NOT EDIT\n");
+	printf("#ifndef _SCANTAB_H_\n#define _SCANTAB_H_\n\n");
+
+	#define X(N) printf("\tS_" #N ",\n");
+	printf("typedef enum {\n");
+	S_LIST
+	printf("\tN_STATES\n} dfa_state;\n\n");
+	#undef X
+	#define X(N) printf("\tC_" #N ",\n");
+	printf("typedef enum {\n");
+	C_LIST
+	printf("\tN_CLASSES\n} dfa_class;\n\n");
+	#undef X
+
+	printf("// scan_next[s][c] PAST N_STATES ENDS THE TOKEN\n");
+	printf("#define X_TAKE  %d\n#define X_BACK  %d\n#define X_EARLY %d\n#define X_END   %d\n\n",
+		X_TAKE, X_BACK, X_EARLY, X_END);
+
+	printf("static const unsigned char char_class[256] = {");
+	for (i = 0; i < 256; i++)
+		printf("%s%2d,", (i % 16) ? " " : "\n\t", classify(i));
+	printf("\n};\n\n");
+
+	put_table("scan_next", next);
+	put_table("scan_emit", emit);
+
+	printf("#define KW_HASH(s, len) ((%uu * (unsigned char) (s)[0] + "
+		"%uu * (unsigned char) (s)[1] + (len)) & 7)\n\n", a, b);
+	for (i = 0; i < N_KEYWORDS; i++)
+		slot[kw_hash(keywords[i], a, b)] = i;
+	printf("static const struct { const char *name; unsigned char len, tok; } kw_table[8] = {\n");
+	for (i = 0; i < 8; i++)
+		if (slot[i] >= 0)
+			printf("\t{\"%s\", %u, %d},\n", keywords[slot[i]],
+				(uint) strlen(keywords[slot[i]]), ELSE + slot[i]);
+		else
+			printf("\t{\"\", 0, 0},\n");
+	printf("};\n\n#endif\n");
+	return 0;
+}
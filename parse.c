@@ -1,10 +1,11 @@
 // ERRNO: [21, 40]
 #include "globals.h"
 #include "utils.h"
+#include "intern.h"
 #include "scan.h"
 #include "parse.h"
 
-static token_t token;
+static __thread token_t token;
 
 static node_t *decl_list(void);
 static node_t *decl(void);
@@ -22,10 +23,10 @@ static node_t *return_stmt(void);
 static node_t *expr_stmt(void);
 
 static node_t *expression(void);
-static node_t *mixed_expr(node_t *);
-static node_t *add_expr(node_t *);
-static node_t *term(node_t *);
-static node_t *factor(node_t *);
+static node_t *mixed_expr(void);
+static node_t *add_expr(void);
+static node_t *term(void);
+static node_t *factor(void);
 static node_t *id_stmt(void);
 static node_t *args(void);
 
@@ -38,7 +39,7 @@ static void match_token(token_t excepted)
 		token = get_token();
 		return ;
 	}
-	sprintf(median, "Unexcepted token -> `%s'", lexeme);
+	sprintf(median, "Unexcepted token -> `%s'", tok_text());
 	if (excepted >= ENDFILE && excepted <= RBRACE)
 		sprintf(
 			median+strlen(median), 		// ACTS LIKE strcat()
@@ -104,7 +105,7 @@ static node_t * decl_list(void)
 	while (token != ENDFILE) {
 		node_t *v = decl();
 		if (v && u) {
-			u->sibling = v;
+			u->sibling = node_id(v);
 			u = v;
 		}
 	}
@@ -115,40 +116,40 @@ static node_t * decl(void)
 {
 	node_t *t = NULL;
 	expr_t dec_type;
-	char *name = NULL;		// BETTER BE NULL
+	ident_t name = ID_NONE;	// BETTER BE NONE
 	
 	dec_type = match_atom();
 	if (token == ID)
-		name = copy_string(lexeme);
+		name = tok.val;
 	match_token(ID);
 	
 	switch (token) {
 		case SEMI:
-			// NOTE THAT IF name IS NULL
+			// NOTE THAT IF name IS NONE
 			// WE MAY NEEDN'T TO UPDATE t IMMEDIATELY
-			// WE MAY JUDGE IF name IS NULL
-			if (name != NULL)			// MATCHED ID
+			// WE MAY JUDGE IF name IS NONE
+			if (name != ID_NONE)			// MATCHED ID
 				t = new_decl_node(D_SCA);
 			if (t != NULL) {
 				t->var_data_type = dec_type;
-				t->name = name;
+				IDENT(t) = name;
 				t->is_global = true;
 			}
 			match_token(SEMI);
 		break;
 		
 		case LSQUARE:
-			if (name != NULL)
+			if (name != ID_NONE)
 				t = new_decl_node(D_VEC);
 			if (t != NULL) {
 				//~t->var_data_type = dec_type;
 				t->var_data_type = ET_ARR;
-				t->name = name;
+				IDENT(t) = name;
 				t->is_global = true;
 			}
 			match_token(LSQUARE);
 			if (t != NULL) {
-				t->val = atoi(lexeme);
+				t->val = tok.val;
 				if (t->val <= 0) {
 					sprintf(median, "Invalid array size -> %d", t->val);
 					syntax_error(24, median);
@@ -160,24 +161,24 @@ static node_t * decl(void)
 		break;
 		
 		case LPAREN:
-			if (name != NULL)
+			if (name != ID_NONE)
 				t = new_decl_node(D_FUN);
 			if (t != NULL) {
 				t->func_ret_type = dec_type;
-				t->name = name;
+				IDENT(t) = name;
 				// IT'S MEANLESS
 				t->is_global = true;
 			}
 			match_token(LPAREN);
 			if (t != NULL)
-				t->child[0] = para_list();
+				t->child[0] = node_id(para_list());
 			match_token(RPAREN);
 			if (t != NULL)
-				t->child[1] = comp_stmt();
+				t->child[1] = node_id(comp_stmt());
 		break;
 		
 		default:
-			sprintf(median, "Unexctped token -> `%s'", lexeme);
+			sprintf(median, "Unexctped token -> `%s'", tok_text());
 			syntax_error(25, median);
 			// MUST FETCH NEXT TOKEN -- OR CAUSE A DEAH-LOOP
 			// IF TOKEN NOT IN (SEMI, LSQUARE, LPAREN) AND
@@ -194,35 +195,35 @@ static node_t * var_decl(void)
 	// THIS FUNCTION HIGH ACTS SOMEWHAT LIKE decl()
 	node_t *t = NULL;
 	expr_t dec_type;
-	char *name = NULL;
+	ident_t name = ID_NONE;
 	
 	dec_type = match_atom();
 	if (token == ID)
-		name = copy_string(lexeme);
+		name = tok.val;
 	match_token(ID);
 	
 	switch (token) {
 		case SEMI:
-			if (name != NULL)
+			if (name != ID_NONE)
 				t = new_decl_node(D_SCA);
 			if (t != NULL) {
 				t->var_data_type = dec_type;
-				t->name = name;
+				IDENT(t) = name;
 			}
 			match_token(SEMI);
 		break;
 		
 		case LSQUARE:
-			if (name != NULL)
+			if (name != ID_NONE)
 				t = new_decl_node(D_VEC);
 			if (t != NULL) {
 				//~t->var_data_type = dec_type;
 				t->var_data_type = ET_ARR;
-				t->name = name;
+				IDENT(t) = name;
 			}
 			match_token(LSQUARE);
 			if (t != NULL) {
-				t->val = atoi(lexeme);
+				t->val = tok.val;
 				if (t->val <= 0) {
 					sprintf(median, "Invalid array size `%d'", t->val);
 					syntax_error(26, median);
@@ -234,7 +235,7 @@ static node_t * var_decl(void)
 		break;
 		
 		default:
-			sprintf(median, "Unexctped token -> `%s'", lexeme);
+			sprintf(median, "Unexctped token -> `%s'", tok_text());
 			syntax_error(27, median);
 			token = get_token();
 		break;
@@ -259,7 +260,7 @@ static node_t * para_list(void)
 			match_token(COMMA);
 			node_t *v = para();
 			if (v != NULL) {
-				u->sibling = v;
+				u->sibling = node_id(v);
 				u = v;
 			}
 		}
@@ -271,28 +272,28 @@ static node_t * para(void)
 {
 	node_t *t;
 	expr_t para_type;
-	char *name = NULL;
+	ident_t name = ID_NONE;
 	
 	para_type = match_atom();
 	if (token == ID)
-		name = copy_string(lexeme);
+		name = tok.val;
 	match_token(ID);
 	
 	if (token == LSQUARE) {
 		match_token(LSQUARE);
 		// ARRAY ARGUMENT MUST AS FORM OF foo[]
 		match_token(RSQUARE);
-		if (name != NULL)
+		if (name != ID_NONE)
 			t = new_decl_node(D_VEC);
 		t->var_data_type = ET_ARR;
 	} else {
-		if (name != NULL)
+		if (name != ID_NONE)
 			t = new_decl_node(D_SCA);
 		t->var_data_type = para_type;
 	}
 	
 	if (t != NULL) {
-		t->name = name;
+		IDENT(t) = name;
 		t->val = 0;
 		//~t->var_data_type = para_type;
 		t->is_parameter = true;
@@ -307,9 +308,9 @@ static node_t * comp_stmt(void)
 	match_token(LBRACE);
 	if ( (token != RBRACE) && (t = new_stmt_node(S_COMPOUND)) ) {
 		if (IS_ATOM(token))
-			t->child[0] = local_decl();
+			t->child[0] = node_id(local_decl());
 		if (token != RBRACE)
-			t->child[1] = stmt_list();
+			t->child[1] = node_id(stmt_list());
 	}
 	match_token(RBRACE);
 	return t;
@@ -325,7 +326,7 @@ static node_t * local_decl(void)
 		while (IS_ATOM(token)) {
 			node_t *v = var_decl();
 			if (v != NULL) {
-				u->sibling = v;
+				u->sibling = node_id(v);
 				u = v;
 			}
 		}
@@ -341,7 +342,7 @@ static node_t * stmt_list(void)
 	while (token != RBRACE) {
 		node_t *v = statement();
 		if (v && u) {
-			u->sibling = v;
+			u->sibling = node_id(v);
 			u = v;
 		}
 	}
@@ -363,7 +364,7 @@ static node_t * statement(void)
 		case SEMI:		t = expr_stmt();		break;
 		
 		default:
-			sprintf(median, "Unexctped token -> `%s'", lexeme);
+			sprintf(median, "Unexctped token -> `%s'", tok_text());
 			syntax_error(28, median);
 			token = get_token();
 		break;
@@ -389,9 +390,9 @@ static node_t * if_stmt(void)
 	}
 	t = new_stmt_node(S_IF);
 	if (t != NULL) {
-		t->child[0] = expr;
-		t->child[1] = tcase;
-		t->child[2] = fcase;
+		t->child[0] = node_id(expr);
+		t->child[1] = node_id(tcase);
+		t->child[2] = node_id(fcase);
 	}
 	
 	return t;
@@ -410,8 +411,8 @@ static node_t * while_stmt(void)
 	
 	t = new_stmt_node(S_WHILE);
 	if (t != NULL) {
-		t->child[0] = expr;
-		t->child[1] = stmt;
+		t->child[0] = node_id(expr);
+		t->child[1] = node_id(stmt);
 	}
 	
 	return t;
@@ -426,7 +427,7 @@ static node_t * return_stmt(void)
 	if (token != SEMI)
 		expr = expression();
 	if (t != NULL)
-		t->child[0] = expr;
+		t->child[0] = node_id(expr);
 	match_token(SEMI);
 	return t;
 }
@@ -443,65 +444,74 @@ static node_t * expr_stmt(void)
 	return t;
 }
 
+// LOOK PAST ID, ID[...] OR ID(...) FOR `=' -- THE LAST IS NO LVALUE
+// BUT IS PARSED AS AN ASSIGNMENT ALL THE SAME TO REPORT IT
+static bool is_assignment(void)
+{
+	uint k = 1, depth = 0;
+	token_t t = peek_token(1);
+	if (t != LSQUARE && t != LPAREN)
+		return t == ASSIGN;
+	do {
+		switch (peek_token(k++)) {
+			case LSQUARE: case LPAREN:	depth++;	break;
+			case RSQUARE: case RPAREN:	depth--;	break;
+			
+			// CANNOT BE INSIDE AN EXPRESSION -- LET THE PARSER COMPLAIN
+			case SEMI: case LBRACE: case RBRACE: case ENDFILE:
+				return false;
+			
+			default:	break;
+		}
+	} while (depth != 0);
+	return peek_token(k) == ASSIGN;
+}
+
 static node_t * expression(void)
 {
 	node_t *t = NULL;
 	node_t *lvalue = NULL;
 	node_t *rvalue = NULL;
-	bool got_lvalue = false;
-	if (token == ID) {
-		lvalue = id_stmt();
-		got_lvalue = true;
-	}
+	if (token != ID || !is_assignment())
+		return mixed_expr();
 	
-	if (got_lvalue == true && token == ASSIGN) {
-		if (lvalue && lvalue->nodekind == N_EXPR 
-				&& lvalue->whichkind.expr == E_ID) {
-			match_token(ASSIGN);
-			rvalue = expression();
-			t = new_expr_node(E_ASSIGN);
-			if (t != NULL) {
-				t->child[0] = lvalue;
-				t->child[1] = rvalue;
-			}
-		} else {
-			syntax_error(29, "Attempting to assign to something not a lvalue");
-			token = get_token();
+	lvalue = id_stmt();
+	if (lvalue && lvalue->nodekind == N_EXPR 
+			&& lvalue->whichkind.expr == E_ID) {
+		match_token(ASSIGN);
+		rvalue = expression();
+		t = new_expr_node(E_ASSIGN);
+		if (t != NULL) {
+			t->child[0] = node_id(lvalue);
+			t->child[1] = node_id(rvalue);
 		}
-	} else
-		t = mixed_expr(lvalue);			// PASS-DOWN
+	} else {
+		syntax_error(29, "Attempting to assign to something not a lvalue");
+		token = get_token();
+	}
 	
 	return t;
 }
 
-/*
-	THERE'S NO ROLL BACK FUNCTION -- SO WE NEED USE TO A 
-	PASS DOWN ARGUMENT TO RECORD `ID' TOKEN ALREADY PARSED
-		static node_t *mixed_expr(node_t *);
-		static node_t *add_expr(node_t *);
-		static node_t *term(node_t *);
-		static node_t *factor(node_t *);
-*/
-
-static node_t * mixed_expr(node_t *pass)
+static node_t * mixed_expr(void)
 {
 	node_t *t;
 	node_t *lexpr = NULL;
 	node_t *rexpr = NULL;
 	token_t op;
 	
-	lexpr = add_expr(pass);				// PASS-DOWN
+	lexpr = add_expr();
 	
 	// MULTI-COMPARISON NOT ALLOWED
 	if (token >= LT && token <= NE) {
 		op = token;
 		match_token(token);
-		rexpr = add_expr(NULL);			// NOT INHERITED
+		rexpr = add_expr();
 		
 		t = new_expr_node(E_OP);
 		if (t != NULL) {
-			t->child[0] = lexpr;
-			t->child[1] = rexpr;
+			t->child[0] = node_id(lexpr);
+			t->child[1] = node_id(rexpr);
 			t->op = op;
 		}
 	} else
@@ -510,9 +520,9 @@ static node_t * mixed_expr(node_t *pass)
 	return t;
 }
 
-static node_t * add_expr(node_t *pass)
+static node_t * add_expr(void)
 {
-	node_t *t = term(pass);
+	node_t *t = term();
 	node_t *u;
 	// MULTI +/- SUPPORTED
 	while (token == PLUS || token == MINUS) {
@@ -522,41 +532,34 @@ static node_t * add_expr(node_t *pass)
 		// SO I SIMPLY JUMP OUT THIS LOOP
 		if (u == NULL)
 			break;
-		u->child[0] = t;
+		u->child[0] = node_id(t);
 		u->op = token;
 		t = u;
 		match_token(token);
-		t->child[1] = term(NULL);
+		t->child[1] = node_id(term());
 	}
 	return t;
 }
 
-static node_t * term(node_t *pass)
+static node_t * term(void)
 {
-	node_t *t = factor(pass);
+	node_t *t = factor();
 	node_t *u;
 	while (token == TIMES || token == DIVIDE) {
 		u = new_expr_node(E_OP);
 		if (u == NULL)
 			break;			//continue;
-		u->child[0] = t;
+		u->child[0] = node_id(t);
 		u->op = token;
 		t = u;
 		match_token(token);
-		t->child[1] = factor(NULL);
+		t->child[1] = node_id(factor());
 	}
 	return t;
 }
 
-static node_t * factor(node_t *pass)
+static node_t * factor(void)
 {
-	// THE END POINT OF PASS-DOWN CALL
-	// NOTE THAT IF pass NOT NULL -- WHICH MEANS THAT
-	// IT'S PASS-DOWN CALL -- SINCE WE ALREADY PARSED ID
-	// in id_stmt() -- SO WE NEEDN'T FURTHER CALL OF IT
-	// WHICH WE CAN NOW RETURN pass ITSELF
-	if (pass != NULL) return pass;
-	
 	node_t *t = NULL;
 	if (token == ID)
 		t = id_stmt();
@@ -568,13 +571,13 @@ static node_t * factor(node_t *pass)
 	else if (token == NUM) {
 		t = new_expr_node(E_NUM);
 		if (t != NULL) {
-			t->val = atoi(lexeme);
+			t->val = tok.val;
 			t->var_data_type = ET_INT;
 		}
 		match_token(NUM);
 	}
 	else {
-		sprintf(median, "Unexctped token -> `%s'", lexeme);
+		sprintf(median, "Unexctped token -> `%s'", tok_text());
 		syntax_error(30, median);
 		token = get_token();
 	}
@@ -587,10 +590,10 @@ static node_t *id_stmt(void)
 	node_t *t;
 	node_t *expr = NULL;
 	node_t *argv = NULL;
-	char *name = NULL;
+	ident_t name = ID_NONE;
 	
 	if (token == ID)
-		name = copy_string(lexeme);
+		name = tok.val;
 	match_token(ID);
 	
 	if (token == LPAREN) {
@@ -598,11 +601,11 @@ static node_t *id_stmt(void)
 		argv = args();
 		match_token(RPAREN);
 		
-		if (name != NULL)
+		if (name != ID_NONE)
 			t = new_stmt_node(S_CALL);
 		if (t != NULL) {
-			t->child[0] = argv;
-			t->name = name;
+			t->child[0] = node_id(argv);
+			IDENT(t) = name;
 		}
 	}
 	else {
@@ -612,11 +615,11 @@ static node_t *id_stmt(void)
 			match_token(RSQUARE);
 		}
 		
-		if (name != NULL)
+		if (name != ID_NONE)
 			t = new_expr_node(E_ID);
 		if (t != NULL) {
-			t->child[0] = expr;
-			t->name = name;
+			t->child[0] = node_id(expr);
+			IDENT(t) = name;
 		}
 	}
 	
@@ -632,7 +635,7 @@ static node_t * args(void)
 		match_token(COMMA);
 		node_t *v = expression();
 		if (v && u) {
-			u->sibling = v;
+			u->sibling = node_id(v);
 			u = v;
 		}
 	}
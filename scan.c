@@ -1,307 +1,592 @@
 // ERRNO: [11, 20]
+#define _DEFAULT_SOURCE
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <sched.h>
 #include "globals.h"
 #include "utils.h"
 #include "scan.h"
+#include "intern.h"
+#include "scantab.h"		// GENERATED BY mkscan.c
 
-typedef enum state_t {
-	START, INNUM, INID, 
-	INLE, INEQ, INGE, INNE, 
-	INDIV, INC99, INKR, OUTKR, 
-	INEOF, DONE
-} state_t;
+#if defined(__SSE2__) && !defined(NO_SIMD)
+	#include <immintrin.h>
+	#define SCAN_SSE2
+	#if defined(__x86_64__) && defined(__GNUC__)
+		#define SCAN_AVX2
+	#endif
+#endif
 
-char lexeme[MAX_TOK_SIZE];
+__thread span_t tok;
 
-#define BUF_SIZE 256
-static char linebuf[BUF_SIZE];
-static uint bufsize = 0;
+// THE PRE-LEXED TOKENS -- STRUCT OF ARRAYS, ONE SLOT EACH -- EVERY
+// TOKEN BUT THE LAST ENDFILE TAKES A BYTE SO text_size+1 SLOTS DO
+#define TK_EARLY 0x80			// kind FLAG -- EOF INSIDE A TOKEN OR COMMENT
 
-static char next_char(void)
-{
-	if (linecol < bufsize)
-		return linebuf[linecol++];
+// HOW text CAME -- AND SO HOW IT GOES
+enum { TEXT_READ, TEXT_MAPPED, TEXT_LENT };
+
+// ONE PER COMPILATION -- THE WHOLE SOURCE AND ITS TOKENS, SHARED BY
+// THE THREAD PARSING IT AND THE ONE SCANNING AHEAD IF ANY
+typedef struct source_t {
+	cchar *text;
+	size_t text_size;
+	tint text_how;
+	
+	struct {
+		unsigned char *kind;
+		uint *off, *len, *line, *col;	// line AND col AFTER THE TOKEN
+		int *val;
+		void *base;
+		size_t bytes;
+	} tk;
 	
-	lineno++;
-	if (fgets(linebuf, BUF_SIZE-1, src)) {
-		bufsize = strlen(linebuf);
-		if (echo_source) {
-			fprintf(lst, "%4d: %s", lineno, linebuf);
-			// MAYBE linebuf REACHED THE LAST LINE
-			if (linebuf[bufsize-1] != '\n')
-				fprintf(lst, "\n");
+	size_t n_lexed;				// PUBLISHED BY THE SCANNER
+	bool lex_done;				// ENDFILE IS IN
+	
+	FILE *lst;					// FOR THE SCANNER THREAD TO PANIC() TO
+} source_t;
+
+static __thread source_t source;		// OF THE COMPILATION ON THIS THREAD
+static __thread source_t *sc;			// THE ONE THIS THREAD SCANS
+
+// SCANNER SIDE -- ONLY lex_token() AND WHAT IT CALLS TOUCH THESE
+// SO IT CAN RUN AHEAD OF THE PARSER ON ITS OWN THREAD
+static __thread size_t pos = 0;			// NEXT CHARACTER IN text
+static __thread size_t line_end = 0;	// PAST THE '\n' OF THE CURRENT LINE
+static __thread uint sc_line = 0;		// lineno AND linecol AS THE SCANNER SEES THEM
+static __thread uint sc_col = 0;
+
+static __thread size_t next_tok = 0;	// NEXT FOR get_token()
+
+// THE LISTING FOLLOWS THE PARSER, NOT THE SCANNER -- get_token() ECHOES
+// UP TO THE LINE OF EACH TOKEN IT HANDS OUT
+static __thread size_t echo_pos = 0;	// START OF THE NEXT LINE TO ECHO
+static __thread uint echo_line = 0;
+
+// SMALLER SOURCES ARE SCANNED ON DEMAND -- A THREAD ISN'T WORTH IT
+#ifndef SCAN_THREAD_MIN
+	#define SCAN_THREAD_MIN (64 * 1024)
+#endif
+
+static __thread bool threaded = false;	// OR SCANNED ON DEMAND BY get_token()
+static __thread pthread_t scanner;
+
+// RUN KERNELS -- EACH LOOKS AT n BYTES FROM p AND NEVER READS PAST
+// THEM -- span_space() COUNTS LEADING WHITESPACE AND find_star() THE
+// BYTES BEFORE THE FIRST '*' -- BOTH RETURN n IF THE RUN FILLS IT
+static size_t span_space_c(cchar *p, size_t n)
+{
+	size_t i = 0;
+	while (i < n && (char_class[(unsigned char) p[i]] == C_SPACE ||
+		char_class[(unsigned char) p[i]] == C_NL))
+		i++;
+	return i;
+}
+
+static size_t find_star_c(cchar *p, size_t n)
+{
+	cchar *star = memchr(p, '*', n);
+	return (star != NULL) ? (size_t) (star - p) : n;
+}
+
+#ifdef SCAN_SSE2
+// ' ' OR '\t' TO '\r' -- THE SAME BYTES AS C_SPACE AND C_NL
+static inline int space_mask16(__m128i v)
+{
+	__m128i t = _mm_sub_epi8(v, _mm_set1_epi8('\t'));
+	__m128i ctl = _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8('\r' - '\t')), t);
+	__m128i sp = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+	return _mm_movemask_epi8(_mm_or_si128(ctl, sp));
+}
+
+static size_t span_space_sse2(cchar *p, size_t n)
+{
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		int other = ~space_mask16(_mm_loadu_si128((const __m128i *) (p + i))) & 0xFFFF;
+		if (other != 0)
+			return i + __builtin_ctz(other);
+	}
+	return i + span_space_c(p + i, n - i);
+}
+
+static size_t find_star_sse2(cchar *p, size_t n)
+{
+	size_t i = 0;
+	const __m128i star = _mm_set1_epi8('*');
+	for (; i + 16 <= n; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *) (p + i));
+		int m = _mm_movemask_epi8(_mm_cmpeq_epi8(v, star));
+		if (m != 0)
+			return i + __builtin_ctz(m);
+	}
+	return i + find_star_c(p + i, n - i);
+}
+#endif
+
+// TAILS GO TO THE SCALAR KERNELS -- LEGACY SSE RIGHT AFTER 256-BIT
+// CODE PAYS A STATE TRANSITION ON MANY CPUS
+#ifdef SCAN_AVX2
+__attribute__((target("avx2")))
+static size_t span_space_avx2(cchar *p, size_t n)
+{
+	size_t i = 0;
+	const __m256i tab = _mm256_set1_epi8('\t'), span = _mm256_set1_epi8('\r' - '\t');
+	const __m256i blank = _mm256_set1_epi8(' ');
+	for (; i + 32 <= n; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *) (p + i));
+		__m256i t = _mm256_sub_epi8(v, tab);
+		__m256i ws = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(t, span), t),
+			_mm256_cmpeq_epi8(v, blank));
+		uint other = ~(uint) _mm256_movemask_epi8(ws);
+		if (other != 0)
+			return i + __builtin_ctz(other);
+	}
+	return i + span_space_c(p + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static size_t find_star_avx2(cchar *p, size_t n)
+{
+	size_t i = 0;
+	const __m256i star = _mm256_set1_epi8('*');
+	for (; i + 32 <= n; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *) (p + i));
+		uint m = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, star));
+		if (m != 0)
+			return i + __builtin_ctz(m);
+	}
+	return i + find_star_c(p + i, n - i);
+}
+#endif
+
+// PICKED ONCE FROM WHAT THE CPU HAS -- BY THE FIRST scan_open()
+static size_t (*span_space)(cchar *, size_t) = span_space_c;
+static size_t (*find_star)(cchar *, size_t) = find_star_c;
+
+static pthread_once_t kernels_picked = PTHREAD_ONCE_INIT;
+
+static void pick_kernels(void)
+{
+#ifdef SCAN_SSE2
+	span_space = span_space_sse2;
+	find_star = find_star_sse2;
+#endif
+#ifdef SCAN_AVX2
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		span_space = span_space_avx2;
+		find_star = find_star_avx2;
+	}
+#endif
+}
+
+// SKIP WHAT state WOULD ONLY LOOP OVER -- WITHIN THE CURRENT LINE SO
+// next_line() STILL COUNTS AND ECHOES EVERY LINE AND sc_col KEEPS
+// UP -- THE DFA THEN TAKES THE BYTE THAT STOPPED THE RUN
+static inline void skip_run(uint state)
+{
+	size_t n = line_end - pos, k;
+	if (n == 0)
+		return ;
+	switch (state) {
+		case S_START:
+			// MOSTLY ONE BLANK BETWEEN TOKENS -- DON'T START A KERNEL
+			if (char_class[(unsigned char) sc->text[pos]] != C_SPACE)
+				return ;
+			k = span_space(sc->text + pos, n);
+		break;
+		
+		case S_INC99:		// ALL BUT THE '\n'
+			k = n - (sc->text[line_end-1] == '\n');
+		break;
+		
+		case S_INKR:
+			k = find_star(sc->text + pos, n);
+		break;
+		
+		default:
+			return ;
+	}
+	pos += k;
+	sc_col += k;
+}
+
+// PIPES AND THE LIKE CANNOT BE MAPPED -- READ IT ALL INSTEAD
+static bool load_text(FILE *fp)
+{
+	struct stat st;
+	int fd = fileno(fp);
+	size_t cap = 0, n;
+	char *buf = NULL;
+
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+		sc->text_size = st.st_size;
+		if (sc->text_size == 0)
+			return true;
+		buf = mmap(NULL, sc->text_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (buf != MAP_FAILED) {
+			sc->text = buf;
+			sc->text_how = TEXT_MAPPED;
+			madvise(buf, sc->text_size, MADV_SEQUENTIAL);
+			return true;
+		}
+		buf = NULL;
+	}
+
+	sc->text_size = 0;
+	do {
+		if (sc->text_size == cap) {
+			char *grown = realloc(buf, cap = cap ? 2*cap : 65536);
+			if (grown == NULL)
+				return false;
+			sc->text = buf = grown;
+		}
+		n = fread(buf + sc->text_size, 1, cap - sc->text_size, fp);
+		sc->text_size += n;
+	} while (n != 0);
+	return !ferror(fp);
+}
+
+// TOKEN ARRAYS NO BIGGER THAN THIS STAY MAPPED FOR THE NEXT SOURCE
+// ON THE THREAD -- ITS PAGES ARE IN ALREADY
+#ifndef TOKENS_KEEP_MAX
+	#define TOKENS_KEEP_MAX (8 * 1024 * 1024)
+#endif
+
+static __thread void *kept_tokens = NULL;
+static __thread size_t kept_bytes = 0;
+
+// ONE RESERVATION FOR ALL THE ARRAYS -- PAGES ONLY COME IN AS THE
+// SCANNER FILLS THEM AND THE ARRAYS NEVER MOVE UNDER THE PARSER
+static bool alloc_tokens(void)
+{
+	size_t cap = sc->text_size + 1;
+	char *p;
+	sc->tk.bytes = cap * (5 * sizeof(uint) + 1);
+	if (kept_tokens != NULL && kept_bytes >= sc->tk.bytes) {
+		sc->tk.base = kept_tokens;
+		sc->tk.bytes = kept_bytes;
+		kept_tokens = NULL;
+	}
+	else {
+		scan_drop();
+		sc->tk.base = mmap(NULL, sc->tk.bytes, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if (sc->tk.base == MAP_FAILED) {
+			sc->tk.base = NULL;
+			return false;
 		}
-		linecol = 1;
-		return linebuf[0];
 	}
-	return EOF;
+	p = sc->tk.base;
+	sc->tk.off  = (uint *) p;	p += cap * sizeof(uint);
+	sc->tk.len  = (uint *) p;	p += cap * sizeof(uint);
+	sc->tk.line = (uint *) p;	p += cap * sizeof(uint);
+	sc->tk.col  = (uint *) p;	p += cap * sizeof(uint);
+	sc->tk.val  = (int *) p;	p += cap * sizeof(int);
+	sc->tk.kind = (unsigned char *) p;
+	return true;
+}
+
+static token_t lex_token(void);
+
+static void start_lexing(void)
+{
+	pos = line_end = 0;
+	sc_line = sc_col = 0;
+}
+
+// THE SCANNER THREAD -- arg IS THE source_t OF THE THREAD THAT STARTED IT
+static void *scan_all(void *arg)
+{
+	sc = arg;
+	lst = sc->lst;
+	start_lexing();
+	while (lex_token() != ENDFILE)
+		continue;
+	return NULL;
+}
+
+// ONCE THE TEXT IS IN -- THE TOKEN ARRAYS AND MAYBE A THREAD TO FILL THEM
+static bool start_scan(void)
+{
+	next_tok = 0;
+	echo_pos = echo_line = 0;
+	if (!alloc_tokens())
+		return false;
+	
+	sc->lst = lst;
+	threaded = sc->text_size >= SCAN_THREAD_MIN;
+	if (threaded && pthread_create(&scanner, NULL, scan_all, sc) != 0)
+		threaded = false;
+	return true;
+}
+
+static void reset_source(void)
+{
+	pthread_once(&kernels_picked, pick_kernels);
+	sc = &source;
+	memset(sc, 0, sizeof(source_t));
+	start_lexing();
+}
+
+bool scan_open(FILE *fp)
+{
+	return scan_load(fp) && start_scan();
+}
+
+bool scan_load(FILE *fp)
+{
+	reset_source();
+	return load_text(fp);
+}
+
+cchar *scan_text(size_t *size)
+{
+	*size = sc->text_size;
+	return sc->text;
+}
+
+bool scan_start(void)
+{ return start_scan(); }
+
+bool scan_open_text(cchar *text, size_t size)
+{
+	reset_source();
+	sc->text = text;
+	sc->text_size = size;
+	sc->text_how = TEXT_LENT;
+	return start_scan();
+}
+
+size_t scan_max_tokens(void)
+{ return sc->text_size + 1; }
+
+void scan_close(void)
+{
+	if (threaded)
+		pthread_join(scanner, NULL);
+	threaded = false;
+	if (sc->tk.base != NULL && sc->tk.bytes <= TOKENS_KEEP_MAX) {
+		kept_tokens = sc->tk.base;
+		kept_bytes = sc->tk.bytes;
+	}
+	else if (sc->tk.base != NULL)
+		munmap(sc->tk.base, sc->tk.bytes);
+	sc->tk.base = NULL;
+	if (sc->text_how == TEXT_MAPPED)
+		munmap((void *) sc->text, sc->text_size);
+	else if (sc->text_how == TEXT_READ)
+		free((void *) sc->text);
+	sc->text = NULL;
+	sc->text_size = 0;
+	sc->text_how = TEXT_READ;
+}
+
+void scan_drop(void)
+{
+	if (kept_tokens != NULL)
+		munmap(kept_tokens, kept_bytes);
+	kept_tokens = NULL;
+	kept_bytes = 0;
+}
+
+static int next_line(void)
+{
+	char *nl;
+	sc_line++;
+	if (pos >= sc->text_size)
+		return EOF;
+	nl = memchr(sc->text + pos, '\n', sc->text_size - pos);
+	line_end = (nl != NULL) ? (size_t) (nl - sc->text) + 1 : sc->text_size;
+	sc_col = 1;
+	return (unsigned char) sc->text[pos++];
+}
+
+static inline int next_char(void)
+{
+	if (pos < line_end) {
+		sc_col++;
+		return (unsigned char) sc->text[pos++];
+	}
+	return next_line();
 }
 
 static void roll_back(void)
 {
-	if (linecol != 0)
-		linecol--;
+	if (sc_col != 0) {
+		sc_col--;
+		pos--;
+	}
 	else
 		PANIC(11, "Lineno reached zero and trying to roll back");
 }
 
-static token_t kw_match(cchar *str)
+// PERFECT HASH OVER THE SIX KEYWORDS -- ONE COMPARE AT MOST
+static inline token_t kw_match(cchar *str, uint len)
 {
-	tint len = strlen(str);
 	// KEYWORDS LENGTH RANGE FROM 2 TO 6
-	if (len < 2 || len > 6)
+	if (len < 2 || len > MAX_REVERSED)
 		return ID;
-	token_t m, l = ELSE, r = WHILE;
-	while (l <= r) {
-		m = l + (r-l)/2;
-		int cmp = strcmp(str, token_map[m]);
-		if (cmp == 0)
-			return m;
-		(cmp > 0) ? (l = m+1) : (r = m-1);
-	}
+	uint h = KW_HASH(str, len);
+	if (kw_table[h].len == len && memcmp(str, kw_table[h].name, len) == 0)
+		return kw_table[h].tok;
 	return ID;
 }
 
-// HARD-WRITTEN VERSION OF get_token()
-token_t get_token(void)
+cchar *tok_text(void)
+{
+	static __thread char buf[MAX_TOK_SIZE];
+	uint len = tok.len < MAX_TOK_SIZE ? tok.len : MAX_TOK_SIZE-1;
+	if (len != 0)
+		memcpy(buf, sc->text + tok.off, len);
+	buf[len] = '\0';
+	return buf;
+}
+
+// THE LINES THE SCANNER WENT THROUGH TO GET TO line -- WHOLE, AS THE
+// LISTING EXPECTS
+static void echo_to(uint line)
+{
+	while (echo_line < line && echo_pos < sc->text_size) {
+		cchar *nl = memchr(sc->text + echo_pos, '\n', sc->text_size - echo_pos);
+		size_t end = (nl != NULL) ? (size_t) (nl - sc->text) + 1 : sc->text_size;
+		fprintf(lst, "%4d: %.*s", ++echo_line, (int) (end - echo_pos), sc->text + echo_pos);
+		// MAYBE REACHED THE LAST LINE WITHOUT '\n'
+		if (sc->text[end-1] != '\n')
+			fprintf(lst, "\n");
+		echo_pos = end;
+	}
+}
+
+static inline void trace_token(uint line, token_t kind, cchar *lexeme)
+{
+	fprintf(lst, "        %d: ", line);	// 8 SPACES AS \t
+	print_token(kind, lexeme);
+	fprintf(lst, "\n");
+}
+
+// TABLE-DRIVEN -- ONE LOOKUP IN char_class[] AND ONE IN scan_next[]
+// PER CHARACTER UNTIL AN ACTION PAST N_STATES ENDS THE TOKEN -- THE
+// TOKEN GOES TO THE NEXT SLOT AND IS PUBLISHED TO get_token() -- IT
+// PRINTS NOTHING SO IT MAY RUN ON ANOTHER THREAD
+static token_t lex_token(void)
 {
-	uint lexeme_i = 0;
 	token_t current_token;
-	state_t state = START;
-	// FLAG TO INDICATE IF SAVE TO lexeme
-	bool tosave;
-	while (state != DONE) {
-		char c = next_char();
-		tosave = true;
-		
-		switch (state) {
-			case START:
-				if (isdigit(c))
-					state = INNUM;
-				else if (isalpha(c) || c == '_')
-					state = INID;
-				else if (c == '<')
-					state = INLE;
-				else if (c == '=')
-					state = INEQ;
-				else if (c == '>')
-					state = INGE;
-				else if (c == '!')
-					state = INNE;
-				else if (isspace(c))
-					tosave = false;
-				else if (c == '/')
-					state = INDIV;
-				else {
-					state = DONE;
-					switch (c) {
-						case EOF:
-							// OUT-LAYER CODE WILL DEAL ~
-						break;
-						
-						case '+':
-							current_token = PLUS;
-						break;
-						
-						case '-':
-							current_token = MINUS;
-						break;
-						
-						case '*':
-							current_token = TIMES;
-						break;
-						
-						case ';':
-							current_token = SEMI;
-						break;
-						
-						case ',':
-							current_token = COMMA;
-						break;
-						
-						case '(':
-							current_token = LPAREN;
-						break;
-						
-						case ')':
-							current_token = RPAREN;
-						break;
-						
-						case '[':
-							current_token = LSQUARE;
-						break;
-						
-						case ']':
-							current_token = RSQUARE;
-						break;
-						
-						case '{':
-							current_token = LBRACE;
-						break;
-						
-						case '}':
-							current_token = RBRACE;
-						break;
-						
-						default:
-							current_token = ERROR;
-						break;
-					}
-				}
-			break;
-			
-			case INNUM:
-				if ( isdigit(c) )
-					break;
-				else if (c == EOF)
-					goto jmp_eof;
-				roll_back();
-				state = DONE;
-				tosave = false;
-				current_token = NUM;
-			break;
-			
-			case INID:
-				if ( isalnum(c) || c == '_' )
-					break;
-				else if (c == EOF)	// OOPS! -- MET EOF
-					goto jmp_eof;
-				roll_back();
-				state = DONE;
-				tosave = false;
-				current_token = ID;
-			break;
-			
-			case INLE:
-				state = DONE;
-				// PREPARE TO OVERWRITE
-				current_token = LT;
-				if (c == '=')
-					current_token = LE;
-				else if (c == EOF)
-					goto jmp_eof;
-				else
-					roll_back();
-			break;
-			
-			case INEQ:
-				state = DONE;
-				current_token = ASSIGN;
-				if (c == '=')
-					current_token = EQ;
-				else if (c == EOF)
-					goto jmp_eof;
-				else
-					roll_back();
-			break;
-			
-			case INGE:
-				state = DONE;
-				current_token = GT;
-				if (c == '=')
-					current_token = GE;
-				else if (c == EOF)
-					goto jmp_eof;
-				else
-					roll_back();
-			break;
-			
-			case INNE:
-				state = DONE;
-				current_token = ERROR;
-				if (c == '=')
-					current_token = NE;
-				else if (c == EOF)
-					goto jmp_eof;
-				else {
-					roll_back();
-					tosave = false;
-				}
-			break;
-			
-			// THE FOLLOWING 4 CASES
-			// DEAL WITH // ... AND /* ... */
-			case INDIV:
-				state = DONE;
-				tosave = false;
-				if (c == '*') {
-					state = INKR;
-					lexeme_i = 0;	// CLEAN UP SAVED BUFFER
-				}
-				else if (c == '/') {
-					state = INC99;
-					lexeme_i = 0;
-				}
-				else if (c == EOF)
-					goto jmp_eof;
-				else {
-					roll_back();
-					current_token = DIVIDE;
-				}
-			break;
-			
-			case INC99:
-				tosave = false;
-				if (c == EOF)
-					goto jmp_eof;
-				else if (c != '\n')
-					break;
-				state = START;
-			break;
-			
-			case INKR:
-				tosave = false;
-				if (c == '*')
-					state = OUTKR;
-				else if (c == EOF)
-					goto jmp_eof;
-			break;
-			
-			case OUTKR:
-				tosave = false;
-				if (c == '/')
-					state = START;		// REWIND TO THE START STATE
-				else if (c == EOF)
-					goto jmp_eof;
-				else if (c != '*')
-					state = INKR;		// REWIND ONE LEVEL(STATE)
-			break;
-			
-			jmp_eof:					// GOTO LABEL
-			case INEOF:
-				lineno--;				// LINE AUTO-INCREASED ONE
-				PANIC(12, "Met EOF in advance");
-				state = DONE;
-			break;
-			
-			case DONE:
-			default:
-				sprintf(median, "Unknown token: `%s'", lexeme);
-				PANIC(13, median);
-				state = DONE;
-				current_token = ERROR;
+	uint state = S_START, act, flags = 0;
+	size_t start = pos;			// FIRST CHARACTER OF THE TOKEN
+	size_t i = sc->n_lexed;
+	int c, cls, value = 0;
+	
+	for (;;) {
+		if (state == S_START || state >= S_INC99)
+			skip_run(state);
+		c = next_char();
+		cls = (c == EOF) ? C_EOF : char_class[c];
+		if (state == S_START)
+			start = pos - 1;
+		act = scan_next[state][cls];
+		if (act >= N_STATES)
 			break;
-		}								// END OF SWITCH
-		
-		if (c == EOF) {					// CHECK IN NON-START STATE
-			tosave = false;
-			current_token = ENDFILE;
-		}
-		
-		if ( tosave && lexeme_i < MAX_TOK_SIZE )
-			lexeme[lexeme_i++] = c;
+		state = act;
+	}
+	current_token = scan_emit[state][cls];
+	
+	switch (act) {
+		case X_BACK:
+			roll_back();
+		break;
 		
-		if (state == DONE) {
-			lexeme[lexeme_i] = '\0';
-			if (current_token == ID)	// CHECK IF IT'S A REVERSED WORD
-				current_token = kw_match(lexeme);
-		}
-	}									// END OF WHILE
+		case X_EARLY:
+			sc_line--;				// LINE AUTO-INCREASED ONE
+			flags = TK_EARLY;		// get_token() REPORTS IT
+			// FALL THROUGH
+		case X_END:
+			start = pos;
+		break;
+	}
 	
-	if (trace_scan) {					// 8 SPACES AS \t
-		fprintf(lst, "        %d: ", lineno);
-		print_token(current_token, lexeme);
-		fprintf(lst, "\n");
+	if (current_token == NUM) {			// WRAPS LIKE THE TM
+		uint v = 0;
+		for (size_t j = start; j < pos; j++)
+			v = v * 10 + (sc->text[j] - '0');
+		value = (int) v;
 	}
+	else if (current_token == ID) {		// CHECK IF IT'S A REVERSED WORD
+		current_token = kw_match(sc->text + start, pos - start);
+		if (current_token == ID)		// get_token() INTERNS IT
+			value = (int) ident_hash_of(sc->text + start, pos - start);
+	}
+	
+	sc->tk.kind[i] = current_token | flags;
+	sc->tk.off[i] = start;
+	sc->tk.len[i] = pos - start;
+	sc->tk.val[i] = value;
+	sc->tk.line[i] = sc_line;
+	sc->tk.col[i] = sc_col;
 	
+	__atomic_store_n(&sc->n_lexed, i + 1, __ATOMIC_RELEASE);
+	if (current_token == ENDFILE)
+		__atomic_store_n(&sc->lex_done, true, __ATOMIC_RELEASE);
 	return current_token;
 }
+
+// FALSE IF SLOT i IS PAST THE LAST ENDFILE -- WAITS FOR THE SCANNER
+// THREAD IF THERE IS ONE, OR SCANS AS FAR AS i ITSELF
+static bool have_token(size_t i)
+{
+	for (;;) {
+		if (i < __atomic_load_n(&sc->n_lexed, __ATOMIC_ACQUIRE))
+			return true;
+		if (__atomic_load_n(&sc->lex_done, __ATOMIC_ACQUIRE))
+			return i < __atomic_load_n(&sc->n_lexed, __ATOMIC_ACQUIRE);
+		if (threaded)
+			sched_yield();
+		else
+			lex_token();
+	}
+}
+
+token_t get_token(void)
+{
+	size_t i = next_tok;
+	
+	if (!have_token(i)) {
+		// ONCE MORE AT EOF -- AS IF THE SCANNER RAN INTO IT AGAIN
+		lineno++;
+		tok.off = sc->text_size;
+		tok.len = 0;
+		tok.kind = ENDFILE;
+		tok.val = 0;
+		if (trace_scan)
+			trace_token(lineno, ENDFILE, "");
+		return ENDFILE;
+	}
+	
+	next_tok++;
+	tok.kind = sc->tk.kind[i] & ~TK_EARLY;
+	tok.off = sc->tk.off[i];
+	tok.len = sc->tk.len[i];
+	tok.val = sc->tk.val[i];
+	if (tok.kind == ID)			// ON THIS THREAD -- NOT THE SCANNER'S
+		tok.val = intern(sc->text + tok.off, tok.len, (uint) tok.val);
+	lineno = sc->tk.line[i];
+	linecol = sc->tk.col[i];
+	if (echo_source)
+		echo_to(lineno);
+	if (sc->tk.kind[i] & TK_EARLY)
+		PANIC(12, "Met EOF in advance");
+	if (trace_scan)
+		trace_token(lineno, tok.kind, tok_text());
+	return tok.kind;
+}
+
+token_t peek_token(uint k)
+{
+	size_t i = next_tok + k - 1;
+	if (next_tok == 0 || !have_token(i))
+		return ENDFILE;
+	return sc->tk.kind[i] & ~TK_EARLY;
+}
@@ -3,10 +3,53 @@
 
 #define MAX_REVERSED 6
 
-#define MAX_TOK_SIZE 64
+#define MAX_TOK_SIZE 64			// LONGEST tok_text()
 
-extern char lexeme[MAX_TOK_SIZE];		// scan.c
+// A TOKEN IS A SPAN OF THE SOURCE -- ITS TEXT IS ONLY COPIED OUT
+// WHEN ASKED FOR BY tok_text() -- AN ID IS INTERNED INSTEAD
+typedef struct span_t {
+	uint off;			// BYTE OFFSET INTO THE SOURCE
+	uint len;
+	token_t kind;
+	int val;			// VALUE OF A NUM -- ident_t OF AN ID
+} span_t;
 
+extern __thread span_t tok;	// LAST TOKEN FROM get_token()
+
+// MAPS THE WHOLE OF A FILE (OR READS IT IF IT CANNOT BE MAPPED) -- A
+// LARGE ONE IS THEN SCANNED BY A THREAD OF ITS OWN AHEAD OF THE PARSER
+bool scan_open(FILE *);
+
+// scan_open() IN TWO -- THE TEXT OF THE FILE IS THERE FOR scan_text()
+// BEFORE ANY OF IT IS LEXED -- scan_close() EVEN IF NEVER STARTED
+bool scan_load(FILE *);
+
+cchar *scan_text(size_t *);
+
+bool scan_start(void);
+
+// THE size BYTES AT text INSTEAD -- LENT, SO THEY MUST STAY TILL
+// scan_close()
+bool scan_open_text(cchar *, size_t);
+
+// KEEPS THE TOKEN ARRAYS OF A SMALL SOURCE FOR THE NEXT ONE ON THE THREAD
+void scan_close(void);
+
+// UNMAPS WHAT scan_close() KEPT
+void scan_drop(void);
+
+// MOST TOKENS THE SOURCE CAN HOLD -- SO ALSO MOST NODES OF ITS TREE
+size_t scan_max_tokens(void);
+
+// NEXT PRE-LEXED TOKEN -- ALSO SETS tok, lineno AND linecol AND
+// LISTS WHAT -e AND -s ASK FOR
 token_t get_token(void);
 
+// k TOKENS PAST THE LAST ONE FROM get_token() -- WHICH IS k = 0
+token_t peek_token(uint);
+
+// TEXT OF tok -- IN A STATIC BUFFER CUT AT MAX_TOK_SIZE-1 FOR
+// DIAGNOSTICS -- OR WHOLE IN A malloc()'D STRING
+cchar *tok_text(void);
+
 #endif
@@ -0,0 +1,313 @@
+// ERRNO: [131, 140]
+#define _DEFAULT_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "globals.h"
+#include "libcm.h"
+#include "serve.h"
+
+// A THREAD OF ITS OWN poll()S THE LISTENING SOCKET AND EVERY
+// CONNECTION WAITING FOR ITS NEXT REQUEST -- ONE WITH A REQUEST IN GOES
+// ON queue FOR A WORKER, WHICH ANSWERS THAT ONE REQUEST AND HANDS IT
+// BACK -- SO A WORKER IS ONLY HELD WHILE IT COMPILES -- ITS cm_context
+// AND WHAT THE COMPILER KEEPS ON THE THREAD STAY WARM FOR THE NEXT
+typedef struct server_t {
+	int fd;					// LISTENING
+	int back[2];			// A WORKER HANDS A CONNECTION BACK DOWN back[1]
+	cchar *cache;			// SEE cm_set_cache()
+	size_t cache_max;
+	bool is_incremental;	// SEE cm_set_incremental()
+	pthread_mutex_t lock;
+	pthread_cond_t ready;	// queue ISN'T EMPTY
+	int *queue;				// A RING OF count FROM head
+	uint head, count, room;
+} server_t;
+
+// A CLIENT THAT STOPS HALFWAY THROUGH A REQUEST -- OR DOESN'T READ ITS
+// REPLY -- LOSES ITS CONNECTION AFTER THIS LONG
+#define TIMEOUT_SECS	10
+
+// OUT OF DESCRIPTORS, NO CONNECTION IS ACCEPTED FOR THIS LONG
+#define BACKOFF_MS		100
+
+static bool reply(int fd, int status, cchar *out, size_t out_len, cchar *lst, size_t lst_len)
+{
+	serve_rep_t rep = {SERVE_MAGIC, status, out_len, lst_len};
+	return serve_write_all(fd, &rep, sizeof(rep)) &&
+		serve_write_all(fd, out, out_len) && serve_write_all(fd, lst, lst_len);
+}
+
+// A REQUEST THAT CAN'T BE COMPILED GETS ITS REASON AS THE LISTING --
+// THE CONNECTION THEN CLOSES, AS WHAT FOLLOWS CAN'T BE TRUSTED
+static void refuse(int fd, uint no, cchar *msg)
+{
+	char text[LENGTH];
+	int len = snprintf(text, sizeof(text), "[!] ERROR (NO.%u): %s\n", no, msg);
+	reply(fd, -1, NULL, 0, text, len);
+}
+
+// ONE REQUEST OF fd -- FALSE IF THE CONNECTION IS TO CLOSE -- buf OF
+// room BYTES IS THE WORKER'S, KEPT FOR ITS NEXT REQUEST
+static bool answer(int fd, cm_context *c, char **buf, size_t *room)
+{
+	serve_req_t req;
+	size_t need, out_len, lst_len;
+	cchar *out, *lst;
+	int r;
+	if (!serve_read_all(fd, &req, sizeof(req)))
+		return false;
+	if (req.magic != SERVE_MAGIC) {
+		refuse(fd, 131, "Not a C- request");
+		return false;
+	}
+	if (req.target > TG_C || req.name_len > SERVE_NAME_MAX || req.src_len > SERVE_SRC_MAX) {
+		refuse(fd, 132, "Request out of range");
+		return false;
+	}
+	need = req.name_len + 1 + req.src_len;
+	if (need > *room) {
+		char *more = realloc(*buf, need);
+		if (more == NULL) {
+			refuse(fd, 133, "Memory exhausted in serve()");
+			return false;
+		}
+		*buf = more;
+		*room = need;
+	}
+	if (!serve_read_all(fd, *buf, req.name_len) ||
+		!serve_read_all(fd, *buf + req.name_len + 1, req.src_len))
+		return false;
+	(*buf)[req.name_len] = '\0';
+
+	cm_set_target(c, req.target);
+	cm_set_listing(c, req.parts & (CM_LIST_ALL | CM_LIST_MEMORY), NULL);
+	r = cm_compile(c, *buf, *buf + req.name_len + 1, req.src_len);
+	out = cm_output(c, &out_len);
+	lst = cm_listing(c, &lst_len);
+	return reply(fd, r, out, out_len, lst, lst_len);
+}
+
+static void *work(void *arg)
+{
+	server_t *s = arg;
+	cm_context *c = cm_open();
+	char *buf = NULL;
+	size_t room = 0;
+	if (c == NULL) {
+		fprintf(stderr, "[!] ERROR (NO.133): Memory exhausted in serve()\n");
+		return NULL;
+	}
+	if (s->cache != NULL && !cm_set_cache(c, s->cache, s->cache_max))
+		fprintf(stderr, "[!] ERROR (NO.138): Cannot keep a cache in `%s'\n", s->cache);
+	cm_set_incremental(c, s->is_incremental);
+	for (;;) {
+		int fd;
+		pthread_mutex_lock(&s->lock);
+		while (s->count == 0)
+			pthread_cond_wait(&s->ready, &s->lock);
+		fd = s->queue[s->head];
+		s->head = (s->head + 1) % s->room;
+		s->count--;
+		pthread_mutex_unlock(&s->lock);
+		// A WRITE OF AN int DOWN A PIPE IS WHOLE OR NOT AT ALL
+		if (!answer(fd, c, &buf, &room) || write(s->back[1], &fd, sizeof(fd)) != sizeof(fd))
+			close(fd);
+	}
+	return NULL;
+}
+
+static bool enqueue(server_t *s, int fd)
+{
+	bool is_ok = true;
+	pthread_mutex_lock(&s->lock);
+	if (s->count == s->room) {
+		uint room = s->room ? 2 * s->room : 64;
+		int *more = malloc(room * sizeof(int));
+		if (more != NULL) {
+			for (uint i = 0; i < s->count; i++)
+				more[i] = s->queue[(s->head + i) % s->room];
+			free(s->queue);
+			s->queue = more;
+			s->head = 0;
+			s->room = room;
+		}
+		is_ok = more != NULL;
+	}
+	if (is_ok) {
+		s->queue[(s->head + s->count++) % s->room] = fd;
+		pthread_cond_signal(&s->ready);
+	}
+	pthread_mutex_unlock(&s->lock);
+	return is_ok;
+}
+
+// THE SET poll_all() WATCHES -- THE LISTENING SOCKET, back[0], THEN THE
+// CONNECTIONS WAITING FOR A REQUEST
+typedef struct watch_t {
+	struct pollfd *set;
+	nfds_t n, room;
+} watch_t;
+
+static bool watch(watch_t *w, int fd)
+{
+	if (w->n == w->room) {
+		nfds_t room = w->room ? 2 * w->room : 64;
+		struct pollfd *more = realloc(w->set, room * sizeof(struct pollfd));
+		if (more == NULL)
+			return false;
+		w->set = more;
+		w->room = room;
+	}
+	w->set[w->n++] = (struct pollfd) {fd, POLLIN, 0};
+	return true;
+}
+
+static long long now_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+static void *poll_all(void *arg)
+{
+	server_t *s = arg;
+	struct timeval timeout = {TIMEOUT_SECS, 0};
+	watch_t w = {NULL, 0, 0};
+	long long resting = 0;			// TILL THEN -- OUT OF DESCRIPTORS
+	if (!watch(&w, s->fd) || !watch(&w, s->back[0])) {
+		fprintf(stderr, "[!] ERROR (NO.133): Memory exhausted in serve()\n");
+		return NULL;
+	}
+	for (;;) {
+		long long left = resting - now_ms();
+		int back[64];
+		ssize_t got;
+		w.set[0].fd = left > 0 ? -1 : s->fd;		// poll() SKIPS A NEGATIVE fd
+		if (poll(w.set, w.n, left > 0 ? (int) left : -1) < 0) {
+			if (errno == EINTR || errno == ENOMEM)
+				continue;
+			break;
+		}
+		// A REQUEST IN -- OR THE CLIENT GONE, WHICH NEEDS NO WORKER
+		for (nfds_t i = 2; i < w.n; ) {
+			int fd = w.set[i].fd;
+			short ev = w.set[i].revents;
+			if (ev == 0) {
+				i++;
+				continue;
+			}
+			w.set[i] = w.set[--w.n];
+			if ((ev & POLLIN) == 0 || !enqueue(s, fd))
+				close(fd);
+		}
+		if (w.set[1].revents & POLLIN) {
+			got = read(s->back[0], back, sizeof(back));
+			for (ssize_t i = 0; i < got / (ssize_t) sizeof(int); i++)
+				if (!watch(&w, back[i]))
+					close(back[i]);
+		}
+		if (w.set[0].revents & POLLIN) {
+			int fd = accept(s->fd, NULL, NULL);
+			if (fd < 0 && (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM))
+				resting = now_ms() + BACKOFF_MS;
+			else if (fd >= 0) {
+				setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+				setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+				if (!watch(&w, fd))
+					close(fd);
+			}
+		}
+	}
+	return NULL;
+}
+
+// A SOCKET LEFT BY A SERVER THAT DIED MAY GO -- NOT ONE STILL ANSWERING
+// AND NOT A FILE THAT ISN'T A SOCKET AT ALL
+static bool clear_path(const struct sockaddr_un *addr)
+{
+	struct stat st;
+	int fd;
+	bool is_live;
+	if (lstat(addr->sun_path, &st) != 0)
+		return errno == ENOENT;
+	if (!S_ISSOCK(st.st_mode))
+		return false;
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	is_live = fd >= 0 && connect(fd, (const struct sockaddr *) addr, sizeof(*addr)) == 0;
+	if (fd >= 0)
+		close(fd);
+	return !is_live && unlink(addr->sun_path) == 0;
+}
+
+int serve(cchar *path, uint threads, cchar *cache, size_t cache_max, bool is_incremental)
+{
+	static server_t s;
+	struct sockaddr_un addr;
+	sigset_t stop;
+	pthread_t thread;
+	uint started = 0;
+	int sig;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "[!] ERROR (NO.134): Socket path `%s' is too long\n", path);
+		return -1;
+	}
+	strcpy(addr.sun_path, path);
+	s.cache = cache;
+	s.cache_max = cache_max;
+	s.is_incremental = is_incremental;
+	pthread_mutex_init(&s.lock, NULL);
+	pthread_cond_init(&s.ready, NULL);
+	if (!clear_path(&addr)) {
+		fprintf(stderr, "[!] ERROR (NO.135): `%s' is taken\n", path);
+		return -1;
+	}
+	s.fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (s.fd < 0 || pipe(s.back) != 0 || bind(s.fd, (struct sockaddr *) &addr, sizeof(addr)) != 0 ||
+		listen(s.fd, SOMAXCONN) != 0) {
+		fprintf(stderr, "[!] ERROR (NO.136): Cannot listen on `%s'\n", path);
+		if (s.fd >= 0)
+			close(s.fd);
+		return -1;
+	}
+
+	// ONLY THIS THREAD TAKES THE SIGNALS THAT STOP THE SERVER -- THE
+	// WORKERS INHERIT THE MASK
+	sigemptyset(&stop);
+	sigaddset(&stop, SIGINT);
+	sigaddset(&stop, SIGTERM);
+	sigaddset(&stop, SIGHUP);
+	pthread_sigmask(SIG_BLOCK, &stop, NULL);
+
+	for (uint t = 0; t < threads; t++)
+		if (pthread_create(&thread, NULL, work, &s) == 0) {
+			pthread_detach(thread);
+			started++;
+		}
+	if (started != 0 && pthread_create(&thread, NULL, poll_all, &s) == 0)
+		pthread_detach(thread);
+	else
+		started = 0;
+	if (started == 0) {
+		fprintf(stderr, "[!] ERROR (NO.137): Cannot start a thread to serve on\n");
+		close(s.fd);
+		unlink(path);
+		return -1;
+	}
+	fprintf(stderr, "[*] C- SERVER: listening on `%s' with %u thread(s)\n", path, started);
+
+	sigwait(&stop, &sig);
+	unlink(path);				// NO NEW CLIENT FINDS IT -- THEN EXIT
+	fprintf(stderr, "[*] C- SERVER: stopped by signal %d\n", sig);
+	return 0;
+}
@@ -0,0 +1,43 @@
+#ifndef _SERVE_H_
+#define _SERVE_H_
+
+#include <stdint.h>
+#include "globals.h"
+
+// A CLIENT SENDS ANY NUMBER OF REQUESTS DOWN ONE CONNECTION AND GETS A
+// REPLY TO EACH IN TURN -- WORDS ARE IN HOST ORDER, THE SOCKET BEING
+// LOCAL -- name THEN src FOLLOW A REQUEST, out THEN lst A REPLY
+#define SERVE_MAGIC		0x434d2d31u		// "CM-1"
+
+#define SERVE_NAME_MAX	4096
+#define SERVE_SRC_MAX	(64u * 1024 * 1024)
+
+typedef struct serve_req_t {
+	uint32_t magic;
+	uint32_t target;		// target_k
+	uint32_t parts;			// CM_LIST_* OF libcm.h
+	uint32_t name_len;
+	uint32_t src_len;
+} serve_req_t;
+
+typedef struct serve_rep_t {
+	uint32_t magic;
+	int32_t status;			// AS cm_compile()
+	uint32_t out_len;
+	uint32_t lst_len;
+} serve_rep_t;
+
+// ALL n BYTES OR FALSE -- FOR BOTH ENDS, SO serveio.c IS LINKED INTO
+// cm AND cmc
+bool serve_read_all(int fd, void *, size_t n);
+
+bool serve_write_all(int fd, const void *, size_t n);
+
+// COMPILES WHAT COMES DOWN THE UNIX SOCKET AT path ON threads THREADS,
+// EACH KEEPING ITS COMPILER WARM BETWEEN REQUESTS -- TILL SIGINT OR
+// SIGTERM, WHEN IT REMOVES THE SOCKET AND RETURNS 0 -- -1 IF IT
+// COULDN'T START -- cache AS FOR cm_set_cache(), NULL FOR NONE, AND
+// is_incremental AS FOR cm_set_incremental()
+int serve(cchar *path, uint threads, cchar *cache, size_t cache_max, bool is_incremental);
+
+#endif
@@ -0,0 +1,39 @@
+#define _DEFAULT_SOURCE
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "globals.h"
+#include "serve.h"
+
+// BOTH ENDS OF THE SOCKET OF serve.h -- cm --serve AND cmc
+
+bool serve_read_all(int fd, void *buf, size_t n)
+{
+	char *p = buf;
+	while (n > 0) {
+		ssize_t got = read(fd, p, n);
+		if (got < 0 && errno == EINTR)
+			continue;
+		if (got <= 0)
+			return false;
+		p += got;
+		n -= got;
+	}
+	return true;
+}
+
+// A PEER GONE ISN'T WORTH A SIGPIPE
+bool serve_write_all(int fd, const void *buf, size_t n)
+{
+	const char *p = buf;
+	while (n > 0) {
+		ssize_t put = send(fd, p, n, MSG_NOSIGNAL);
+		if (put < 0 && errno == EINTR)
+			continue;
+		if (put <= 0)
+			return false;
+		p += put;
+		n -= put;
+	}
+	return true;
+}
@@ -1,184 +1,317 @@
 // ERRNO: [41, 50]
 #include "symtab.h"
 #include "utils.h"
+#include "intern.h"
 
-#define MAX_TAB_SIZE 257
+// EVERY DECLARATION IN SCOPE IS ONE symbol_t OF sym[] IN THE ORDER IT
+// WAS MET -- SO A SCOPE IS THE RUN OF sym[] FROM ITS scope_base[] TO
+// THE END AND LEAVING IT ONLY WALKS THAT RUN BACK
+//
+// slot[] MAPS AN IDENTIFIER BY LINEAR PROBING TO ITS INNERMOST
+// DECLARATION -- WHICH KEEPS THE ONE IT SHADOWS -- A KEY STAYS ONCE
+// PUT IN (WITH top 0 OUT OF SCOPE) SO NOTHING IS EVER DELETED
+typedef struct slot_t {
+	ident_t id;			// ID_NONE IF EMPTY
+	uint top;			// INDEX IN sym[] -- 0 IF NOT IN SCOPE
+} slot_t;
 
-// USED IN name OF hash_t TO
-// SEPARATE DIFFERENT SCOPE
-#define SCOPE_SEPARATOR ""
+typedef struct stats_t {
+	size_t searches;
+	size_t probes;
+	size_t longest;
+} stats_t;
 
-static hash_t * hashtable[MAX_TAB_SIZE];
+typedef struct table_t {
+	slot_t *slot;
+	uint slot_mask;
+	uint n_keys;
+	
+	symbol_t *sym;			// sym[0] IS NO SYMBOL
+	uint n_sym;
+	uint sym_room;
+	
+	uint *scope_base;		// scope_base[0] IS THE OUT-MOST SCOPE
+	uint scope_room;
+	uint scopeno;
+	
+	stats_t stats;
+} table_t;
+
+// THE GLOBAL SCOPE -- BUILT BY ONE THREAD, THEN ONLY READ -- AND THE
+// SEARCHES OF THE local TABLES CLOSED SO FAR -- ONE OF EACH PER
+// COMPILATION, WHICH THE THREADS CHECKING ITS BODIES SHARE
+struct symtab_t {
+	table_t global;
+	stats_t closed;
+};
+
+static __thread symtab_t own;
+static __thread symtab_t *st;		// own OR THE ONE ADOPTED
+
+// THE TABLE EACH THREAD DECLARES IN: THE GLOBAL ONE OR A FUNCTION'S OWN
+static __thread table_t local;
+static __thread table_t *tab;
+
+// GLOBALS BELOW THIS ARE THE ONES THE FUNCTION IN local CAN SEE
+static __thread uint visible;
+
+#define SLOTS_MIN 256
+#define SYMS_MIN 256
+#define SCOPES_MIN 32
 
-static hash_t * scoped_list;
+static bool open_table(table_t *);
 
-static uint scopeno;
+static void close_table(table_t *);
 
-static hash_t * new_symbol_node(
-	cchar *, 
-	node_t *, 
-	uint
-);
+static slot_t *find_slot(const table_t *, ident_t);
 
-static uint hash_func(cchar *);
+static bool grow_slots(table_t *);
+
+static void *grow(void *, uint *, uint, size_t);
+
+static uint hash_func(ident_t);
 
 static void symtab_error(cchar *);
 
 static void format_symbol_type(const node_t *);
 
-static void do_dump_current_scope(hash_t *);
-
 void init_symtab(void)
 {
-	memset(hashtable, (int) NULL, sizeof(hash_t *) * MAX_TAB_SIZE);
-	scoped_list = NULL;
+	st = &own;
+	close_symtab();
+	memset(&st->closed, 0, sizeof(stats_t));
+	if (!open_table(&st->global)) {
+		PANIC(41, "Memory exhausted in init_symtab()");
+		exit(-2);
+	}
+	tab = &st->global;
+}
+
+void close_symtab(void)
+{
+	close_table(&st->global);
 }
 
-void insert_symbol(cchar *name, node_t *node, uint line)
+void open_local_symtab(uint globals)
 {
+	if (!open_table(&local)) {
+		PANIC(45, "Memory exhausted in open_local_symtab()");
+		exit(-2);
+	}
+	tab = &local;
+	visible = globals;
+}
+
+void close_local_symtab(void)
+{
+	__atomic_fetch_add(&st->closed.searches, local.stats.searches, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&st->closed.probes, local.stats.probes, __ATOMIC_RELAXED);
+	size_t most = __atomic_load_n(&st->closed.longest, __ATOMIC_RELAXED);
+	while (local.stats.longest > most &&
+		!__atomic_compare_exchange_n(&st->closed.longest, &most, local.stats.longest,
+			false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		continue;
+	close_table(&local);
+	tab = &st->global;
+}
+
+symtab_t *symtab_state(void)
+{ return st; }
+
+void adopt_symtab(symtab_t *table)
+{
+	st = table;
+	tab = &st->global;
+}
+
+uint global_symbols(void)
+{ return st->global.n_sym; }
+
+void insert_symbol(ident_t name, node_t *node, uint line)
+{
+	slot_t *s;
 	if (is_symbol_declared(name)) {
-		sprintf(median, "Duplicate identifier `%s'", name);
+		sprintf(median, "Duplicate identifier `%s'", ident_name(name));
 		symtab_error(median);
 		return ;
 	}
-	hash_t *new_node, *temp;
-	uint hashno = hash_func(name);
-	new_node = new_symbol_node(name, node, line);
-	// APPEND IT TO HEAD OF `hashtable[hashno]'
-	if (new_node != NULL) {
-		temp = hashtable[hashno];
-		hashtable[hashno] = new_node;
-		new_node->next = temp;
-	}
-	// APPEND IT TO HEAD OF scoped_list
-	new_node = new_symbol_node(name, node, line);
-	if (new_node != NULL) {
-		temp = scoped_list;
-		scoped_list = new_node;
-		new_node->next = temp;
+	// AT MOST HALF FULL -- SO GROW BEFORE A NEW KEY MAY GO IN
+	if (2 * (tab->n_keys + 1) > tab->slot_mask + 1 && !grow_slots(tab))
+		goto exhausted;
+	if (tab->n_sym == tab->sym_room &&
+		(tab->sym = grow(tab->sym, &tab->sym_room, SYMS_MIN, sizeof(symbol_t))) == NULL)
+		goto exhausted;
+	
+	s = find_slot(tab, name);
+	if (s->id == ID_NONE) {
+		s->id = name;
+		tab->n_keys++;
 	}
+	symbol_t *new_sym = tab->sym + tab->n_sym;
+	new_sym->id = name;
+	new_sym->decl = node;
+	new_sym->decl_line = line;
+	new_sym->shadow = s->top;
+	s->top = tab->n_sym++;
+	return ;
+	
+exhausted:
+	PANIC(43, "Memory exhausted in insert_symbol()");
+	exit(-2);
 }
 
-bool is_symbol_declared(cchar *name)
+// ONLY THE INNERMOST DECLARATION CAN BE IN THE CURRENT SCOPE
+bool is_symbol_declared(ident_t name)
 {
-	// SCAN CURRENT SCOPE FOR DUPLICATE DECLARATION
-	hash_t *cursor = scoped_list;
-	while (cursor != NULL && 
-		strcmp(cursor->name, SCOPE_SEPARATOR) != 0) {
-		if (strcmp(cursor->name, name) == 0)
-			return true;
-		cursor = cursor->next;
+	slot_t *s = find_slot(tab, name);
+	return s->id == name && s->top >= tab->scope_base[tab->scopeno];
+}
+
+// A FUNCTION'S OWN SCOPES FIRST -- THEN THE GLOBALS DECLARED BEFORE IT
+symbol_t * lookup_symbol(ident_t name)
+{
+	slot_t *s = find_slot(tab, name);
+	if (s->id == name && s->top != 0)
+		return tab->sym + s->top;
+	if (tab == &st->global)
+		return NULL;
+	s = find_slot(&st->global, name);
+	return (s->id == name && s->top != 0 && s->top < visible) ?
+		st->global.sym + s->top : NULL;
+}
+
+void enter_scope(void)
+{
+	if (tab->scopeno + 1 == tab->scope_room &&
+		(tab->scope_base = grow(tab->scope_base, &tab->scope_room,
+			SCOPES_MIN, sizeof(uint))) == NULL) {
+		PANIC(44, "Memory exhausted in enter_scope()");
+		exit(-2);
 	}
-	return false;
+	tab->scope_base[++tab->scopeno] = tab->n_sym;
 }
 
-hash_t * lookup_symbol(cchar *name)
+void leave_scope(void)
 {
-	uint hashno = hash_func(name);
-	hash_t *cursor = hashtable[hashno];
-	while (cursor != NULL) {
-		if (strcmp(cursor->name, name) == 0)
-			return cursor;
-		cursor = cursor->next;
+	assert(tab->scopeno > 0);
+	// EACH SYMBOL OF THE SCOPE GIVES ITS SLOT BACK TO THE ONE IT HID
+	for (uint i = tab->n_sym; i-- > tab->scope_base[tab->scopeno]; ) {
+		slot_t *s = find_slot(tab, tab->sym[i].id);
+		assert(s->id == tab->sym[i].id && s->top == i);
+		s->top = tab->sym[i].shadow;
 	}
-	return NULL;
+	tab->n_sym = tab->scope_base[tab->scopeno--];
 }
 
 void dump_current_scope(void)
 {
-	hash_t *cursor = scoped_list;
-	if (cursor != NULL && 
-		strcmp(cursor->name, SCOPE_SEPARATOR) != 0)
-		do_dump_current_scope(cursor);
+	for (uint i = tab->scope_base[tab->scopeno]; i < tab->n_sym; i++) {
+		symbol_t *cursor = tab->sym + i;
+		format_symbol_type(cursor->decl);
+		fprintf(
+			lst, "%-8d%-12s%-9d%c\t      %-30s\n", 
+			tab->scopeno, ident_name(cursor->id), cursor->decl_line, 
+			cursor->decl->is_parameter ? 'Y' : 'N', 
+			median
+		);
+	}
 }
 
-void enter_scope(void)
+void dump_symtab_stats(void)
 {
-	hash_t *new_node, *temp;
-	new_node = new_symbol_node(SCOPE_SEPARATOR, NULL, 0);
-	if (new_node == NULL) return ;
-	// APPEND new_node TO HEAD OF scoped_list
-	temp = scoped_list;
-	scoped_list = new_node;
-	new_node->next = temp;
-	scopeno++;
+	uint size = st->global.slot_mask + 1;
+	size_t searches = st->global.stats.searches + st->closed.searches;
+	size_t probes = st->global.stats.probes + st->closed.probes;
+	size_t longest = st->global.stats.longest > st->closed.longest ?
+		st->global.stats.longest : st->closed.longest;
+	fprintf(lst, "[*] Symbol table: %u global identifier(s) in %u slot(s), "
+		"load factor %.2f\n", st->global.n_keys, size,
+		(double) st->global.n_keys / size);
+	fprintf(lst, "[*] Symbol table: %zu search(es) took %zu probe(s), "
+		"%.2f on average, %zu at most\n", searches, probes,
+		searches ? (double) probes / searches : 0.0, longest);
 }
 
-void leave_scope(void)
+static bool open_table(table_t *t)
 {
-	hash_t *hashptr, *temp;
-	uint hashno;
-	while (scoped_list != NULL && 
-			strcmp(scoped_list->name, SCOPE_SEPARATOR) != 0) {
-		hashno = hash_func(scoped_list->name);
-		hashptr = hashtable[hashno];
-		
-		// NOTE THAT:
-		// SYMBOLS WERE INSERTED INTO THE hashtable AND scoped_list
-		// IN THE SAME ORDER -- SO THE NAME IN THE hashptr AND
-		// scoped_list MUST THE SAME -- USING assert() TO TEST IT
-		//
-		// ALSO NOTE:
-		// WHEN SYMBOLS INSERTED INTO hashtable AND scoped_list
-		// WE SIMPLY MAKE scoped_list POINT TO THE CORRESPONDING
-		// hashtable[hashno] SO THEY MUST BE THE SAME -- SO WE
-		// NEEDN'T TO JUDGE IF THEY HAVE THE SAME NAME OF STH. ELSE
-		//
-		// BESIDES:
-		// WE SIMPLY JUDGE name -- THERE ALSO HAVE decl AND
-		// decl_line IN IT -- WHICH WE HAVEN'T JUDGE IF THE SAME
-		assert(hashptr != NULL && 
-			strcmp(hashptr->name, scoped_list->name) == 0);
-		
-		// DELETE FROM hashtable
-		temp = hashptr->next;
-		free(hashptr);
-		hashtable[hashno] = temp;
-		
-		// DELETE FROM scoped_list
-		temp = scoped_list->next;
-		free(scoped_list);
-		scoped_list = temp;
+	memset(t, 0, sizeof(table_t));
+	t->n_sym = 1;
+	if (!grow_slots(t) ||
+		(t->sym = grow(NULL, &t->sym_room, SYMS_MIN, sizeof(symbol_t))) == NULL ||
+		(t->scope_base = grow(NULL, &t->scope_room, SCOPES_MIN, sizeof(uint))) == NULL)
+		return false;
+	t->scope_base[0] = t->n_sym;
+	return true;
+}
+
+static void close_table(table_t *t)
+{
+	free(t->slot);
+	free(t->sym);
+	free(t->scope_base);
+	memset(t, 0, sizeof(table_t));
+}
+
+// THE SLOT OF name -- OR THE EMPTY ONE IT WOULD GO IN -- COUNTED
+// AGAINST THE TABLE OF THIS THREAD SO THE GLOBAL ONE IS ONLY READ
+static slot_t *find_slot(const table_t *t, ident_t name)
+{
+	uint i = hash_func(name) & t->slot_mask, probes = 1;
+	while (t->slot[i].id != name && t->slot[i].id != ID_NONE) {
+		i = (i + 1) & t->slot_mask;
+		probes++;
 	}
-	
-	// DELETE SCOPE SEPARATOR
-	assert(scoped_list != NULL && 
-		strcmp(scoped_list->name, SCOPE_SEPARATOR) == 0);
-	temp = scoped_list->next;
-	free(scoped_list);
-	scoped_list = temp;
-	scopeno--;
-}
-
-static hash_t * new_symbol_node(
-	cchar *name, 
-	node_t *decl, 
-	uint line
-)
-{
-	hash_t *node = (hash_t *) malloc(sizeof(hash_t));
-	if (node == NULL) {
-		PANIC(41, "Memory exhausted in new_symbol_node()");
-		is_error = true;
-		return NULL;
+	tab->stats.searches++;
+	tab->stats.probes += probes;
+	if (probes > tab->stats.longest)
+		tab->stats.longest = probes;
+	return t->slot + i;
+}
+
+static bool grow_slots(table_t *t)
+{
+	uint old_size = t->slot ? t->slot_mask + 1 : 0;
+	uint size = old_size ? 2 * old_size : SLOTS_MIN;
+	slot_t *old = t->slot;
+	slot_t *grown = calloc(size, sizeof(slot_t));
+	if (grown == NULL)
+		return false;
+	t->slot = grown;
+	t->slot_mask = size - 1;
+	for (uint j = 0; j < old_size; j++) {
+		if (old[j].id == ID_NONE)
+			continue;
+		uint i = hash_func(old[j].id) & t->slot_mask;
+		while (t->slot[i].id != ID_NONE)
+			i = (i + 1) & t->slot_mask;
+		t->slot[i] = old[j];
 	}
-	node->name = copy_string(name);
-	node->decl = decl;
-	node->decl_line = line;
-	node->next = NULL;
-	return node;
+	free(old);
+	return true;
 }
 
-#define SHIFT 2
+// DOUBLES THE *room ELEMENTS OF size BYTES AT p -- OR MAKES least
+// OF THEM -- NULL IF IT CAN'T
+static void *grow(void *p, uint *room, uint least, size_t size)
+{
+	uint more = *room ? 2 * *room : least;
+	void *q = realloc(p, more * size);
+	if (q != NULL)
+		*room = more;
+	return q;
+}
 
-static uint hash_func(cchar *key)
+// THE SCANNER'S FNV-1a THROUGH MURMUR3'S FINALIZER -- SO THE LOW BITS
+// slot_mask KEEPS DEPEND ON ALL OF IT
+static uint hash_func(ident_t key)
 {
-	uint value = 0;
-	for (uint i = 0; key[i] != '\0'; i++)
-		value = (value << SHIFT) + key[i];
-	if (value >= MAX_TAB_SIZE)
-		value %= MAX_TAB_SIZE;
-	return value;
+	uint h = ident_hash(key);
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35u;
+	h ^= h >> 16;
+	return h;
 }
 
 static void symtab_error(cchar *msg)
@@ -194,7 +327,7 @@ static void format_symbol_type(const node_t *node)
 		sprintf(
 			median, 
 			"Excepted a declaration type Got `%s'", 
-			node->name
+			NAME(node)
 		);
 		return ;
 	}
@@ -219,19 +352,3 @@ static void format_symbol_type(const node_t *node)
 		break;
 	}
 }
-
-#define MAX_ID_LEN 64	// MAX_TOK_SIZE = 64
-
-static void do_dump_current_scope(hash_t *cursor)
-{	// PADDED NAME
-	if (cursor->next != NULL && 
-		strcmp(cursor->next->name, SCOPE_SEPARATOR) != 0)
-		do_dump_current_scope(cursor->next);
-	format_symbol_type(cursor->decl);
-	fprintf(
-		lst, "%-8d%-12s%-9d%c\t      %-30s\n", 
-		scopeno, cursor->name, cursor->decl_line, 
-		cursor->decl->is_parameter ? 'Y' : 'N', 
-		median
-	);
-}
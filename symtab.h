@@ -3,23 +3,48 @@
 
 #include "globals.h"
 
-typedef struct hash_t {
-	struct hash_t *next;
-	char *name;
+typedef struct symbol_t {
+	ident_t id;
 	node_t *decl;
 	uint decl_line;
-} hash_t;
+	uint shadow;		// DECLARATION OF id IT HIDES -- 0 IF NONE
+} symbol_t;
 
+typedef struct symtab_t symtab_t;
+
+// OPENS THE GLOBAL SCOPE
 void init_symtab(void);
 
-void insert_symbol(cchar *, node_t *, uint);
+void close_symtab(void);
+
+// A FUNCTION'S OWN TABLE FOR THIS THREAD -- OVER THE GLOBAL ONE, OF
+// WHICH IT SEES THE FIRST globals SYMBOLS -- WHILE NO THREAD DECLARES
+// IN THE GLOBAL ONE ANY MORE
+void open_local_symtab(uint);
+
+void close_local_symtab(void);
+
+// THE GLOBAL SCOPE OF THIS THREAD'S COMPILATION -- A THREAD CHECKING
+// ITS BODIES TAKES IT OVER WITH adopt_symtab() BEFORE open_local_symtab()
+symtab_t *symtab_state(void);
 
-bool is_symbol_declared(cchar *);
+void adopt_symtab(symtab_t *);
 
-hash_t * lookup_symbol(cchar *);
+// HOW MANY SYMBOLS THE GLOBAL SCOPE HAS SO FAR -- FOR open_local_symtab()
+uint global_symbols(void);
+
+void insert_symbol(ident_t, node_t *, uint);
+
+bool is_symbol_declared(ident_t);
+
+// INNERMOST DECLARATION IN SCOPE -- GOOD UNTIL THE NEXT insert_symbol()
+symbol_t * lookup_symbol(ident_t);
 
 void dump_current_scope(void);
 
+// LOAD FACTOR AND PROBE LENGTHS SO FAR
+void dump_symtab_stats(void);
+
 void enter_scope(void);
 
 void leave_scope(void);
@@ -0,0 +1,35 @@
+// THE TOKENS OF EACH SOURCE ON THE COMMAND LINE, ONE A LINE -- KIND,
+// line:col, off+len AND THE VALUE OF A NUM OR THE NAME OF AN ID -- TO
+// BE COMPARED WITH THE .tok NEXT TO IT (SEE scantest IN MakeCM)
+#include "globals.h"
+#include "scan.h"
+#include "intern.h"
+
+int main(int argc, char *argv[])
+{
+	lst = stderr;
+	echo_source = trace_scan = false;
+	for (int i = 1; i < argc; i++) {
+		FILE *src = fopen(argv[i], "r");
+		token_t kind;
+		if (src == NULL || !intern_open() || !scan_open(src)) {
+			fprintf(stderr, "scandump: cannot scan `%s'\n", argv[i]);
+			return 1;
+		}
+		do {
+			kind = get_token();
+			printf("%s %u:%u", token_map[kind], lineno, linecol);
+			if (kind != ENDFILE)		// ITS SPAN AFTER AN EARLY EOF IS UNUSED
+				printf(" %u+%u", tok.off, tok.len);
+			if (kind == NUM)
+				printf(" %d", tok.val);
+			else if (kind == ID)
+				printf(" %s", ident_name(tok.val));
+			printf("\n");
+		} while (kind != ENDFILE);
+		scan_close();
+		intern_close();
+		fclose(src);
+	}
+	return 0;
+}
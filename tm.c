@@ -1,93 +1,45 @@
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE		// MAP_ANONYMOUS AND madvise()
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include <ctype.h>
 #include <fcntl.h>
-
-#ifndef bool
-    typedef enum {false, true} bool;
-#endif
-typedef const char cchar;
-
-#define   CMD_SIZE   1024	// INSTRUCTION
-#define   STK_SIZE   1024	// STACK
-#define   REG_SIZE 		6	// REGISTER
-#define   PC_REG 		2
-#define   FP_REG 		4
-#define   TP_REG 		5
-
-#define   LINE_LIM    256
-#define   WORD_LIM     32
-
-typedef enum op_type {
-	T_RO, 		// REG OPERANDS r, s, t
-	T_RM, 		// REG r OFF d STK s
-	T_RA		// REG r INT d + s
-} op_type;
-
-typedef enum op_code {
-	
-	// REGISTER-ONLY INSTRUCTION
-	OP_HALT, 	// HALT -- OPERANDS ARE IGNORED
-	OP_RET, 	// RESTORE FP AND PC -- OPERANDS INGORED
-	OP_IN, 		// READ INT INTO reg[r] -- s, t IGNORED
-	OP_OUT, 	// WRITE FROM reg[r] -- s, t IGNORED
-	OP_ADD, 	// reg[r] = reg[s] + reg[t]
-	OP_SUB, 	// reg[r] = reg[s] - reg[t]
-	OP_MUL, 	// reg[r] = reg[s] * reg[t]
-	OP_DIV, 	// reg[r] = reg[s] / reg[t]
-	RO_LIM, 
-
-	// REGISTER-TO-MEMORY
-	OP_LD, 		// reg[r] = stk[d + reg[s]]
-	OP_ST, 		// stk[d + reg[s]] = reg[r]
-	RM_LIM, 
-	
-	// REGISTER-TO-ADDRESS
-	OP_LS, 		// LD AND ST FOR d TIMES -- r, s INGORED
-	OP_LDA, 	// reg[r] = d + reg[s]
-	OP_LDC, 	// reg[r] = d -- s IGNORED
-	OP_JLT,     // reg[PC_REG] = d + reg[s] IF reg[r] <  0
-	OP_JLE,     // reg[PC_REG] = d + reg[s] IF reg[r] <= 0
-	OP_JGT,     // reg[PC_REG] = d + reg[s] IF reg[r] >  0
-	OP_JGE,     // reg[PC_REG] = d + reg[s] IF reg[r] >= 0
-	OP_JEQ,     // reg[PC_REG] = d + reg[s] IF reg[r] == 0
-	OP_JNE,     // reg[PC_REG] = d + reg[s] IF reg[r] != 0
-	RA_LIM
-} op_code;
-
-typedef enum op_result {
-   R_OKAY, 
-   R_HALT, 
-   R_CMD_ERR, 
-   R_STK_ERR, 
-   R_ZERO_DIV
-} op_result;
-
-typedef struct op_cmd {
-	op_code cop;
-	int carg1;
-	int carg2;
-	int carg3;
-} op_cmd;
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "tm.h"
 
 int iloc = 0;
 int sloc = 0;
 int trace_flag = false;
 int icount_flag = false;
+int batch_flag = false;		// SET BY --run -- NO PROMPT NOR DECORATION
+
+static op_cmd *text_code = NULL;	// INSTRUCTION MEMORY OF A TEXT PROGRAM
+static int cmd_size = 0;			// ITS SIZE IN LOCATIONS
+op_cmd *instruction = NULL;
+int code_size = 0;
+
+// WORDS GIVEN BY --imem AND --dmem -- 0 WHEN NOT GIVEN
+static int imem_flag = 0;
+static int dmem_flag = 0;
 
-op_cmd instruction[CMD_SIZE];
-int stack[STK_SIZE];
+// op_cmd MUST MATCH tmb_insn TO RUN A MAPPED CODE SECTION IN PLACE
+typedef char op_cmd_size_check[sizeof(op_cmd) == sizeof(tmb_insn) ? 1 : -1];
+
+// OPTIONAL SECTIONS OF A MAPPED .tmb
+static const tmb_sym *symbols = NULL;
+static uint32_t sym_count = 0;
+static const uint32_t *lines = NULL;
+static const char *strings = NULL;
+int *stack = NULL;
+int stk_size = 0;
 int reg[REG_SIZE];
 
-static cchar * opcode_map[] = {
-	// RO OPERANDS
-	"HALT", "RET", "IN", "OUT", "ADD", "SUB", "MUL", "DIV", "???", 
-	// RM
-	"LD", "ST", "???", 
-	// RA
-	"LS", "LDA", "LDC", "JLT", "JLE", "JGT", "JGE", "JEQ", "JNE", "???"
-};
+static cchar * opcode_map[] = { OPCODE_NAMES };
 
 static cchar *reg_map[] = {
 	"AX", "BX", "PC", 
@@ -96,10 +48,12 @@ static cchar *reg_map[] = {
 
 static cchar * result_map[] = {
 	"OK", "Halted", "Instruction Memory Fault", 
-	"Data Memory Fault", "Division by 0"
+	"Data Memory Fault", "Division by 0", "Input Exhausted"
 };
 
 FILE *fin;
+FILE *in_stream;		// IN VALUES IN BATCH MODE
+FILE *out_stream;		// OUT VALUES IN BATCH MODE
 
 char buffer[LINE_LIM];
 int len;
@@ -117,10 +71,23 @@ op_type get_op_type(op_code c)
 	return T_RA;
 }
 
+// NAME OF THE FUNCTION STARTING AT loc -- NULL IF NONE KNOWN
+static cchar * symbol_at(int loc)
+{
+	uint32_t i;
+	for (i = 0; i < sym_count; i++)
+		if (symbols[i].loc == (uint32_t) loc)
+			return strings + symbols[i].name;
+	return NULL;
+}
+
 void print_command(int loc)
 {
+	cchar *name = symbol_at(loc);
+	if (name != NULL)
+		printf("%s:\n", name);
 	printf("%5d: ", loc);
-	if (loc >= 0 && loc < CMD_SIZE) {
+	if (loc >= 0 && loc < code_size) {
 		printf("%6s%3d,", opcode_map[instruction[loc].cop], instruction[loc].carg1);
 		switch (get_op_type(instruction[loc].cop)) {
 			case T_RO:
@@ -132,6 +99,8 @@ void print_command(int loc)
 				printf("%3d(%1d)", instruction[loc].carg2, instruction[loc].carg3);
 			break;
 		}
+		if (lines != NULL && lines[loc] != 0)
+			printf("\t\tline %u", lines[loc]);
 		printf("\n");
 	}
 }
@@ -207,25 +176,102 @@ bool error(cchar *msg, int lineno, int cmdno)
 	return false;
 }
 
-int read_command(void)
+void *mem_map(size_t bytes)
 {
-	op_code op;
-	int arg1, arg2, arg3;
-	int loc, regno, lineno;
+	void *p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, 
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	return p == MAP_FAILED ? NULL : p;
+}
+
+void mem_unmap(void *p, size_t bytes)
+{
+	if (p != NULL)
+		munmap(p, bytes);
+}
+
+// THE NEXT TOUCH OF A DISCARDED PAGE MAPS A FRESH ZERO PAGE
+// BELOW MEM_DISCARD BYTES THE SYSCALL AND REFAULTS COST MORE THAN memset()
+#define MEM_DISCARD (64 * 1024)
+
+void mem_zero(void *p, size_t bytes)
+{
+	if (bytes < MEM_DISCARD) {
+		memset(p, 0, bytes);
+		return;
+	}
+#ifdef __linux__
+	madvise(p, bytes, MADV_DONTNEED);
+#else
+	mmap(p, bytes, PROT_READ | PROT_WRITE, 
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+#endif
+}
+
+// RESET REGISTERS AND STACK FOR A NEW EXECUTION
+void clear_machine(void)
+{
+	int regno;
 	// ALL REGISTERS INIT. ZERO
 	for (regno = 0; regno < REG_SIZE; regno++)
 		reg[regno] = 0;
 	// BEGIN FROM POSITION 1
 	reg[PC_REG] = 1;
-	reg[TP_REG] = STK_SIZE-1;
-	for (loc = 0; loc < STK_SIZE; loc++)
-		stack[loc] = 0;
-	for (loc = 0; loc < CMD_SIZE; loc++) {
-		instruction[loc].cop = OP_HALT;
-		instruction[loc].carg1 = 0;
-		instruction[loc].carg2 = 0;
-		instruction[loc].carg3 = 0;
-	}
+	reg[TP_REG] = stk_size-1;
+	mem_zero(stack, stk_size * sizeof(int));
+}
+
+// SIZE THE STACK -- --dmem WINS OVER words ASKED BY THE PROGRAM
+static bool alloc_stack(uint32_t words)
+{
+	int size = dmem_flag;
+	int *temp;
+	if (size == 0)
+		size = words < STK_SIZE ? STK_SIZE : words > MEM_LIM ? MEM_LIM : words;
+	if (size == stk_size)
+		return true;
+	temp = mem_map(size * sizeof(int));
+	if (temp == NULL)
+		return false;
+	mem_unmap(stack, stk_size * sizeof(int));
+	stack = temp;
+	stk_size = size;
+	return true;
+}
+
+// FRESH ZEROED (ALL HALT) INSTRUCTION MEMORY OF size LOCATIONS
+// KEEPING THE FIRST keep OF THE OLD ONE
+static bool alloc_text(int size, int keep)
+{
+	op_cmd *temp = mem_map(size * sizeof(op_cmd));
+	if (temp == NULL)
+		return false;
+	if (keep > 0)
+		memcpy(temp, text_code, keep * sizeof(op_cmd));
+	mem_unmap(text_code, cmd_size * sizeof(op_cmd));
+	text_code = temp;
+	cmd_size = size;
+	return true;
+}
+
+// MAKE ROOM FOR LOCATION loc UNLESS --imem FIXED THE SIZE
+static bool grow_text(int loc)
+{
+	int size = cmd_size;
+	if (imem_flag != 0 || loc >= MEM_LIM)
+		return false;
+	while (size <= loc)
+		size *= 2;
+	return alloc_text(size < MEM_LIM ? size : MEM_LIM, cmd_size);
+}
+
+// *stk_words GETS WHAT A TM_STK_COMMENT ASKS FOR -- 0 IF NONE DOES
+int read_command(uint32_t *stk_words)
+{
+	op_code op;
+	int arg1, arg2, arg3;
+	int loc, lineno;
+	if (!alloc_text(imem_flag ? imem_flag : CMD_SIZE, 0))
+		return error("Out of memory", 0, -1);
 	lineno = 0;
 	while (!feof(fin))
 	{				// "\n\0" 2 BYTES
@@ -237,6 +283,10 @@ int read_command(void)
 			buffer[len-1] = '\0';
 		else
 			buffer[len] = '\0';
+		if (strncmp(buffer, TM_STK_COMMENT, strlen(TM_STK_COMMENT)) == 0) {
+			unsigned long words = strtoul(buffer + strlen(TM_STK_COMMENT), NULL, 10);
+			*stk_words = words < UINT32_MAX ? words : UINT32_MAX;	// alloc_stack() CAPS IT
+		}
 		// COMMENT BEGINS WITH *
 		if (get_nonblank() && buffer[col] != '*') {
 			// OPCODE FORM -> `LINENO: OP A, B, C'
@@ -244,7 +294,7 @@ int read_command(void)
 			if (!get_num())
 				return error("Bad location", lineno, -1);
 			loc = num;
-			if (loc >= CMD_SIZE)
+			if (loc >= cmd_size && !grow_text(loc))
 				return error("Location too large", lineno, loc);
 			// SKIP `:' CHARACTER
 			if (!skip_chr(':'))
@@ -296,24 +346,166 @@ int read_command(void)
 				break;
 			}
 			
-			instruction[loc].cop = op;
-			instruction[loc].carg1 = arg1;
-			instruction[loc].carg2 = arg2;
-			instruction[loc].carg3 = arg3;
+			text_code[loc].cop = op;
+			text_code[loc].carg1 = arg1;
+			text_code[loc].carg2 = arg2;
+			text_code[loc].carg3 = arg3;
 		}
 	}
+	instruction = text_code;
+	code_size = cmd_size;
 	return true;
 }
 
+static bool bad_binary(cchar *msg, int loc)
+{
+	printf("Bad binary");
+	if (loc >= 0)
+		printf(" (Instruction %d)", loc);
+	printf("   %s\n", msg);
+	return false;
+}
+
+// A SECTION OF count ITEMS OF size BYTES AT off MUST LIE IN THE FILE
+static bool in_file(uint32_t off, uint32_t count, uint32_t size, size_t fsize)
+{ return off <= fsize && (uint64_t) count * size <= fsize - off && off % 4 == 0; }
+
+// MAP A .tmb AND RUN ITS CODE SECTION IN PLACE -- NOTHING IS PARSED
+// BUT OPERANDS ARE RANGE-CHECKED AS read_command() WOULD
+static bool map_binary(int fd, uint32_t *stk_words)
+{
+	struct stat st;
+	tmb_header hd;
+	const char *map;
+	const tmb_insn *insn;
+	uint32_t i;
+	
+	if (fstat(fd, &st) != 0 || (size_t) st.st_size < offsetof(tmb_header, header_size) + 4)
+		return bad_binary("Truncated header", -1);
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED)
+		return bad_binary("Cannot map file", -1);
+	
+	// FIELDS PAST header_size READ AS 0
+	memset(&hd, 0, sizeof(hd));
+	memcpy(&hd, map, offsetof(tmb_header, header_size) + 4);
+	if (hd.version == 0 || hd.version > TMB_VERSION)
+		return bad_binary("Unsupported version", -1);
+	if (hd.header_size > (size_t) st.st_size)
+		return bad_binary("Truncated header", -1);
+	memcpy(&hd, map, hd.header_size < sizeof(hd) ? hd.header_size : sizeof(hd));
+	
+	if (hd.code_off == 0 || !in_file(hd.code_off, hd.code_count, sizeof(tmb_insn), st.st_size))
+		return bad_binary("Bad code section", -1);
+	if (hd.code_count > MEM_LIM)
+		return bad_binary("Too many instructions", -1);
+	if (hd.str_off != 0 && (!in_file(hd.str_off, hd.str_size, 1, st.st_size) || 
+			(hd.str_size != 0 && map[hd.str_off + hd.str_size - 1] != '\0')))
+		return bad_binary("Bad string table", -1);
+	if (hd.sym_off != 0) {
+		if (hd.str_off == 0 || !in_file(hd.sym_off, hd.sym_count, sizeof(tmb_sym), st.st_size))
+			return bad_binary("Bad symbol section", -1);
+		for (i = 0; i < hd.sym_count; i++)
+			if (((const tmb_sym *) (map + hd.sym_off))[i].name >= hd.str_size)
+				return bad_binary("Bad symbol name", -1);
+	}
+	if (hd.line_off != 0 && !in_file(hd.line_off, hd.code_count, sizeof(uint32_t), st.st_size))
+		return bad_binary("Bad line section", -1);
+	
+	insn = (const tmb_insn *) (map + hd.code_off);
+	for (i = 0; i < hd.code_count; i++) {
+		op_code op = insn[i].op;
+		if (op < OP_HALT || op >= RA_LIM || op == RO_LIM || op == RM_LIM)
+			return bad_binary("Illegal opcode", i);
+		if ((uint32_t) insn[i].a1 >= REG_SIZE || (uint32_t) insn[i].a3 >= REG_SIZE)
+			return bad_binary("Bad register", i);
+		if (get_op_type(op) == T_RO && (uint32_t) insn[i].a2 >= REG_SIZE)
+			return bad_binary("Bad register", i);
+	}
+	
+	*stk_words = hd.stk_size;
+	instruction = (op_cmd *) insn;
+	code_size = hd.code_count;
+	if (hd.sym_off != 0) {
+		symbols = (const tmb_sym *) (map + hd.sym_off);
+		sym_count = hd.sym_count;
+	}
+	if (hd.line_off != 0)
+		lines = (const uint32_t *) (map + hd.line_off);
+	if (hd.str_off != 0)
+		strings = map + hd.str_off;
+	return true;
+}
+
+// LOAD A .tmb (BY ITS MAGIC) OR A TEXT PROGRAM -- THEN PRE-DECODE IT
+bool load_program(FILE *fp)
+{
+	char magic[sizeof(TMB_MAGIC)];
+	uint32_t stk_words = 0;
+	if (fread(magic, 1, sizeof(magic), fp) == sizeof(magic) && 
+		memcmp(magic, TMB_MAGIC, sizeof(magic)) == 0) {
+		if (!map_binary(fileno(fp), &stk_words))
+			return false;
+	} else {
+		rewind(fp);
+		fin = fp;
+		if (!read_command(&stk_words))
+			return false;
+	}
+	if (!alloc_stack(stk_words)) {
+		printf("Out of memory\n");
+		return false;
+	}
+	if (!verify_program())
+		return false;
+	if (decode_program() < 0) {
+		printf("Out of memory\n");
+		return false;
+	}
+	clear_machine();
+	return true;
+}
+
+// READ A VALUE FOR `IN' INTO reg[r]
+op_result input_value(int r)
+{
+	bool is_ok = false;
+	if (batch_flag)
+		return fscanf(in_stream, "%d", &reg[r]) == 1 ? R_OKAY : R_IN_ERR;
+	while (!is_ok) {
+		printf("Enter value for IN instruction: ");
+		fflush(stdin);
+		fflush(stdout);
+		gets(buffer);
+		len = strlen(buffer);
+		col = 0;
+		is_ok = get_num();
+		if (!is_ok)
+			printf("Illegal value\n");
+		else
+			reg[r] = num;
+	}
+	return R_OKAY;
+}
+
+static op_result stk_fault(int pc, int a)
+{
+	fprintf(batch_flag ? stderr : stdout, "PC = %d a = %d\n", pc, a);
+	return R_STK_ERR;
+}
+
+#define STK_CHECK(A)		\
+	if ((A) < 0 || (A) >= stk_size)	\
+		return stk_fault(pc, (A));
+
 op_result step_command(void)
 {
 	op_cmd command;
 	int pc;
-	int r, s, t, a;
-	bool is_ok = false;
+	int r, s, t, a = 0;		// SET BY T_RM AND T_RA -- ALL THAT READ IT
 	
 	pc = reg[PC_REG];
-	if (pc < 0 || pc >= CMD_SIZE)
+	if (pc < 0 || pc >= code_size)
 		return R_CMD_ERR;
 	reg[PC_REG] = pc + 1;	// UPDATE TO NEXT CMD.
 	command = instruction[pc];
@@ -328,17 +520,24 @@ op_result step_command(void)
 			r = command.carg1;
 			s = command.carg3;
 			a = command.carg2 + reg[s];
-			if (a < 0 || a >= STK_SIZE) {
-				printf("PC = %d a = %d\n", pc, a);
-				return R_STK_ERR;
-			}
+			// LD VIA TP POPS -- IT READS ABOVE THE CURRENT TOP
+			if (command.cop == OP_LD && s == TP_REG)
+				a++;
+			STK_CHECK(a);
 		break;
 		
 		case T_RA:
 			r = command.carg1;
 			s = command.carg3;
 			a = command.carg2 + reg[s];
-			// HERE ALSO NEED A ERROR-CHECK
+			// A JUMP TAKEN OUT OF RANGE FAULTS ON THE NEXT FETCH
+			// LS MOVES d WORDS FROM ABOVE TP TO FP ONWARDS
+			if (command.cop == OP_LS && command.carg2 > 0) {
+				STK_CHECK(reg[TP_REG] + 1);
+				STK_CHECK(reg[TP_REG] + command.carg2);
+				STK_CHECK(reg[FP_REG]);
+				STK_CHECK(reg[FP_REG] + command.carg2 - 1);
+			}
 		break;
 	}
 	
@@ -346,33 +545,26 @@ op_result step_command(void)
 	{
 		// RO
 		case OP_HALT:
-			printf("HALT: %1d,%1d,%1d\n", r, s, t);
+			if (!batch_flag)
+				printf("HALT: %1d,%1d,%1d\n", r, s, t);
 			return R_HALT;
 		break;
 		
 		case OP_RET:
+			STK_CHECK(reg[TP_REG] + 1);
+			STK_CHECK(reg[TP_REG] + 2);
 			reg[FP_REG] = stack[++reg[TP_REG]];
 			reg[PC_REG] = stack[++reg[TP_REG]];
 		break;
 		
 		case OP_IN:
-			while (!is_ok) {
-				printf("Enter value for IN instruction: ");
-				fflush(stdin);
-				fflush(stdout);
-				gets(buffer);
-				len = strlen(buffer);
-				col = 0;
-				is_ok = get_num();
-				if (!is_ok)
-					printf("Illegal value\n");
-				else
-					reg[r] = num;
-			}
-		break;
+			return input_value(r);
 		
 		case OP_OUT:
-			printf("OUT instruction prints: %d\n", reg[r]);
+			if (batch_flag)
+				fprintf(out_stream, "%d\n", reg[r]);
+			else
+				printf("OUT instruction prints: %d\n", reg[r]);
 		break;
 		
 		case OP_ADD:  reg[r] = reg[s] + reg[t];  break;
@@ -393,7 +585,7 @@ op_result step_command(void)
 				a = command.carg2 + (--reg[s]);
 		*/
 			if (s == TP_REG)
-				a = command.carg2 + (++reg[s]);
+				reg[s]++;
 			reg[r] = stack[a];
 		break;
 		
@@ -430,12 +622,13 @@ op_result step_command(void)
 	return R_OKAY;
 }
 
+#undef STK_CHECK
+
 int do_command(void)
 {
 	int stepcot = 0, i;
 	int printcot;
 	op_result result;
-	int regno, loc;
 	do {
 		//printf("Enter command: ");
 		printf("(tm) ");
@@ -491,7 +684,7 @@ int do_command(void)
 		break;
 		
 		case '0':
-			for (int i = reg[TP_REG]+1; i < STK_SIZE; i++)
+			for (int i = reg[TP_REG]+1; i < stk_size; i++)
 				printf("%d   ", stack[i]);
 			puts("");
 		break;
@@ -530,7 +723,7 @@ int do_command(void)
 				printf("Instruction locations?\n");
 			else
 			{
-				while (iloc >= 0 && iloc < CMD_SIZE && printcot > 0) {
+				while (iloc >= 0 && iloc < code_size && printcot > 0) {
 					print_command(iloc);
 					iloc++;
 					printcot--;
@@ -548,7 +741,7 @@ int do_command(void)
 				printf("Data locations?\n");
 			else
 			{
-				while (sloc >= 0 && sloc < STK_SIZE && printcot > 0) {
+				while (sloc >= 0 && sloc < stk_size && printcot > 0) {
 					printf("%5d: %5d\n", sloc, stack[sloc]);
 					sloc++;
 					printcot--;
@@ -560,12 +753,7 @@ int do_command(void)
 			iloc = 0;
 			sloc = 0;
 			stepcot = 0;
-			for (regno = 0; regno < REG_SIZE; regno++)
-				reg[regno] = 0;
-			reg[PC_REG] = 1;
-			reg[TP_REG] = STK_SIZE-1;
-			for (loc = 0; loc < STK_SIZE; loc++)
-				stack[loc] = 0;
+			clear_machine();
 		break;
 		
 		case 'q': return false; break;
@@ -577,15 +765,14 @@ int do_command(void)
 	
 	if (stepcot > 0) {
 		if (cmd == 'g') {
-			stepcot = 0;
-			while (result == R_OKAY) {
-				iloc = reg[PC_REG];
-				if (trace_flag) print_command(iloc);
-				result = step_command();
-				stepcot++;
-			}
+			long steps = 0;
+			if (trace_flag)
+				result = run_traced(&steps);
+			else
+				result = run_program(&steps);
+			iloc = reg[PC_REG];
 			if ( icount_flag )
-			printf("Number of instructions executed = %d\n",stepcot);
+			printf("Number of instructions executed = %ld\n", steps);
 		}
 		else {
 			while (stepcot > 0 && result == R_OKAY) {
@@ -601,15 +788,220 @@ int do_command(void)
 	return true;
 }
 
+#define BENCH_SECS 0.5
+
+typedef op_result (*engine_t)(long *);
+
+// THE ORIGINAL ONE-STEP-AT-A-TIME LOOP OF `go'
+static op_result run_stepwise(long *steps)
+{
+	op_result result;
+	do {
+		result = step_command();
+		(*steps)++;
+	} while (result == R_OKAY);
+	return result;
+}
+
+// INSTRUCTIONS PER RUN AS COUNTED BY THE INTERPRETER -- run_jit()
+// DOESN'T COUNT SO ITS BENCH RUNS ARE CREDITED WITH THIS
+static long run_steps = 0;
+
+static op_result run_jit_counted(long *steps)
+{
+	*steps += run_steps;
+	return run_jit(steps);
+}
+
+// RUN engine OVER AND OVER FOR AT LEAST BENCH_SECS OF CPU TIME
+// IN VALUES ARE REPLAYED FROM ibuf -- OUT VALUES ARE DROPPED
+// RETURNS THE INSTRUCTIONS PER RUN
+static long bench_engine(cchar *name, engine_t engine, char *ibuf, size_t ilen)
+{
+	long steps = 0;
+	int runs = 0;
+	fused_steps = 0;
+	double secs;
+	clock_t start = clock();
+	do {
+		clear_machine();
+		in_stream = fmemopen(ibuf, ilen, "r");
+		engine(&steps);
+		fclose(in_stream);
+		runs++;
+		secs = (double) (clock() - start) / CLOCKS_PER_SEC;
+	} while (secs < BENCH_SECS);
+	fprintf(stderr, "%-10s %8d runs %12ld instructions %8.3f s %14.0f instructions/s\n", 
+		name, runs, steps, secs, steps / secs);
+	if (fused_steps != 0)
+		fprintf(stderr, "%-10s %ld dispatches per run for %ld instructions (-%.1f%%)\n", "", 
+			(steps - fused_steps) / runs, steps / runs, 100.0 * fused_steps / steps);
+	return steps / runs;
+}
+
+// ALL OF in_stream -- SO EVERY ENGINE READS WHAT A REAL RUN DOES --
+// malloc()'D, NULL IF IT DOESN'T FIT
+static char *slurp_input(size_t *len)
+{
+	size_t room = LINE_LIM * 16, got;
+	char *buf = malloc(room), *more;
+	*len = 0;
+	while (buf != NULL && (got = fread(buf + *len, 1, room - *len, in_stream)) > 0)
+		if ((*len += got) == room) {
+			if ((more = realloc(buf, room *= 2)) == NULL)
+				free(buf);
+			buf = more;
+		}
+	if (buf != NULL && *len == 0)
+		buf[(*len)++] = ' ';	// fmemopen() REJECTS AN EMPTY BUFFER
+	return buf;
+}
+
+static bool bench(bool jit_flag)
+{
+	size_t ilen;
+	char *ibuf = slurp_input(&ilen);
+	if (ibuf == NULL)
+		return false;
+	out_stream = fopen("/dev/null", "w");
+	bench_engine("stepwise", run_stepwise, ibuf, ilen);
+	fuse_flag = false;
+	decode_program();
+	bench_engine("threaded", run_program, ibuf, ilen);
+	fuse_flag = true;
+	fprintf(stderr, "%d superinstructions\n", decode_program());
+	run_steps = bench_engine("fused", run_program, ibuf, ilen);
+	if (jit_flag) {
+		if (jit_compile())
+			bench_engine("jit", run_jit_counted, ibuf, ilen);
+		else
+			fprintf(stderr, "jit        unavailable\n");
+	}
+	fclose(out_stream);
+	free(ibuf);
+	return true;
+}
+
+#define MEM_USAGE "[--imem <words>] [--dmem <words>]"
+
+// --imem N OR --dmem N AT argv[*i] -- STEPS *i PAST N
+static bool mem_option(int argc, char * argv[], int *i)
+{
+	int *flag;
+	char *end;
+	long words;
+	if (strcmp(argv[*i], "--imem") == 0)
+		flag = &imem_flag;
+	else if (strcmp(argv[*i], "--dmem") == 0)
+		flag = &dmem_flag;
+	else
+		return false;
+	if (*i+1 >= argc)
+		return false;
+	words = strtol(argv[*i+1], &end, 10);
+	if (*end != '\0' || words <= 0 || words > MEM_LIM)
+		return false;
+	*flag = words;
+	*i += 1;
+	return true;
+}
+
+// HEADLESS MODE: tm --run file.tm [--input file] [--bench]
+// RUNS TO HALT WITHOUT THE COMMAND LOOP -- IN VALUES COME FROM
+// file (OR stdin) AND OUT VALUES GO TO stdout ONE PER LINE
+// EXIT STATUS IS THE op_result -- HALT MAPS TO R_OKAY (0)
+// --bench TIMES THE STEPWISE AND THREADED ENGINES INSTEAD -- THE
+// LATTER WITH AND WITHOUT SUPERINSTRUCTIONS
+// --jit RUNS x86-64 CODE TRANSLATED AT LOAD TIME -- WHERE THAT IS
+// UNAVAILABLE THE THREADED ENGINE RUNS AS WITHOUT IT
+int run_batch(int argc, char * argv[])
+{
+	cchar *fname = argv[2];
+	cchar *iname = NULL;
+	bool bench_flag = false;
+	bool jit_flag = false;
+	engine_t engine = run_program;
+	op_result result;
+	long steps = 0;
+	int i;
+	
+	for (i = 3; i < argc; i++) {
+		if (strcmp(argv[i], "--input") == 0 && i+1 < argc)
+			iname = argv[++i];
+		else if (strcmp(argv[i], "--bench") == 0)
+			bench_flag = true;
+		else if (strcmp(argv[i], "--jit") == 0)
+			jit_flag = true;
+		else if (!mem_option(argc, argv, &i)) {
+			fprintf(stderr, "TM Usage: %s --run <filename> [--input <file>] [--bench] [--jit] " MEM_USAGE "\n", argv[0]);
+			return R_LIM;
+		}
+	}
+	
+	fin = fopen(fname, "r");
+	if (fin == NULL) {
+		fprintf(stderr, "file '%s' not found\n", fname);
+		return R_LIM;
+	}
+	if (!load_program(fin))
+		return R_LIM;
+	fclose(fin);
+	
+	in_stream = stdin;
+	if (iname != NULL && strcmp(iname, "-") != 0) {
+		in_stream = fopen(iname, "r");
+		if (in_stream == NULL) {
+			fprintf(stderr, "file '%s' not found\n", iname);
+			return R_LIM;
+		}
+	}
+	
+	batch_flag = true;
+	if (bench_flag) {
+		if (bench(jit_flag))
+			return R_OKAY;
+		fprintf(stderr, "input too big to bench\n");
+		return R_LIM;
+	}
+	if (jit_flag) {
+		if (jit_compile())
+			engine = run_jit;
+		else
+			fprintf(stderr, "JIT unavailable -- interpreting\n");
+	}
+	
+	setvbuf(in_stream, NULL, _IOFBF, BUFSIZ);
+	setvbuf(stdout, NULL, _IOFBF, BUFSIZ);
+	out_stream = stdout;
+	result = engine(&steps);
+	fflush(stdout);
+	
+	if (result == R_HALT)
+		return R_OKAY;
+	fprintf(stderr, "%s (PC = %d)\n", result_map[result], reg[PC_REG]);
+	return result;
+}
+
 int main(int argc, char * argv[])
 {
-	char *fname;
+	char *fname = NULL;
+	
+	if (argc >= 3 && strcmp(argv[1], "--run") == 0)
+		return run_batch(argc, argv);
+	
 	#ifndef DEBUG
-		if (argc != 2) {
-			printf("TM Usage: %s <filename>\n", argv[0]);
+		int i;
+		for (i = 1; i < argc; i++)
+			if (!mem_option(argc, argv, &i)) {
+				if (fname != NULL || argv[i][0] == '-')
+					break;
+				fname = argv[i];
+			}
+		if (i < argc || fname == NULL) {
+			printf("TM Usage: %s " MEM_USAGE " <filename>\n", argv[0]);
+			printf("          %s --run <filename> [--input <file>] [--bench] [--jit] " MEM_USAGE "\n", argv[0]);
 			exit(1);
 		}
-		fname = argv[1];
 	#else
 		int sfd = dup(STDIN_FILENO), sfd2;
 		sfd2 = open("_input.txt", O_RDONLY);
@@ -620,7 +1012,7 @@ int main(int argc, char * argv[])
 		gets(readin);
 		fname = readin;
 		int len = strlen(fname);
-		if (strcmp(&fname[len-3], ".tm") != 0)
+		if (strcmp(&fname[len-3], ".tm") != 0 && (len < 4 || strcmp(&fname[len-4], ".tmb") != 0))
 			strcat(fname, ".tm");
 		// RECOVER REDIRECTED stdin
 		dup2(sfd, STDIN_FILENO);
@@ -634,7 +1026,7 @@ int main(int argc, char * argv[])
 	}
 	printf("Codefile: %s\n", fname);
 	
-	if (!read_command())
+	if (!load_program(fin))
 		exit(3);
 	fclose(fin);
 	
@@ -0,0 +1,150 @@
+#ifndef _TM_H_
+#define _TM_H_
+
+#include <stdio.h>
+#include "tmb.h"
+
+#ifndef bool
+    typedef enum {false, true} bool;
+#endif
+typedef const char cchar;
+
+#define   CMD_SIZE   1024	// DEFAULT INSTRUCTION MEMORY -- GROWS FOR TEXT
+#define   STK_SIZE   1024	// DEFAULT STACK -- SEE --dmem AND tmb_header
+#define   MEM_LIM   (1 << 26)	// LARGEST --imem OR --dmem IN WORDS
+#define   REG_SIZE 		6	// REGISTER
+#define   PC_REG 		2
+#define   BP_REG 		3
+#define   FP_REG 		4
+#define   TP_REG 		5
+
+#define   LINE_LIM    256
+#define   WORD_LIM     32
+
+typedef enum op_type {
+	T_RO, 		// REG OPERANDS r, s, t
+	T_RM, 		// REG r OFF d STK s
+	T_RA		// REG r INT d + s
+} op_type;
+
+typedef enum op_result {
+   R_OKAY, 
+   R_HALT, 
+   R_CMD_ERR, 
+   R_STK_ERR, 
+   R_ZERO_DIV, 
+   R_IN_ERR, 
+   R_LIM		// ALSO EXIT STATUS OF A FAILED LOAD
+} op_result;
+
+typedef struct op_cmd {
+	op_code cop;
+	int carg1;
+	int carg2;
+	int carg3;
+} op_cmd;
+
+// PRE-DECODED OPCODES -- OPERAND KINDS AND BASE REGISTERS ARE
+// RESOLVED AT LOAD TIME SO THE ENGINE NEVER RE-DERIVES THEM
+typedef enum dec_op {
+	D_HALT, D_RET, D_IN, D_OUT, 
+	D_ADD, D_SUB, D_MUL, D_DIV, 
+	D_LD, D_LD_BP, D_LD_FP, D_LD_TP, 	// D_LD_TP POPS
+	D_ST, D_ST_BP, D_ST_FP, D_ST_TP, 	// D_ST_FP AND D_ST_TP PUSH
+	D_LD_BPU, D_ST_BPU, 				// NO RANGE CHECK -- SEE access_proven()
+	D_LS, D_LDA, D_LDC, 
+	D_JMP, 								// LDC PC OR LDA PC VIA PC
+	D_JLT, D_JLE, D_JGT, D_JGE, D_JEQ, D_JNE, 
+	D_SLOW, 		// READS OR WRITES PC OTHERWISE -- LEFT TO step_command()
+	D_END, 			// SENTINEL PAST THE LAST LOCATION
+	
+	// SUPERINSTRUCTIONS -- SET ON THE FIRST SLOT OF A SEQUENCE CGEN
+	// KEEPS EMITTING -- THEIR OPERANDS ARE READ FROM THE SLOTS THAT
+	// FOLLOW -- WHICH KEEP THEIR OWN DECODING FOR JUMPS INTO THEM
+	F_POP_ADD, F_POP_SUB, F_POP_MUL, F_POP_DIV, 	// LD_TP  ARITH
+	F_POP_SLT, F_POP_SLE, F_POP_SGT, 				// LD_TP  SUB Jxx LDC JMP LDC
+	F_POP_SGE, F_POP_SEQ, F_POP_SNE, 
+	F_POP_BLT, F_POP_BLE, F_POP_BGT, 				// F_POP_Sxx  JEQ
+	F_POP_BGE, F_POP_BEQ, F_POP_BNE, 
+	F_POP_ST, 		// LD_TP  ST
+	F_LD_PUSH, 		// LD_FP  ST_TP
+	F_PUSH_LD, 		// ST_TP  LD_FP
+	F_PUSH_LDC, 	// ST_TP  LDC
+	F_CALL, 		// LDC  ST_TP  ST_TP  -- RETURN ADDRESS AND FP
+	F_LS_JMP, 		// LS  JMP
+	F_LS_ENTER, 	// LS  LDA  JMP
+	D_LIM
+} dec_op;
+
+// 8 BYTES INSTEAD OF THE 16 OF op_cmd
+//  r s t	REGISTERS -- ONLY THOSE THE OPCODE USES ARE SET
+//  d		DISPLACEMENT, CONSTANT OR ABSOLUTE JUMP TARGET
+typedef struct dec_cmd {
+	unsigned char dop;
+	unsigned char r;
+	unsigned char s;
+	unsigned char t;
+	int d;
+} dec_cmd;
+
+extern int trace_flag;
+extern int batch_flag;
+
+extern op_cmd *instruction;		// TEXT CODE OR A MAPPED .tmb
+extern int code_size;				// LOCATIONS IN instruction[]
+extern int *stack;
+extern int stk_size;				// WORDS IN stack[]
+extern int reg[REG_SIZE];
+
+extern dec_cmd *code;				// code_size + 1 SLOTS
+
+extern int fuse_flag;
+extern long fused_steps;		// INSTRUCTIONS RETIRED INSIDE SUPERINSTRUCTIONS
+
+extern FILE *in_stream;
+extern FILE *out_stream;
+
+// FROM tm.c
+bool load_program(FILE *);
+
+// ANONYMOUS PAGES -- ZERO UNTIL WRITTEN AND ONLY BACKED ONCE TOUCHED
+// mem_zero() DISCARDS THE PAGES OF A WHOLE mem_map() BLOCK
+void *mem_map(size_t bytes);
+void mem_unmap(void *, size_t bytes);
+void mem_zero(void *, size_t bytes);
+
+op_type get_op_type(op_code);
+
+void print_command(int);
+
+op_result step_command(void);
+
+op_result input_value(int);
+
+// FROM tmverify.c -- STATIC CHECKS RUN ONCE AFTER LOADING
+// false IF THE PROGRAM IS MALFORMED -- AFTER IT RETURNS true
+// access_proven(loc) TELLS IF THE LD OR ST AT loc CAN NEVER FAULT
+bool verify_program(void);
+
+bool access_proven(int loc);
+
+// FROM tmdec.c -- FILLS code[] FROM instruction[] AND FUSES
+// SUPERINSTRUCTIONS IF fuse_flag IS SET -- RETURNS HOW MANY
+// OR -1 IF code[] CANNOT BE ALLOCATED
+int decode_program(void);
+
+// FROM tmexec.c -- THREADED EXECUTION ENGINE
+// BOTH RUN FROM reg[PC_REG] UNTIL A RESULT OTHER THAN R_OKAY
+// AND ADD THE NUMBER OF INSTRUCTIONS EXECUTED TO *steps
+op_result run_program(long *steps);
+
+op_result run_traced(long *steps);
+
+// FROM tmjit.c -- x86-64 TRANSLATION FOR BATCH RUNS
+// jit_compile() IS false WHERE IT IS UNAVAILABLE -- THEN KEEP USING
+// run_program() -- run_jit() DOES NOT COUNT INSTRUCTIONS
+bool jit_compile(void);
+
+op_result run_jit(long *steps);
+
+#endif
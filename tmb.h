@@ -0,0 +1,92 @@
+#ifndef _TMB_H_
+#define _TMB_H_
+
+// TM OPCODES AND THE BINARY OBJECT FORMAT (.tmb)
+// SHARED BY cm WHICH WRITES IT AND tm WHICH MAPS IT
+
+#include <stdint.h>
+
+typedef enum op_code {
+	
+	// REGISTER-ONLY INSTRUCTION
+	OP_HALT, 	// HALT -- OPERANDS ARE IGNORED
+	OP_RET, 	// RESTORE FP AND PC -- OPERANDS INGORED
+	OP_IN, 		// READ INT INTO reg[r] -- s, t IGNORED
+	OP_OUT, 	// WRITE FROM reg[r] -- s, t IGNORED
+	OP_ADD, 	// reg[r] = reg[s] + reg[t]
+	OP_SUB, 	// reg[r] = reg[s] - reg[t]
+	OP_MUL, 	// reg[r] = reg[s] * reg[t]
+	OP_DIV, 	// reg[r] = reg[s] / reg[t]
+	RO_LIM, 
+
+	// REGISTER-TO-MEMORY
+	OP_LD, 		// reg[r] = stk[d + reg[s]]
+	OP_ST, 		// stk[d + reg[s]] = reg[r]
+	RM_LIM, 
+	
+	// REGISTER-TO-ADDRESS
+	OP_LS, 		// LD AND ST FOR d TIMES -- r, s INGORED
+	OP_LDA, 	// reg[r] = d + reg[s]
+	OP_LDC, 	// reg[r] = d -- s IGNORED
+	OP_JLT,     // reg[PC_REG] = d + reg[s] IF reg[r] <  0
+	OP_JLE,     // reg[PC_REG] = d + reg[s] IF reg[r] <= 0
+	OP_JGT,     // reg[PC_REG] = d + reg[s] IF reg[r] >  0
+	OP_JGE,     // reg[PC_REG] = d + reg[s] IF reg[r] >= 0
+	OP_JEQ,     // reg[PC_REG] = d + reg[s] IF reg[r] == 0
+	OP_JNE,     // reg[PC_REG] = d + reg[s] IF reg[r] != 0
+	RA_LIM
+} op_code;
+
+// NAMES IN op_code ORDER -- "???" FOR THE *_LIM SEPARATORS
+#define OPCODE_NAMES 											\
+	"HALT", "RET", "IN", "OUT", "ADD", "SUB", "MUL", "DIV", "???", 	\
+	"LD", "ST", "???", 											\
+	"LS", "LDA", "LDC", "JLT", "JLE", "JGT", "JGE", "JEQ", "JNE", "???"
+
+// FILE LAYOUT -- ALL FIELDS IN HOST BYTE ORDER
+//   tmb_header
+//   CODE    code_count tmb_insn         -- ONE PER LOCATION FROM 0
+//   SYMBOLS sym_count tmb_sym           -- OPTIONAL
+//   LINES   code_count uint32_t         -- OPTIONAL SOURCE LINE PER LOCATION
+//   STRINGS str_size BYTES OF NUL-TERMINATED NAMES
+// AN OFFSET OF 0 MARKS AN ABSENT SECTION -- NEW HEADER FIELDS
+// ARE APPENDED AND READERS TREAT FIELDS PAST header_size AS 0
+
+#define TMB_MAGIC		"TMB"		// 4 BYTES WITH THE NUL
+#define TMB_VERSION		1
+
+// STACK ROOM cm ASKS FOR BEYOND THE GLOBALS
+#define TMB_STK_SLACK	1024
+
+// A TEXT PROGRAM ASKS FOR ITS stk_size IN A COMMENT LINE OF THIS FORM
+#define TM_STK_COMMENT	"* STACK "
+
+typedef struct tmb_header {
+	char	 magic[4];
+	uint32_t version;
+	uint32_t header_size;
+	uint32_t code_off;
+	uint32_t code_count;
+	uint32_t sym_off;
+	uint32_t sym_count;
+	uint32_t line_off;
+	uint32_t str_off;
+	uint32_t str_size;
+	uint32_t stk_size;	// WORDS OF DATA MEMORY WANTED -- 0 FOR THE VM DEFAULT
+} tmb_header;
+
+// SAME LAYOUT AS tm's op_cmd SO THE CODE SECTION RUNS IN PLACE
+// a1 a2 a3 ARE THE OPERANDS IN TEXT ORDER -- r,s,t OR r,d(s)
+typedef struct tmb_insn {
+	int32_t op;
+	int32_t a1;
+	int32_t a2;
+	int32_t a3;
+} tmb_insn;
+
+typedef struct tmb_sym {
+	uint32_t loc;		// FIRST LOCATION OF A FUNCTION
+	uint32_t name;		// OFFSET INTO THE STRING TABLE
+} tmb_sym;
+
+#endif
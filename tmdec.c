@@ -0,0 +1,221 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "tm.h"
+
+// dec_cmd MUST STAY 8 BYTES -- FAILS TO COMPILE OTHERWISE
+typedef char dec_cmd_size_check[sizeof(dec_cmd) == 8 ? 1 : -1];
+
+dec_cmd *code = NULL;
+static int code_cap = 0;
+
+int fuse_flag = true;
+
+static const dec_op ld_map[REG_SIZE] = {
+	D_LD, D_LD, D_SLOW, D_LD_BP, D_LD_FP, D_LD_TP
+};
+
+static const dec_op st_map[REG_SIZE] = {
+	D_ST, D_ST, D_SLOW, D_ST_BP, D_ST_FP, D_ST_TP
+};
+
+static inline bool in_range(int target)
+{ return target >= 0 && target < code_size; }
+
+// DECODE ONE INSTRUCTION AT loc
+// PC-RELATIVE OPERANDS ARE FOLDED INTO CONSTANTS -- reg[PC_REG]
+// IS loc+1 WHENEVER AN INSTRUCTION AT loc READS IT
+static dec_cmd decode(int loc)
+{
+	const op_cmd *cmd = &instruction[loc];
+	int r = cmd->carg1;
+	dec_cmd dc = { D_SLOW, 0, 0, 0, 0 };
+
+	switch (get_op_type(cmd->cop)) {
+		case T_RO:
+			if (r == PC_REG || cmd->carg2 == PC_REG || cmd->carg3 == PC_REG)
+				if (cmd->cop != OP_HALT && cmd->cop != OP_RET)
+					return dc;
+			dc.r = r;
+			dc.s = cmd->carg2;
+			dc.t = cmd->carg3;
+		break;
+
+		case T_RM:
+		case T_RA:
+			dc.r = r;
+			dc.s = cmd->carg3;
+			dc.d = cmd->carg2;
+		break;
+	}
+
+	switch (cmd->cop) {
+		case OP_HALT:	dc.dop = D_HALT;	break;
+		case OP_RET:	dc.dop = D_RET;		break;
+		case OP_IN:		dc.dop = D_IN;		break;
+		case OP_OUT:	dc.dop = D_OUT;		break;
+		case OP_ADD:	dc.dop = D_ADD;		break;
+		case OP_SUB:	dc.dop = D_SUB;		break;
+		case OP_MUL:	dc.dop = D_MUL;		break;
+		case OP_DIV:	dc.dop = D_DIV;		break;
+
+		case OP_LD:
+			if (r != PC_REG)
+				dc.dop = access_proven(loc) ? D_LD_BPU : ld_map[dc.s];
+		break;
+
+		case OP_ST:
+			if (r != PC_REG)
+				dc.dop = access_proven(loc) ? D_ST_BPU : st_map[dc.s];
+		break;
+
+		case OP_LS:		dc.dop = D_LS;		break;
+
+		case OP_LDA:
+			if (dc.s != PC_REG)
+				dc.dop = (r == PC_REG) ? D_SLOW : D_LDA;
+			else {
+				dc.d += loc + 1;
+				dc.dop = (r == PC_REG) ? D_JMP : D_LDC;
+			}
+		break;
+
+		case OP_LDC:
+			dc.dop = (r == PC_REG) ? D_JMP : D_LDC;
+		break;
+
+		case OP_JLT:
+		case OP_JLE:
+		case OP_JGT:
+		case OP_JGE:
+		case OP_JEQ:
+		case OP_JNE:
+			if (r != PC_REG && dc.s == PC_REG) {
+				dc.d += loc + 1;
+				dc.dop = D_JLT + (cmd->cop - OP_JLT);
+			}
+		break;
+
+		default: break;
+	}
+
+	// verify_program() TURNED AWAY EVERY STATIC TARGET OUTSIDE
+	// INSTRUCTION MEMORY BEFORE ANYTHING WAS DECODED
+	assert(!(dc.dop >= D_JMP && dc.dop <= D_JNE) || in_range(dc.d));
+	return dc;
+}
+
+// MATCH A SUPERINSTRUCTION STARTING AT loc
+// RETURNS ITS LENGTH IN SLOTS OR 0 -- *dop RECEIVES THE FUSED OPCODE
+static int match_fused(int loc, dec_op *dop)
+{
+	const dec_cmd *c = &code[loc];
+	int left = code_size - loc;
+
+	switch (c[0].dop) {
+		case D_LD_TP:
+			if (left < 2) break;
+			if (c[1].dop >= D_ADD && c[1].dop <= D_DIV) {
+				*dop = F_POP_ADD + (c[1].dop - D_ADD);
+				return 2;
+			}
+			if (c[1].dop == D_ST) {
+				*dop = F_POP_ST;
+				return 2;
+			}
+			// LD BX,0(TP)  SUB AX,BX,AX  Jxx AX,2(PC)
+			// LDC AX,0  LDA PC,1(PC)  LDC AX,1
+			if (left >= 6 && c[1].dop == D_SUB && 
+				c[2].dop >= D_JLT && c[2].dop <= D_JNE && 
+				c[2].r == c[1].r && c[2].d == loc + 5 && 
+				c[3].dop == D_LDC && c[3].r == c[1].r && c[3].d == 0 && 
+				c[4].dop == D_JMP && c[4].d == loc + 6 && 
+				c[5].dop == D_LDC && c[5].r == c[1].r && c[5].d == 1) {
+				// FOLLOWED BY THE JEQ OF AN if OR while
+				if (left >= 7 && c[6].dop == D_JEQ && c[6].r == c[1].r) {
+					*dop = F_POP_BLT + (c[2].dop - D_JLT);
+					return 7;
+				}
+				*dop = F_POP_SLT + (c[2].dop - D_JLT);
+				return 6;
+			}
+		break;
+
+		case D_LD_FP:
+			if (left >= 2 && c[1].dop == D_ST_TP) {
+				*dop = F_LD_PUSH;
+				return 2;
+			}
+		break;
+
+		case D_ST_TP:
+			if (left < 2) break;
+			if (c[1].dop == D_LD_FP) {
+				*dop = F_PUSH_LD;
+				return 2;
+			}
+			if (c[1].dop == D_LDC) {
+				*dop = F_PUSH_LDC;
+				return 2;
+			}
+		break;
+
+		case D_LDC:
+			if (left >= 3 && c[1].dop == D_ST_TP && c[2].dop == D_ST_TP) {
+				*dop = F_CALL;
+				return 3;
+			}
+		break;
+
+		case D_LS:
+			if (left >= 2 && c[1].dop == D_JMP) {
+				*dop = F_LS_JMP;
+				return 2;
+			}
+			if (left >= 3 && c[1].dop == D_LDA && c[2].dop == D_JMP) {
+				*dop = F_LS_ENTER;
+				return 3;
+			}
+		break;
+
+		default: break;
+	}
+	return 0;
+}
+
+// THE FUSED HEAD REPLACES ONLY code[loc].dop -- SO A JUMP INTO THE
+// MIDDLE OF A SEQUENCE STILL RUNS THE ORIGINAL INSTRUCTIONS AND NO
+// JUMP-TARGET ANALYSIS IS NEEDED
+static int fuse_program(void)
+{
+	int loc = 0, len, fused = 0;
+	dec_op dop;
+	while (loc < code_size) {
+		len = match_fused(loc, &dop);
+		if (len == 0) {
+			loc++;
+			continue;
+		}
+		code[loc].dop = dop;
+		loc += len;
+		fused++;
+	}
+	return fused;
+}
+
+int decode_program(void)
+{
+	int loc;
+	if (code_cap < code_size + 1) {
+		dec_cmd *temp = mem_map((code_size + 1) * sizeof(dec_cmd));
+		if (temp == NULL)
+			return -1;
+		mem_unmap(code, code_cap * sizeof(dec_cmd));
+		code = temp;
+		code_cap = code_size + 1;
+	}
+	for (loc = 0; loc < code_size; loc++)
+		code[loc] = decode(loc);
+	code[code_size].dop = D_END;
+	return fuse_flag ? fuse_program() : 0;
+}
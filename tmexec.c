@@ -0,0 +1,352 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "tm.h"
+
+// DIRECT-THREADED DISPATCH NEEDS GCC'S LABELS AS VALUES
+// OTHER COMPILERS FALL BACK TO A SINGLE switch PER STEP
+#if defined(__GNUC__) && !defined(NO_THREADED)
+	#define THREADED
+#endif
+
+#ifdef THREADED
+	#define CASE(OP)	L_##OP
+	#define DISPATCH()	goto *dispatch[ip->dop]
+#else
+	#define CASE(OP)	case OP
+	#define DISPATCH()	goto dispatch_switch
+#endif
+
+// FETCH THE NEXT PRE-DECODED INSTRUCTION AND JUMP STRAIGHT TO ITS
+// HANDLER -- pc LIVES IN A LOCAL SINCE NO FAST HANDLER TOUCHES
+// reg[PC_REG] -- STATIC TARGETS ARE CHECKED BY decode_program()
+// AND FALLING OFF THE END HITS THE D_END SENTINEL
+#define NEXT()								\
+	do {									\
+		ip = &code[pc++];					\
+		n++;								\
+		DISPATCH();							\
+	} while (0)
+
+// ONLY PCS COMING FROM MEMORY OR step_command() NEED A CHECK
+#define CHECKED_NEXT()						\
+	do {									\
+		if ((unsigned) pc >= (unsigned) code_size)	\
+			goto cmd_fault;					\
+		NEXT();								\
+	} while (0)
+
+#define STK_CHECK(A)						\
+	if ((unsigned) (A) >= (unsigned) stk_size) {	\
+		a = (A);							\
+		goto stk_fault;						\
+	}
+
+// MOVE ON TO THE NEXT SLOT INSIDE A SUPERINSTRUCTION -- pc AND THE
+// STEP COUNT STAY EXACT SHOULD THAT SLOT FAULT
+#define STEP()		(pc++, f++)
+
+long fused_steps = 0;
+
+op_result run_program(long *steps)
+{
+#ifdef THREADED
+	static void *dispatch[D_LIM] = {
+		[D_HALT] = &&L_D_HALT, [D_RET] = &&L_D_RET,
+		[D_IN] = &&L_D_IN, [D_OUT] = &&L_D_OUT,
+		[D_ADD] = &&L_D_ADD, [D_SUB] = &&L_D_SUB,
+		[D_MUL] = &&L_D_MUL, [D_DIV] = &&L_D_DIV,
+		[D_LD] = &&L_D_LD, [D_LD_BP] = &&L_D_LD_BP,
+		[D_LD_FP] = &&L_D_LD_FP, [D_LD_TP] = &&L_D_LD_TP,
+		[D_ST] = &&L_D_ST, [D_ST_BP] = &&L_D_ST_BP,
+		[D_ST_FP] = &&L_D_ST_FP, [D_ST_TP] = &&L_D_ST_TP,
+		[D_LD_BPU] = &&L_D_LD_BPU, [D_ST_BPU] = &&L_D_ST_BPU,
+		[D_LS] = &&L_D_LS, [D_LDA] = &&L_D_LDA, [D_LDC] = &&L_D_LDC,
+		[D_JMP] = &&L_D_JMP,
+		[D_JLT] = &&L_D_JLT, [D_JLE] = &&L_D_JLE,
+		[D_JGT] = &&L_D_JGT, [D_JGE] = &&L_D_JGE,
+		[D_JEQ] = &&L_D_JEQ, [D_JNE] = &&L_D_JNE,
+		[D_SLOW] = &&L_D_SLOW, [D_END] = &&L_D_END,
+		[F_POP_ADD] = &&L_F_POP_ADD, [F_POP_SUB] = &&L_F_POP_SUB,
+		[F_POP_MUL] = &&L_F_POP_MUL, [F_POP_DIV] = &&L_F_POP_DIV,
+		[F_POP_SLT] = &&L_F_POP_SLT, [F_POP_SLE] = &&L_F_POP_SLE,
+		[F_POP_SGT] = &&L_F_POP_SGT, [F_POP_SGE] = &&L_F_POP_SGE,
+		[F_POP_SEQ] = &&L_F_POP_SEQ, [F_POP_SNE] = &&L_F_POP_SNE,
+		[F_POP_BLT] = &&L_F_POP_BLT, [F_POP_BLE] = &&L_F_POP_BLE,
+		[F_POP_BGT] = &&L_F_POP_BGT, [F_POP_BGE] = &&L_F_POP_BGE,
+		[F_POP_BEQ] = &&L_F_POP_BEQ, [F_POP_BNE] = &&L_F_POP_BNE,
+		[F_POP_ST] = &&L_F_POP_ST, [F_LD_PUSH] = &&L_F_LD_PUSH,
+		[F_PUSH_LD] = &&L_F_PUSH_LD, [F_PUSH_LDC] = &&L_F_PUSH_LDC,
+		[F_CALL] = &&L_F_CALL, [F_LS_JMP] = &&L_F_LS_JMP,
+		[F_LS_ENTER] = &&L_F_LS_ENTER
+	};
+#endif
+	const dec_cmd *ip;
+	op_result result;
+	long n = 0, f = 0;		// DISPATCHES AND FUSED-AWAY STEPS
+	int pc = reg[PC_REG];
+	int a, d;
+
+	CHECKED_NEXT();
+
+#ifndef THREADED
+dispatch_switch:
+	switch (ip->dop) {
+#endif
+
+	// RO
+	CASE(D_HALT):
+		if (!batch_flag)
+			printf("HALT: %1d,%1d,%1d\n", ip->r, ip->s, ip->t);
+		result = R_HALT;
+		goto done;
+
+	CASE(D_RET):
+		STK_CHECK(reg[TP_REG] + 1);
+		STK_CHECK(reg[TP_REG] + 2);
+		reg[FP_REG] = stack[++reg[TP_REG]];
+		pc = stack[++reg[TP_REG]];
+		CHECKED_NEXT();
+
+	CASE(D_IN):
+		if ((result = input_value(ip->r)) != R_OKAY)
+			goto done;
+		NEXT();
+
+	CASE(D_OUT):
+		if (batch_flag)
+			fprintf(out_stream, "%d\n", reg[ip->r]);
+		else
+			printf("OUT instruction prints: %d\n", reg[ip->r]);
+		NEXT();
+
+	CASE(D_ADD):  reg[ip->r] = reg[ip->s] + reg[ip->t];  NEXT();
+	CASE(D_SUB):  reg[ip->r] = reg[ip->s] - reg[ip->t];  NEXT();
+	CASE(D_MUL):  reg[ip->r] = reg[ip->s] * reg[ip->t];  NEXT();
+
+	CASE(D_DIV):
+		if (reg[ip->t] == 0) {
+			result = R_ZERO_DIV;
+			goto done;
+		}
+		reg[ip->r] = reg[ip->s] / reg[ip->t];
+		NEXT();
+
+	// RM   USING r, d(s)   a = d + reg[s]
+	// C IS THE SLOT -- ip[0] UNLESS INSIDE A SUPERINSTRUCTION
+#define LOAD(C, A)				\
+		a = (A);				\
+		STK_CHECK(a);			\
+		reg[(C).r] = stack[a];
+
+#define STORE(C, A)				\
+		a = (A);				\
+		STK_CHECK(a);			\
+		stack[a] = reg[(C).r];
+
+// CHECKED BEFORE TP MOVES -- AS step_command() DOES -- SO A FAULT LEAVES
+// TP WHERE THE OTHER ENGINE LEAVES IT
+#define POP(C)					\
+		a = (C).d + reg[TP_REG] + 1;	\
+		STK_CHECK(a);			\
+		reg[TP_REG]++;			\
+		reg[(C).r] = stack[a];
+#define PUSH(C)		STORE(C, (C).d + reg[TP_REG]);	reg[TP_REG]--;
+
+#define LOAD_ARGS(C)									\
+		d = (C).d;										\
+		if (d > 0) {									\
+			STK_CHECK(reg[TP_REG] + 1);					\
+			STK_CHECK(reg[TP_REG] + d);					\
+			STK_CHECK(reg[FP_REG]);						\
+			STK_CHECK(reg[FP_REG] + d - 1);				\
+		}												\
+		while (d-- > 0)									\
+			stack[reg[FP_REG]++] = stack[++reg[TP_REG]];
+
+	CASE(D_LD):		LOAD(ip[0], ip->d + reg[ip->s]);		NEXT();
+	CASE(D_LD_BP):	LOAD(ip[0], ip->d + reg[BP_REG]);		NEXT();
+	CASE(D_LD_FP):	LOAD(ip[0], ip->d + reg[FP_REG]);		NEXT();
+	CASE(D_LD_TP):	POP(ip[0]);								NEXT();
+
+	CASE(D_ST):		STORE(ip[0], ip->d + reg[ip->s]);		NEXT();
+	CASE(D_ST_BP):	STORE(ip[0], ip->d + reg[BP_REG]);		NEXT();
+	CASE(D_ST_FP):	STORE(ip[0], ip->d + reg[FP_REG]);	reg[FP_REG]++;	NEXT();
+	CASE(D_ST_TP):	PUSH(ip[0]);							NEXT();
+
+	CASE(D_LD_BPU):	reg[ip->r] = stack[ip->d + reg[BP_REG]];	NEXT();
+	CASE(D_ST_BPU):	stack[ip->d + reg[BP_REG]] = reg[ip->r];	NEXT();
+
+	// RA   USING r, d(s)   a = d + reg[s]
+	CASE(D_LS):		LOAD_ARGS(ip[0]);						NEXT();
+
+	CASE(D_LDA):	reg[ip->r] = ip->d + reg[ip->s];	NEXT();
+	CASE(D_LDC):	reg[ip->r] = ip->d;					NEXT();
+	CASE(D_JMP):	pc = ip->d;							NEXT();
+
+#define JUMP_IF(COND)						\
+		if (reg[ip->r] COND 0)				\
+			pc = ip->d;						\
+		NEXT();
+
+	CASE(D_JLT):	JUMP_IF(<);
+	CASE(D_JLE):	JUMP_IF(<=);
+	CASE(D_JGT):	JUMP_IF(>);
+	CASE(D_JGE):	JUMP_IF(>=);
+	CASE(D_JEQ):	JUMP_IF(==);
+	CASE(D_JNE):	JUMP_IF(!=);
+
+#undef JUMP_IF
+
+	CASE(D_SLOW):
+		reg[PC_REG] = pc - 1;
+		if ((result = step_command()) != R_OKAY)
+			goto out;
+		pc = reg[PC_REG];
+		CHECKED_NEXT();
+
+	// SUPERINSTRUCTIONS -- ip[k] IS THE k-TH SLOT OF THE SEQUENCE
+#define POP_ARITH(OP)									\
+		POP(ip[0]);										\
+		STEP();											\
+		reg[ip[1].r] = reg[ip[1].s] OP reg[ip[1].t];	\
+		NEXT();
+
+	CASE(F_POP_ADD):	POP_ARITH(+);
+	CASE(F_POP_SUB):	POP_ARITH(-);
+	CASE(F_POP_MUL):	POP_ARITH(*);
+
+	CASE(F_POP_DIV):
+		POP(ip[0]);
+		STEP();
+		if (reg[ip[1].t] == 0) {
+			result = R_ZERO_DIV;
+			goto done;
+		}
+		reg[ip[1].r] = reg[ip[1].s] / reg[ip[1].t];
+		NEXT();
+
+	// SUB Jxx THEN EITHER  LDC 1  OR  LDC 0 JMP
+#define POP_SET(COND)									\
+		POP(ip[0]);										\
+		STEP();											\
+		d = (reg[ip[1].s] - reg[ip[1].t]) COND 0;		\
+		reg[ip[1].r] = d;								\
+		f += d ? 2 : 3;									\
+		pc += 4;
+
+	CASE(F_POP_SLT):	POP_SET(<);		NEXT();
+	CASE(F_POP_SLE):	POP_SET(<=);	NEXT();
+	CASE(F_POP_SGT):	POP_SET(>);		NEXT();
+	CASE(F_POP_SGE):	POP_SET(>=);	NEXT();
+	CASE(F_POP_SEQ):	POP_SET(==);	NEXT();
+	CASE(F_POP_SNE):	POP_SET(!=);	NEXT();
+
+#define POP_BRANCH(COND)				\
+		POP_SET(COND);					\
+		STEP();							\
+		if (d == 0)						\
+			pc = ip[6].d;				\
+		NEXT();
+
+	CASE(F_POP_BLT):	POP_BRANCH(<);
+	CASE(F_POP_BLE):	POP_BRANCH(<=);
+	CASE(F_POP_BGT):	POP_BRANCH(>);
+	CASE(F_POP_BGE):	POP_BRANCH(>=);
+	CASE(F_POP_BEQ):	POP_BRANCH(==);
+	CASE(F_POP_BNE):	POP_BRANCH(!=);
+
+	CASE(F_POP_ST):
+		POP(ip[0]);
+		STEP();
+		STORE(ip[1], ip[1].d + reg[ip[1].s]);
+		NEXT();
+
+	CASE(F_LD_PUSH):
+		LOAD(ip[0], ip[0].d + reg[FP_REG]);
+		STEP();
+		PUSH(ip[1]);
+		NEXT();
+
+	CASE(F_PUSH_LD):
+		PUSH(ip[0]);
+		STEP();
+		LOAD(ip[1], ip[1].d + reg[FP_REG]);
+		NEXT();
+
+	CASE(F_PUSH_LDC):
+		PUSH(ip[0]);
+		STEP();
+		reg[ip[1].r] = ip[1].d;
+		NEXT();
+
+	CASE(F_CALL):
+		reg[ip[0].r] = ip[0].d;
+		STEP();
+		PUSH(ip[1]);
+		STEP();
+		PUSH(ip[2]);
+		NEXT();
+
+	CASE(F_LS_JMP):
+		LOAD_ARGS(ip[0]);
+		STEP();
+		pc = ip[1].d;
+		NEXT();
+
+	CASE(F_LS_ENTER):
+		LOAD_ARGS(ip[0]);
+		STEP();
+		reg[ip[1].r] = ip[1].d + reg[ip[1].s];
+		STEP();
+		pc = ip[2].d;
+		NEXT();
+
+#undef POP_ARITH
+#undef POP_SET
+#undef POP_BRANCH
+#undef LOAD
+#undef STORE
+#undef POP
+#undef PUSH
+#undef LOAD_ARGS
+
+	CASE(D_END):
+		n--;		// cmd_fault COUNTS THIS FETCH
+		pc = code_size;
+		goto cmd_fault;
+
+#ifndef THREADED
+	default:
+		goto cmd_fault;
+	}
+#endif
+
+cmd_fault:
+	n++;		// THE FAULTING FETCH COUNTS AS A STEP -- AS IN step_command()
+	result = R_CMD_ERR;
+	goto done;
+
+stk_fault:
+	fprintf(batch_flag ? stderr : stdout, "PC = %d a = %d\n", pc - 1, a);
+	result = R_STK_ERR;
+
+done:
+	reg[PC_REG] = pc;
+out:
+	*steps += n + f;
+	fused_steps += f;
+	return result;
+}
+
+// TRACED RUNS PRINT EVERY INSTRUCTION -- SPEED DOESN'T MATTER
+// SO THEY SIMPLY GO THROUGH step_command()
+op_result run_traced(long *steps)
+{
+	op_result result;
+	do {
+		print_command(reg[PC_REG]);
+		result = step_command();
+		(*steps)++;
+	} while (result == R_OKAY);
+	return result;
+}
@@ -0,0 +1,587 @@
+#define _DEFAULT_SOURCE		// MAP_ANONYMOUS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include "tm.h"
+
+// LOAD-TIME x86-64 TRANSLATION OF instruction[]
+//
+// TM REGISTERS LIVE IN CALLEE-SAVED HOST REGISTERS SO HELPER CALLS
+// KEEP THEM -- rbx HOLDS &stack[0] -- PC ONLY EXISTS AS ecx WHEN
+// CONTROL GOES THROUGH THE DISPATCH TABLE (RET, COMPUTED JUMPS)
+//   AX r12d   BX r13d   BP r14d   FP r15d   TP ebp
+// EVERY OTHER TRANSFER IS A DIRECT JUMP -- verify_program() HAS
+// ALREADY PROVEN STATIC TARGETS IN RANGE
+//
+// CHECKS BRANCH TO COLD STUBS EMITTED AFTER ALL INSTRUCTIONS --
+// THE STUBS AND IN/OUT/HALT LEAVE THROUGH ONE EXIT THAT WRITES THE
+// HOST REGISTERS BACK TO reg[] AND RETURNS THE op_result
+
+#if defined(__x86_64__) && !defined(NO_JIT)
+
+enum { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+	R8, R9, R10, R11, R12, R13, R14, R15 };
+
+static const int host_map[REG_SIZE] = { R12, R13, -1, R14, R15, RBP };
+
+// x86 CONDITION CODES FOR Jcc
+enum { CC_AE = 0x3, CC_E = 0x4, CC_NE = 0x5,
+	CC_L = 0xC, CC_GE = 0xD, CC_LE = 0xE, CC_G = 0xF };
+
+// JUMP FIXUPS -- PATCHED ONCE ALL OFFSETS ARE KNOWN
+typedef enum { FX_LOC, FX_STK, FX_DIV } fix_k;
+
+typedef struct fixup {
+	int pos;		// OFFSET OF THE rel32
+	int loc;		// TM LOCATION -- OF THE TARGET FOR FX_LOC
+	fix_k kind;
+} fixup;
+
+static unsigned char *buf = NULL;
+static size_t buf_cap = 0, pos = 0;
+static bool overflow = false;
+
+static int *native = NULL;			// OFFSET OF EACH LOCATION
+static void **table = NULL;			// ITS ADDRESS -- FOR DISPATCH
+static fixup *fixes = NULL;
+static int fix_count = 0, fix_cap = 0;
+
+static int exit_off, dispatch_off, cmd_fault_off, entry_off;
+static int fault_a;					// ADDRESS OF THE LAST DATA FAULT
+
+static op_result (*jit_entry)(void) = NULL;
+
+static void byte(int b)
+{
+	if (pos < buf_cap)
+		buf[pos++] = b;
+	else
+		overflow = true;
+}
+
+static void dword(int32_t v)
+{
+	int i;
+	for (i = 0; i < 4; i++)
+		byte((uint32_t) v >> (8 * i) & 0xFF);
+}
+
+static void qword(uint64_t v)
+{
+	dword((int32_t) v);
+	dword((int32_t) (v >> 32));
+}
+
+// REX PREFIX WHEN NEEDED -- r IN modrm.reg, x IN sib.index, b IN modrm.rm
+static void rex(int w, int r, int x, int b)
+{
+	int p = 0x40 | w << 3 | (r >> 3) << 2 | (x >> 3) << 1 | b >> 3;
+	if (p != 0x40)
+		byte(p);
+}
+
+// op r/m32, r32 -- MOV 89  ADD 01  SUB 29  TEST 85
+static void op_rr(int op, int dst, int src)
+{
+	rex(0, src, 0, dst);
+	byte(op);
+	byte(0xC0 | (src & 7) << 3 | (dst & 7));
+}
+
+static void mov_rr(int dst, int src)
+{ if (dst != src) op_rr(0x89, dst, src); }
+
+static void imul_rr(int dst, int src)
+{
+	rex(0, dst, 0, src);
+	byte(0x0F);
+	byte(0xAF);
+	byte(0xC0 | (dst & 7) << 3 | (src & 7));
+}
+
+static void mov_ri(int dst, int32_t imm)
+{
+	rex(0, 0, 0, dst);
+	byte(0xB8 | (dst & 7));
+	dword(imm);
+}
+
+static void mov_ri64(int dst, const void *p)
+{
+	rex(1, 0, 0, dst);
+	byte(0xB8 | (dst & 7));
+	qword((uintptr_t) p);
+}
+
+// ADD /0  SUB /5  CMP /7 WITH AN imm32
+static void alu_ri(int ext, int dst, int32_t imm)
+{
+	if (imm == 0 && ext != 7)
+		return;
+	rex(0, 0, 0, dst);
+	if (imm >= -128 && imm <= 127) {
+		byte(0x83);
+		byte(0xC0 | ext << 3 | (dst & 7));
+		byte(imm & 0xFF);
+	} else {
+		byte(0x81);
+		byte(0xC0 | ext << 3 | (dst & 7));
+		dword(imm);
+	}
+}
+
+// op r32, [rbx + idx*4] -- MOV LOAD 8B  MOV STORE 89
+static void op_stack(int op, int r, int idx)
+{
+	rex(0, r, idx, RBX);
+	byte(op);
+	byte((r & 7) << 3 | 4);
+	byte(2 << 6 | (idx & 7) << 3 | RBX);
+}
+
+// op r32, [rdx + disp8] -- FOR reg[]
+static void op_rdx(int op, int r, int disp)
+{
+	rex(0, r, 0, RDX);
+	byte(op);
+	byte(1 << 6 | (r & 7) << 3 | RDX);
+	byte(disp);
+}
+
+static void push_pop(int op, int r)
+{
+	rex(0, 0, 0, r);
+	byte(op | (r & 7));
+}
+
+static void call_abs(const void *fn)
+{
+	mov_ri64(RAX, fn);
+	byte(0xFF);		// call rax
+	byte(0xD0);
+}
+
+// THE rel32 AT at, EMITTED EARLIER -- NOT IF IT RAN PAST THE END
+static void patch(size_t at, int32_t rel)
+{
+	if (at + 4 <= buf_cap)
+		memcpy(buf + at, &rel, 4);
+	else
+		overflow = true;
+}
+
+static void add_fix(int loc, fix_k kind)
+{
+	if (fix_count == fix_cap) {
+		int cap = fix_cap ? fix_cap * 2 : 256;
+		fixup *temp = realloc(fixes, cap * sizeof(fixup));
+		if (temp == NULL) {
+			overflow = true;
+			return;
+		}
+		fixes = temp;
+		fix_cap = cap;
+	}
+	fixes[fix_count].pos = pos;
+	fixes[fix_count].loc = loc;
+	fixes[fix_count].kind = kind;
+	fix_count++;
+}
+
+static void rel32_to(int off)
+{ dword(off - (int) (pos + 4)); }
+
+static void jmp_off(int off)
+{
+	byte(0xE9);
+	rel32_to(off);
+}
+
+static void jcc_off(int cc, int off)
+{
+	byte(0x0F);
+	byte(0x80 | cc);
+	rel32_to(off);
+}
+
+// JUMP TO A TM LOCATION OR A COLD STUB -- cc < 0 IS UNCONDITIONAL
+static void jump_fix(int cc, int loc, fix_k kind)
+{
+	if (cc < 0)
+		byte(0xE9);
+	else {
+		byte(0x0F);
+		byte(0x80 | cc);
+	}
+	add_fix(loc, kind);
+	dword(0);
+}
+
+// dst = reg[r] -- PC READS AS loc + 1 AS IN step_command()
+static void get_reg(int dst, int r, int loc)
+{
+	if (r == PC_REG)
+		mov_ri(dst, loc + 1);
+	else
+		mov_rr(dst, host_map[r]);
+}
+
+// reg[r] = src -- WRITING PC IS A COMPUTED JUMP
+static void set_reg(int r, int src)
+{
+	if (r != PC_REG) {
+		mov_rr(host_map[r], src);
+		return;
+	}
+	mov_rr(RCX, src);
+	jmp_off(dispatch_off);
+}
+
+// eax = a -- FAULT UNLESS 0 <= a < stk_size
+static void check_eax(int loc)
+{
+	byte(0x3D);		// cmp eax, imm32
+	dword(stk_size);
+	jump_fix(CC_AE, loc, FX_STK);
+}
+
+// eax = d + reg[s] -- FAULT IF OUTSIDE stack[] UNLESS PROVEN
+static void address(int loc, int d, int s, bool is_proven)
+{
+	get_reg(RAX, s, loc);
+	alu_ri(0, RAX, d);
+	if (!is_proven)
+		check_eax(loc);
+}
+
+// eax = reg[r] + d AND CHECK IT -- FOR RET AND LS
+static void check_at(int loc, int r, int d)
+{
+	mov_rr(RAX, host_map[r]);
+	alu_ri(0, RAX, d);
+	check_eax(loc);
+}
+
+// stack[FP++] = stack[++TP]
+static void move_arg(void)
+{
+	alu_ri(0, RBP, 1);
+	op_stack(0x8B, RDX, RBP);
+	op_stack(0x89, RDX, R15);
+	alu_ri(0, R15, 1);
+}
+
+static void out_value(int v)
+{
+	if (batch_flag)
+		fprintf(out_stream, "%d\n", v);
+	else
+		printf("OUT instruction prints: %d\n", v);
+}
+
+static void emit_prologue(void)
+{
+	// SHARED EXIT -- eax RESULT, ecx PC, esi FAULT ADDRESS
+	exit_off = pos;
+	mov_ri64(RDX, &fault_a);
+	byte(0x89);		// mov [rdx], esi
+	byte(0x32);
+	mov_ri64(RDX, reg);
+	op_rdx(0x89, R12, 0);
+	op_rdx(0x89, R13, 4);
+	op_rdx(0x89, RCX, 8);
+	op_rdx(0x89, R14, 12);
+	op_rdx(0x89, R15, 16);
+	op_rdx(0x89, RBP, 20);
+	byte(0x48);		// add rsp, 8
+	byte(0x83);
+	byte(0xC4);
+	byte(0x08);
+	push_pop(0x58, R15);
+	push_pop(0x58, R14);
+	push_pop(0x58, R13);
+	push_pop(0x58, R12);
+	push_pop(0x58, RBP);
+	push_pop(0x58, RBX);
+	byte(0xC3);
+
+	// ecx OUT OF RANGE
+	cmd_fault_off = pos;
+	mov_ri(RAX, R_CMD_ERR);
+	jmp_off(exit_off);
+
+	// ecx = NEXT PC
+	dispatch_off = pos;
+	byte(0x81);		// cmp ecx, imm32
+	byte(0xF9);
+	dword(code_size);
+	jcc_off(CC_AE, cmd_fault_off);
+	mov_ri64(RAX, table);
+	byte(0xFF);		// jmp [rax + rcx*8]
+	byte(0x24);
+	byte(0xC8);
+
+	// ENTRY -- 6 PUSHES AND 8 BYTES KEEP rsp 16-ALIGNED FOR CALLS
+	entry_off = pos;
+	push_pop(0x50, RBX);
+	push_pop(0x50, RBP);
+	push_pop(0x50, R12);
+	push_pop(0x50, R13);
+	push_pop(0x50, R14);
+	push_pop(0x50, R15);
+	byte(0x48);		// sub rsp, 8
+	byte(0x83);
+	byte(0xEC);
+	byte(0x08);
+	mov_ri64(RDX, reg);
+	op_rdx(0x8B, R12, 0);
+	op_rdx(0x8B, R13, 4);
+	op_rdx(0x8B, RCX, 8);
+	op_rdx(0x8B, R14, 12);
+	op_rdx(0x8B, R15, 16);
+	op_rdx(0x8B, RBP, 20);
+	mov_ri64(RBX, stack);
+	jmp_off(dispatch_off);
+}
+
+static void emit_command(int loc)
+{
+	const op_cmd *cmd = &instruction[loc];
+	int r = cmd->carg1, d = cmd->carg2, s = cmd->carg3;
+	static const int jcc_map[] = { CC_L, CC_LE, CC_G, CC_GE, CC_E, CC_NE };
+
+	switch (cmd->cop) {
+		case OP_HALT:
+			mov_ri(RCX, loc + 1);
+			mov_ri(RAX, R_HALT);
+			jmp_off(exit_off);
+		break;
+
+		case OP_RET:
+			check_at(loc, TP_REG, 1);
+			check_at(loc, TP_REG, 2);
+			alu_ri(0, RBP, 1);
+			op_stack(0x8B, R15, RBP);
+			alu_ri(0, RBP, 1);
+			op_stack(0x8B, RCX, RBP);
+			jmp_off(dispatch_off);
+		break;
+
+		case OP_IN:
+			mov_ri(RDI, r);
+			call_abs(input_value);
+			byte(0x85);		// test eax, eax
+			byte(0xC0);
+			mov_ri(RCX, loc + 1);
+			jcc_off(CC_NE, exit_off);
+			mov_ri64(RDX, reg);
+			op_rdx(0x8B, r == PC_REG ? RCX : host_map[r], 4 * r);
+			if (r == PC_REG)
+				jmp_off(dispatch_off);
+		break;
+
+		case OP_OUT:
+			get_reg(RDI, r, loc);
+			call_abs(out_value);
+		break;
+
+		// RO   USING r, s, t -- s AND t ARE carg2 AND carg3
+		case OP_ADD:
+		case OP_SUB:
+		case OP_MUL:
+			get_reg(RAX, cmd->carg2, loc);
+			get_reg(RCX, cmd->carg3, loc);
+			if (cmd->cop == OP_MUL)
+				imul_rr(RAX, RCX);
+			else
+				op_rr(cmd->cop == OP_ADD ? 0x01 : 0x29, RAX, RCX);
+			set_reg(r, RAX);
+		break;
+
+		case OP_DIV:
+			get_reg(RCX, cmd->carg3, loc);
+			op_rr(0x85, RCX, RCX);
+			jump_fix(CC_E, loc, FX_DIV);
+			get_reg(RAX, cmd->carg2, loc);
+			byte(0x99);		// cdq
+			byte(0xF7);		// idiv ecx
+			byte(0xF9);
+			set_reg(r, RAX);
+		break;
+
+		// RM   USING r, d(s)   a = d + reg[s]
+		case OP_LD:
+			address(loc, d + (s == TP_REG), s, access_proven(loc));
+			if (s == TP_REG)
+				alu_ri(0, RBP, 1);
+			op_stack(0x8B, RDX, RAX);
+			set_reg(r, RDX);
+		break;
+
+		case OP_ST:
+			address(loc, d, s, access_proven(loc));
+			get_reg(RDX, r, loc);
+			op_stack(0x89, RDX, RAX);
+			if (s == FP_REG)
+				alu_ri(0, R15, 1);
+			else if (s == TP_REG)
+				alu_ri(5, RBP, 1);
+		break;
+
+		// RA   USING r, d(s)   a = d + reg[s]
+		case OP_LS:
+			if (d <= 0)
+				break;
+			check_at(loc, TP_REG, 1);
+			check_at(loc, TP_REG, d);
+			check_at(loc, FP_REG, 0);
+			check_at(loc, FP_REG, d - 1);
+			if (d <= 4) {
+				while (d-- > 0)
+					move_arg();
+				break;
+			}
+			mov_ri(RCX, d);
+			{
+				int head = pos;
+				move_arg();
+				alu_ri(5, RCX, 1);
+				byte(0x75);		// jnz head
+				byte((head - (int) (pos + 1)) & 0xFF);
+			}
+		break;
+
+		case OP_LDA:
+		case OP_LDC:
+			if (r == PC_REG && (cmd->cop == OP_LDC || s == PC_REG)) {
+				jump_fix(-1, cmd->cop == OP_LDC ? d : loc + 1 + d, FX_LOC);
+				break;
+			}
+			if (cmd->cop == OP_LDC)
+				mov_ri(RAX, d);
+			else {
+				get_reg(RAX, s, loc);
+				alu_ri(0, RAX, d);
+			}
+			set_reg(r, RAX);
+		break;
+
+		case OP_JLT:
+		case OP_JLE:
+		case OP_JGT:
+		case OP_JGE:
+		case OP_JEQ:
+		case OP_JNE:
+			if (s != PC_REG) {
+				get_reg(RCX, s, loc);
+				alu_ri(0, RCX, d);
+			}
+			get_reg(RAX, r, loc);
+			op_rr(0x85, RAX, RAX);
+			if (s == PC_REG)
+				jump_fix(jcc_map[cmd->cop - OP_JLT], loc + 1 + d, FX_LOC);
+			else
+				jcc_off(jcc_map[cmd->cop - OP_JLT], dispatch_off);
+		break;
+
+		default: break;
+	}
+}
+
+// COLD PATHS -- ONE PER CHECK SITE
+static void emit_stub(fixup *fx)
+{
+	patch(fx->pos, pos - (fx->pos + 4));
+	if (fx->kind == FX_STK) {
+		mov_rr(RSI, RAX);
+		mov_ri(RAX, R_STK_ERR);
+	} else
+		mov_ri(RAX, R_ZERO_DIV);
+	mov_ri(RCX, fx->loc + 1);
+	jmp_off(exit_off);
+}
+
+static void release(void)
+{
+	if (buf != NULL)
+		munmap(buf, buf_cap);
+	free(native);
+	free(table);
+	free(fixes);
+	buf = NULL;
+	native = NULL;
+	table = NULL;
+	fixes = NULL;
+	fix_cap = 0;
+	jit_entry = NULL;
+}
+
+bool jit_compile(void)
+{
+	int loc, i, stubs;
+
+	release();
+	buf_cap = 4096 + (size_t) code_size * 256;
+	buf = mmap(NULL, buf_cap, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	native = malloc(code_size * sizeof(int));
+	table = malloc(code_size * sizeof(void *));
+	if (buf == MAP_FAILED || native == NULL || table == NULL) {
+		if (buf == MAP_FAILED)
+			buf = NULL;
+		release();
+		return false;
+	}
+	pos = 0;
+	fix_count = 0;
+	overflow = false;
+
+	emit_prologue();
+	for (loc = 0; loc < code_size; loc++) {
+		native[loc] = pos;
+		emit_command(loc);
+	}
+	// FALLING OFF THE END -- AS D_END
+	mov_ri(RCX, code_size);
+	jmp_off(cmd_fault_off);
+
+	stubs = fix_count;
+	for (i = 0; i < stubs && !overflow; i++) {
+		if (fixes[i].kind == FX_LOC)
+			patch(fixes[i].pos, native[fixes[i].loc] - (fixes[i].pos + 4));
+		else
+			emit_stub(&fixes[i]);
+	}
+
+	if (overflow || mprotect(buf, buf_cap, PROT_READ | PROT_EXEC) != 0) {
+		release();
+		return false;
+	}
+	for (loc = 0; loc < code_size; loc++)
+		table[loc] = buf + native[loc];
+	jit_entry = (op_result (*)(void)) (buf + entry_off);
+	return true;
+}
+
+// RUNS FROM reg[PC_REG] LIKE run_program() BUT DOES NOT COUNT
+// INSTRUCTIONS -- *steps IS LEFT AS IT IS
+op_result run_jit(long *steps)
+{
+	op_result result = jit_entry();
+	(void) steps;
+	if (result == R_STK_ERR)
+		fprintf(batch_flag ? stderr : stdout, "PC = %d a = %d\n", reg[PC_REG] - 1, fault_a);
+	return result;
+}
+
+#else
+
+bool jit_compile(void)
+{ return false; }
+
+op_result run_jit(long *steps)
+{ return run_program(steps); }
+
+#endif
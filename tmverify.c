@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "tm.h"
+
+// RANGE OF EVERY VALUE BP CAN HOLD -- bp_known IS false WHEN
+// SOME INSTRUCTION WRITES BP WITH A VALUE NOT KNOWN BEFORE RUNNING
+static bool bp_known = false;
+static int bp_min = 0;
+static int bp_max = 0;
+
+static bool reject(cchar *msg, int loc)
+{
+	printf("Verify (Instruction %d)   %s\n", loc, msg);
+	return false;
+}
+
+// THE VALUE AN INSTRUCTION WRITES INTO reg[r] IF KNOWN STATICALLY
+static bool const_write(int loc, int *value)
+{
+	const op_cmd *cmd = &instruction[loc];
+	switch (cmd->cop) {
+		case OP_LDC:
+			*value = cmd->carg2;
+			return true;
+		case OP_LDA:
+			*value = cmd->carg2 + loc + 1;
+			return cmd->carg3 == PC_REG;
+		default:
+			return false;
+	}
+}
+
+// DOES THE INSTRUCTION AT loc WRITE reg[r] -- LS AND RET ONLY TOUCH
+// FP, TP AND PC -- ST ONLY BUMPS ITS BASE IF THAT IS FP OR TP
+static bool writes_reg(int loc, int r)
+{
+	const op_cmd *cmd = &instruction[loc];
+	switch (cmd->cop) {
+		case OP_HALT:
+		case OP_OUT:
+			return false;
+		case OP_RET:
+			return r == FP_REG || r == TP_REG || r == PC_REG;
+		case OP_LS:
+			return r == FP_REG || r == TP_REG;
+		case OP_ST:
+			return cmd->carg3 == r && (r == FP_REG || r == TP_REG);
+		case OP_LD:
+			return cmd->carg1 == r || (cmd->carg3 == r && r == TP_REG);
+		case OP_JLT: case OP_JLE: case OP_JGT:
+		case OP_JGE: case OP_JEQ: case OP_JNE:
+			return r == PC_REG;
+		default:
+			return cmd->carg1 == r;
+	}
+}
+
+// STATIC TARGET OF A JUMP AT loc -- false IF IT IS NOT A JUMP
+// OR ITS TARGET DEPENDS ON A REGISTER OTHER THAN PC
+static bool jump_target(int loc, int *target)
+{
+	const op_cmd *cmd = &instruction[loc];
+	switch (cmd->cop) {
+		case OP_JLT: case OP_JLE: case OP_JGT:
+		case OP_JGE: case OP_JEQ: case OP_JNE:
+			*target = cmd->carg2 + loc + 1;
+			return cmd->carg3 == PC_REG;
+		case OP_LDA:
+		case OP_LDC:
+			return cmd->carg1 == PC_REG && const_write(loc, target);
+		default:
+			return false;
+	}
+}
+
+// RUN ONCE AFTER LOADING -- REGISTERS MUST BE VALID AND STATIC JUMP
+// TARGETS INSIDE INSTRUCTION MEMORY -- ALSO WORKS OUT WHICH VALUES
+// BP CAN TAKE SO access_proven() CAN CLEAR BP-RELATIVE ACCESSES
+bool verify_program(void)
+{
+	int loc, value;
+
+	bp_known = true;
+	bp_min = bp_max = 0;		// clear_machine()'S VALUE
+	for (loc = 0; loc < code_size; loc++) {
+		const op_cmd *cmd = &instruction[loc];
+
+		if ((unsigned) cmd->carg1 >= REG_SIZE || (unsigned) cmd->carg3 >= REG_SIZE ||
+			(get_op_type(cmd->cop) == T_RO && (unsigned) cmd->carg2 >= REG_SIZE))
+			return reject("Bad register", loc);
+
+		if (jump_target(loc, &value) && (value < 0 || value >= code_size))
+			return reject("Jump out of range", loc);
+
+		if (writes_reg(loc, BP_REG)) {
+			if (!const_write(loc, &value))
+				bp_known = false;
+			else if (value < bp_min)
+				bp_min = value;
+			else if (value > bp_max)
+				bp_max = value;
+		}
+	}
+
+	// A BP ACCESS OUTSIDE stack[] FOR EVERY VALUE OF BP ALWAYS FAULTS
+	if (bp_known)
+		for (loc = 0; loc < code_size; loc++) {
+			const op_cmd *cmd = &instruction[loc];
+			if ((cmd->cop == OP_LD || cmd->cop == OP_ST) && cmd->carg3 == BP_REG &&
+				((long long) cmd->carg2 + bp_max < 0 || (long long) cmd->carg2 + bp_min >= stk_size))
+				return reject("Data access out of range", loc);
+		}
+	return true;
+}
+
+bool access_proven(int loc)
+{
+	const op_cmd *cmd = &instruction[loc];
+	if (cmd->cop != OP_LD && cmd->cop != OP_ST)
+		return false;
+	if (cmd->carg3 != BP_REG || !bp_known)
+		return false;
+	return (long long) cmd->carg2 + bp_min >= 0 && (long long) cmd->carg2 + bp_max < stk_size;
+}
@@ -1,4 +1,6 @@
 // ERRNO: [1, 10]
+#define _DEFAULT_SOURCE
+#include <sys/mman.h>
 #include "globals.h"
 #include "utils.h"
 
@@ -12,39 +14,84 @@ cchar *token_map[] = {
 	"[", "]", "{", "}"
 };
 
+__thread char median[LENGTH];
+
+__thread node_t *node_pool = NULL;
+__thread uint *node_line = NULL;
+__thread ident_t *node_ident = NULL;
+
+static __thread size_t node_cap = 0;
+static __thread size_t node_used = 0;
+static __thread void *node_base = NULL;
+static __thread size_t node_bytes = 0;
+
 static node_t *new_node(void);
 
-char * copy_string(cchar *str)
+// THE BUILTINS -- input(), output() AND ITS ARGUMENT
+#define N_BUILTIN_NODES 3
+
+// A POOL NO BIGGER THAN THIS STAYS MAPPED FOR THE NEXT COMPILATION
+// ON THE THREAD -- ITS PAGES ARE IN ALREADY
+#ifndef NODES_KEEP_MAX
+	#define NODES_KEEP_MAX (8 * 1024 * 1024)
+#endif
+
+bool open_nodes(size_t most)
+{
+	char *p;
+	size_t bytes;
+	node_cap = most + 1 + N_BUILTIN_NODES;		// AND SLOT 0
+	bytes = node_cap * (sizeof(node_t) + sizeof(uint) + sizeof(ident_t));
+	if (node_base == NULL || node_bytes < bytes) {
+		drop_nodes();
+		node_bytes = bytes;
+		node_base = mmap(NULL, node_bytes, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if (node_base == MAP_FAILED) {
+			node_base = NULL;
+			node_bytes = 0;
+			return false;
+		}
+	}
+	p = node_base;
+	node_pool = (node_t *) p;	p += node_cap * sizeof(node_t);
+	node_line = (uint *) p;		p += node_cap * sizeof(uint);
+	node_ident = (ident_t *) p;
+	node_used = 1;
+	return true;
+}
+
+void close_nodes(void)
+{
+	if (node_bytes > NODES_KEEP_MAX)
+		drop_nodes();
+	node_pool = NULL;
+	node_line = NULL;
+	node_ident = NULL;
+	node_cap = node_used = 0;
+}
+
+void drop_nodes(void)
 {
-	if (str == NULL) return NULL;
-	const int n = strlen(str) + 1;
-	char *cp_str = (char *) malloc( n * sizeof(char) );
-	if (cp_str == NULL)
-		PANIC(1, "Memory exhausted in copy_string()");
-	else
-		strcpy(cp_str, str);
-	return cp_str;
+	if (node_base != NULL)
+		munmap(node_base, node_bytes);
+	node_base = NULL;
+	node_bytes = 0;
 }
 
+size_t nodes_used(void)
+{ return node_used - 1; }
+
 static node_t *new_node(void)
 {
-	node_t *t = (node_t *) malloc( sizeof(node_t) );
-	if (t == NULL) {
+	if (node_used == node_cap) {
 		PANIC(2, "Memory exhausted in new_node()");
 		return NULL;
 	}
-	for (tint i = 0; i < MAX_CHILDS; i++)
-		t->child[i] = NULL;
-	t->sibling = NULL;
-	t->lineno = lineno;
-	t->val = 0;
-	t->name = NULL;
-	t->declaration = NULL;
-	t->expr_type = ET_VOID;
-	t->is_parameter = false;
-	t->is_global = false;
-	t->offset = 0;
-	t->local_size = 0;
+	node_t *t = node_pool + node_used++;
+	memset(t, 0, sizeof(node_t));		// THE POOL MAY BE A USED ONE
+	LINE(t) = lineno;
+	IDENT(t) = 0;
 	return t;
 }
 
@@ -159,7 +206,7 @@ void print_token(token_t token, cchar* lexeme)
 	}
 }
 
-static uint indentno = 0;
+static __thread uint indentno = 0;
 static inline void indent(bool flg)
 { indentno += (flg ? 4 : -4); }
 
@@ -181,7 +228,7 @@ void print_tree(const node_t *tree)
 					fprintf(
 						lst, "%s: %s type: %s\n", 
 						(tree->is_parameter ? "parameter" : "variable"), 
-						tree->name, type_map(tree->var_data_type)
+						NAME(tree), type_map(tree->var_data_type)
 					);
 				break;
 				
@@ -189,14 +236,14 @@ void print_tree(const node_t *tree)
 					fprintf(
 						lst, "%s: %s type: %s[%d]\n", 
 						(tree->is_parameter ? "parameter" : "variable"), 
-						tree->name, type_map(tree->var_data_type), tree->val
+						NAME(tree), type_map(tree->var_data_type), tree->val
 					);
 				break;
 				
 				case D_FUN:
 					fprintf(
 						lst, "%s: %s type: %s\n", 
-					 	"function", tree->name, 
+					 	"function", NAME(tree), 
  						type_map(tree->func_ret_type)
 					);
 				break;
@@ -218,7 +265,7 @@ void print_tree(const node_t *tree)
 				break;
 				
 				case S_CALL:
-					fprintf(lst, "call: %s\n", tree->name);
+					fprintf(lst, "call: %s\n", NAME(tree));
 				break;
 				
 				case S_COMPOUND:
@@ -240,7 +287,7 @@ void print_tree(const node_t *tree)
 				break;
 				
 				case E_ID:
-					fprintf(lst, "identifier: %s\n", tree->name);
+					fprintf(lst, "identifier: %s\n", NAME(tree));
 				break;
 				
 				case E_ASSIGN:
@@ -253,28 +300,8 @@ void print_tree(const node_t *tree)
 			PANIC(7, "Unknown node type");
 		
 		for (tint i = 0; i < MAX_CHILDS; i++)
-			print_tree(tree->child[i]);
-		tree = tree->sibling;
+			print_tree(CHILD(tree, i));
+		tree = SIBLING(tree);
 	}
 	indent(false);
 }
-
-void reclaim_memory(node_t *t)
-{
-	// A FORM OF `HEAD-RECURSIVE' :-(
-	// TO JUDGE tree->sibling AND tree->child[i]
-	// CAN REDUCE THE NUMBER OF FUNCTION CALL
-	if (t->sibling)
-		reclaim_memory(t->sibling);
-	for (tint i = 0; i < MAX_CHILDS; i++)
-		if (t->child[i])
-			reclaim_memory(t->child[i]);
-	if (t->nodekind == N_DECL)
-		free(t->name);
-	else if (t->nodekind == N_STMT && t->whichkind.stmt == S_CALL)
-		free(t->name);
-	else if (t->nodekind == N_EXPR && t->whichkind.expr == E_ID)
-		free(t->name);
-	// DUE TO THE POST-TRAVERSAL -- NOW WE CAN DROP THE WHOLE NODE
-	free(t);
-}
@@ -1,7 +1,16 @@
 #ifndef _UTILS_H_
 #define _UTILS_H_
 
-char * copy_string(cchar *);
+// RESERVES ROOM FOR most NODES -- THEIR ADDRESSES NEVER MOVE -- IN THE
+// POOL OF THE LAST COMPILATION ON THE THREAD IF IT IS BIG ENOUGH
+bool open_nodes(size_t);
+
+void close_nodes(void);
+
+// UNMAPS THE POOL close_nodes() KEPT FOR THE NEXT open_nodes()
+void drop_nodes(void);
+
+size_t nodes_used(void);
 
 node_t * new_decl_node(decl_k);
 
@@ -17,6 +26,4 @@ void print_token(token_t, cchar*);
 
 void print_tree(const node_t *);
 
-void reclaim_memory(node_t *);
-
 #endif
@@ -0,0 +1,365 @@
+// ERRNO: [71, 80]
+#include <stdarg.h>
+#include "x86gen.h"
+#include "cgen.h"
+#include "intern.h"
+
+// NATIVE x86-64 BACKEND -- SAME TREE AND FRAME LAYOUT AS cgen.c
+//
+// A WORD IS 8 BYTES -- A VARIABLE WITH offset k LIVES AT -8(k+1)(%rbp)
+// OR k+1 WORDS BELOW THE END OF cm_data FOR GLOBALS -- ARGUMENTS
+// ARE PUSHED LEFT TO RIGHT AND COPIED INTO THEIR SLOTS BY THE CALLEE
+// EXPRESSIONS LEAVE THEIR VALUE IN %rax -- INTS STAY SIGN-EXTENDED
+// AND ARITHMETIC IS 32-BIT SO RESULTS MATCH THE TM
+
+static __thread uint public_bound = 0;
+
+static __thread uint label_count = 0;
+
+static __thread cchar *func_name = NULL;		// FUNCTION BEING GENERATED
+
+static void gen_func(node_t *);
+
+static void gen_stmt(node_t *);
+
+static void gen_expr(node_t *, bool, bool);
+
+static void gen_call(node_t *);
+
+static void gen_runtime(void);
+
+static void asm_line(cchar *fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+	fputc('\t', out);
+	vfprintf(out, fmt, ap);
+	fputc('\n', out);
+	va_end(ap);
+}
+
+static inline uint new_label(void)
+{ return label_count++; }
+
+static inline void put_label(uint label)
+{ fprintf(out, ".L%u:\n", label); }
+
+// MEMORY OPERAND OF THE SLOT OF decl -- IN A STATIC BUFFER
+static cchar *slot(node_t *decl)
+{
+	static __thread char operand[LENGTH];
+	if (decl->is_global)
+		sprintf(operand, "cm_data+%u(%%rip)", 8 * (public_bound - decl->offset - 1));
+	else
+		sprintf(operand, "%d(%%rbp)", -8 * (int) (decl->offset + 1));
+	return operand;
+}
+
+static uint count_params(node_t *func)
+{
+	uint n = 0;
+	node_t *p;
+	for (p = CHILD(func, 0); p != NULL; p = SIBLING(p))
+		if (p->nodekind == N_DECL &&
+			(p->whichkind.decl == D_SCA || p->whichkind.decl == D_VEC))
+			n++;
+	return n;
+}
+
+void x86_gen(node_t *tree, cchar *outfile)
+{
+	node_t *cursor;
+	bool has_main = false;
+
+	label_count = 0;
+	public_bound = calc_globals(tree);
+	fprintf(out, "# C- %s -- x86-64 GNU as\n", outfile);
+	asm_line(".text");
+
+	for (cursor = tree; cursor != NULL; cursor = SIBLING(cursor))
+		if (cursor->nodekind == N_DECL && cursor->whichkind.decl == D_FUN) {
+			if (IDENT(cursor) == ID_MAIN)
+				has_main = true;
+			gen_func(cursor);
+		}
+
+	// C ENTRY -- A PROGRAM WITHOUT main() HALTS AT ONCE AS ON THE TM
+	asm_line(".globl main");
+	fprintf(out, "main:\n");
+	asm_line("pushq %%rbp");
+	asm_line("movq %%rsp, %%rbp");
+	if (has_main)
+		asm_line("call cm_main");
+	asm_line("xorl %%eax, %%eax");
+	asm_line("leave");
+	asm_line("ret");
+
+	gen_runtime();
+
+	if (public_bound != 0) {
+		asm_line(".bss");
+		asm_line(".align 8");
+		fprintf(out, "cm_data:\n");
+		asm_line(".zero %u", 8 * public_bound);
+	}
+	asm_line(".section .note.GNU-stack,\"\",@progbits");
+}
+
+static void gen_func(node_t *tree)
+{
+	uint nparam, frame, i;
+
+	calc_offset(tree);
+	nparam = count_params(tree);
+	frame = 8 * (tree->local_size + nparam);
+	frame = (frame + 15) & ~15u;
+	func_name = NAME(tree);
+
+	if (trace_code)
+		fprintf(out, "# %s() -- %u local word(s), %u parameter(s)\n",
+			NAME(tree), tree->local_size, nparam);
+	fprintf(out, "cm_%s:\n", NAME(tree));
+	asm_line("pushq %%rbp");
+	asm_line("movq %%rsp, %%rbp");
+	if (frame != 0)
+		asm_line("subq $%u, %%rsp", frame);
+
+	// ARGUMENT i (FROM 1) IS AT 16+8(n-i)(%rbp) -- ITS SLOT HAS
+	// offset local_size+i-1 AS GIVEN BY calc_offset()
+	for (i = 1; i <= nparam; i++) {
+		asm_line("movq %u(%%rbp), %%rax", 16 + 8 * (nparam - i));
+		asm_line("movq %%rax, %d(%%rbp)", -8 * (int) (tree->local_size + i));
+	}
+
+	gen_stmt(CHILD(tree, 1));
+
+	fprintf(out, ".Lret_%s:\n", NAME(tree));
+	asm_line("leave");
+	asm_line("ret");
+}
+
+// [addr] = rhs -- LEAVES rhs IN %rax
+static void gen_assign(node_t *tree)
+{
+	node_t *decl = DECL_OF(CHILD(tree, 0));
+	gen_expr(CHILD(tree, 1), false, true);
+	asm_line("pushq %%rax");
+	if (decl->nodekind == N_DECL && decl->whichkind.decl == D_VEC && decl->is_parameter)
+		gen_expr(CHILD(tree, 0), false, false);
+	else
+		gen_expr(CHILD(tree, 0), true, false);
+	asm_line("popq %%rcx");
+	asm_line("movq %%rcx, (%%rax)");
+	asm_line("movq %%rcx, %%rax");
+}
+
+static void gen_stmt(node_t *cursor)
+{
+	uint else_label, end_label;
+	while (cursor != NULL) {
+		if (cursor->nodekind == N_EXPR && cursor->whichkind.expr == E_ASSIGN)
+			gen_assign(cursor);
+		else if (cursor->nodekind == N_STMT)
+			switch (cursor->whichkind.stmt) {
+				case S_IF:
+					else_label = new_label();
+					end_label = new_label();
+					gen_expr(CHILD(cursor, 0), false, true);
+					asm_line("testl %%eax, %%eax");
+					asm_line("je .L%u", else_label);
+					gen_stmt(CHILD(cursor, 1));
+					asm_line("jmp .L%u", end_label);
+					put_label(else_label);
+					gen_stmt(CHILD(cursor, 2));
+					put_label(end_label);
+				break;
+
+				case S_WHILE:
+					else_label = new_label();		// HEAD
+					end_label = new_label();
+					put_label(else_label);
+					gen_expr(CHILD(cursor, 0), false, true);
+					asm_line("testl %%eax, %%eax");
+					asm_line("je .L%u", end_label);
+					gen_stmt(CHILD(cursor, 1));
+					asm_line("jmp .L%u", else_label);
+					put_label(end_label);
+				break;
+
+				case S_RETURN:
+					if (CHILD(cursor, 0) != NULL)
+						gen_expr(CHILD(cursor, 0), false, true);
+					asm_line("jmp .Lret_%s", func_name);
+				break;
+
+				case S_CALL:		gen_call(cursor);				break;
+				case S_COMPOUND:	gen_stmt(CHILD(cursor, 1));		break;
+			}
+		cursor = SIBLING(cursor);
+	}
+}
+
+static void gen_expr(node_t *tree, bool need_addr, bool load_val)
+{
+	node_t *decl;
+	if (tree->nodekind == N_STMT) {
+		if (tree->whichkind.stmt == S_CALL)
+			gen_call(tree);
+		return ;
+	}
+	if (tree->nodekind != N_EXPR) return ;
+	switch (tree->whichkind.expr) {
+		case E_OP:
+			// EVALUATE ORDER: LR -- LHS IN %rax, RHS IN %rcx
+			gen_expr(CHILD(tree, 0), false, true);
+			asm_line("pushq %%rax");
+			gen_expr(CHILD(tree, 1), false, true);
+			asm_line("movq %%rax, %%rcx");
+			asm_line("popq %%rax");
+			switch (tree->op) {
+				case PLUS:		asm_line("addl %%ecx, %%eax");		break;
+				case MINUS:		asm_line("subl %%ecx, %%eax");		break;
+				case TIMES:		asm_line("imull %%ecx, %%eax");		break;
+				case DIVIDE:
+					asm_line("testl %%ecx, %%ecx");
+					asm_line("je cm_div_zero");
+					asm_line("cltd");
+					asm_line("idivl %%ecx");
+				break;
+
+				// THE TM TESTS lhs - rhs AGAINST 0 -- SO DO WE
+				case LT:
+				case LE:
+				case GT:
+				case GE:
+				case EQ:
+				case NE:
+					;static cchar *setmap[] = {"setl", "setle", "setg", "setge", "sete", "setne"};
+					asm_line("subl %%ecx, %%eax");
+					asm_line("testl %%eax, %%eax");
+					asm_line("%s %%al", setmap[tree->op - LT]);
+					asm_line("movzbl %%al, %%eax");
+				break;
+
+				default: break;
+			}
+			asm_line("cltq");
+		break;
+
+		case E_NUM:
+			asm_line("movq $%d, %%rax", tree->val);
+		break;
+
+		case E_ID:
+			decl = DECL_OF(tree);
+			if (decl->whichkind.decl == D_VEC) {
+				// ADDRESS OF ELEMENT 0 -- A PARAMETER HOLDS IT
+				cchar *load = decl->is_parameter ? "movq" : "leaq";
+				if (CHILD(tree, 0) == NULL) {
+					asm_line("%s %s, %%rax", load, slot(decl));
+					break;
+				}
+				gen_expr(CHILD(tree, 0), false, true);
+				asm_line("%s %s, %%rcx", load, slot(decl));
+				asm_line("negq %%rax");
+				asm_line("leaq (%%rcx,%%rax,8), %%rax");
+				if (load_val)
+					asm_line("movq (%%rax), %%rax");
+			}
+			else if (decl->whichkind.decl == D_SCA)
+				asm_line("%s %s, %%rax", need_addr ? "leaq" : "movq", slot(decl));
+		break;
+
+		case E_ASSIGN:
+			gen_assign(tree);
+		break;
+	}
+}
+
+static void gen_call(node_t *tree)
+{
+	uint pcot = 0;		// PARAMETER COUNT
+	node_t *p;
+	bool is_need_addr, is_need_val;
+
+	for (p = CHILD(tree, 0); p != NULL; p = SIBLING(p)) {
+		// SAME RULES AS cgen.c -- AN ARRAY PASSES ITS ADDRESS
+		is_need_addr = false;
+		is_need_val = true;
+		if (p->nodekind == N_EXPR && p->whichkind.expr == E_ID &&
+			DECL_OF(p)->whichkind.decl == D_VEC) {
+			is_need_addr = !DECL_OF(p)->is_parameter;
+			is_need_val = CHILD(p, 0) != NULL;
+		}
+		gen_expr(p, is_need_addr, is_need_val);
+		asm_line("pushq %%rax");
+		pcot++;
+	}
+
+	if (IDENT(tree) == ID_INPUT)
+		asm_line("call cm_input");
+	else if (IDENT(tree) == ID_OUTPUT) {
+		asm_line("popq %%rdi");
+		asm_line("call cm_output");
+		pcot--;
+	} else
+		asm_line("call cm_%s", NAME(tree));
+	if (pcot != 0)
+		asm_line("addq $%u, %%rsp", 8 * pcot);
+}
+
+// input() AND output() OVER THE C LIBRARY -- THEY REALIGN %rsp SINCE
+// C- FRAMES DON'T KEEP IT 16-BYTE ALIGNED -- FAULTS EXIT WITH THE
+// SAME STATUS AS `tm --run'
+static void gen_runtime(void)
+{
+	static cchar *runtime =
+		"cm_input:\n"
+		"\tpushq %rbp\n"
+		"\tmovq %rsp, %rbp\n"
+		"\tandq $-16, %rsp\n"
+		"\tsubq $16, %rsp\n"
+		"\tleaq .Lfmt_in(%rip), %rdi\n"
+		"\tmovq %rsp, %rsi\n"
+		"\txorl %eax, %eax\n"
+		"\tcall scanf@PLT\n"
+		"\tcmpl $1, %eax\n"
+		"\tjne .Lin_err\n"
+		"\tmovslq (%rsp), %rax\n"
+		"\tleave\n"
+		"\tret\n"
+		".Lin_err:\n"
+		"\tleaq .Lmsg_in(%rip), %rdi\n"
+		"\tmovl $5, %esi\n"
+		"\tjmp cm_fault\n"
+		"cm_output:\n"
+		"\tpushq %rbp\n"
+		"\tmovq %rsp, %rbp\n"
+		"\tandq $-16, %rsp\n"
+		"\tmovl %edi, %esi\n"
+		"\tleaq .Lfmt_out(%rip), %rdi\n"
+		"\txorl %eax, %eax\n"
+		"\tcall printf@PLT\n"
+		"\tleave\n"
+		"\tret\n"
+		"cm_div_zero:\n"
+		"\tleaq .Lmsg_div(%rip), %rdi\n"
+		"\tmovl $4, %esi\n"
+		// %rdi MESSAGE  %esi EXIT STATUS
+		"cm_fault:\n"
+		"\tandq $-16, %rsp\n"
+		"\tpushq %rsi\n"
+		"\tpushq %rsi\n"
+		"\tmovq stderr@GOTPCREL(%rip), %rsi\n"
+		"\tmovq (%rsi), %rsi\n"
+		"\tcall fputs@PLT\n"
+		"\tpopq %rdi\n"
+		"\tcall exit@PLT\n"
+		"\t.section .rodata\n"
+		".Lfmt_in:\t.string \"%d\"\n"
+		".Lfmt_out:\t.string \"%d\\n\"\n"
+		".Lmsg_in:\t.string \"Input Exhausted\\n\"\n"
+		".Lmsg_div:\t.string \"Division by 0\\n\"\n"
+		"\t.text\n";
+	fputs(runtime, out);
+}
@@ -0,0 +1,11 @@
+#ifndef _X86GEN_H_
+#define _X86GEN_H_
+
+#include "globals.h"
+
+// WRITES GNU-as x86-64 ASSEMBLY FOR THE ANALYZED TREE TO out -- THE
+// NAME IS ONLY FOR ITS HEADER -- LINK WITH THE C LIBRARY (E.G.
+// `cc -o prog file.cm.s') FOR scanf()/printf()
+void x86_gen(node_t *, cchar *);
+
+#endif